@@ -28,6 +28,7 @@
 #include "shared/IFile.h"
 #include "logger.h"
 #include "bossdata.h"
+#include "passability.h"
 
 namespace ActorData
 {
@@ -151,49 +152,38 @@ CActor::~CActor()
  */
 
 bool CActor::canMove(const JoyAim aim) const
+{
+    return canMoveFrom(Pos{m_x, m_y}, aim);
+}
+
+/**
+ * @brief Could the Sprite move in given direction if it stood at pos
+ *
+ * @param pos
+ * @param aim
+ * @return true
+ * @return false
+ */
+
+bool CActor::canMoveFrom(const Pos &pos, const JoyAim aim) const
 {
     const CMap &map = CGame::getMap();
-    const Pos &pos = Pos{m_x, m_y};
     const Pos &newPos = CGame::translate(pos, aim);
     if (pos.x == newPos.x && pos.y == newPos.y)
     {
         return false;
     }
 
-    const uint8_t c = map.at(newPos.x, newPos.y);
-    const TileDef &def = getTileDef(c);
-    if (def.type == TYPE_BACKGROUND)
+    const uint8_t mask = map.passMask(newPos.x, newPos.y);
+    const Passability::Class cls = Passability::actorClass(m_type);
+    if (mask & cls)
     {
         return true;
     }
-    else if (m_type == TYPE_PLAYER)
-    {
-        if (def.type == TYPE_SWAMP ||
-            def.type == TYPE_PICKUP ||
-            def.type == TYPE_DIAMOND ||
-            def.type == TYPE_STOP ||
-            def.type == TYPE_CHUTE ||
-            def.type == TYPE_KEY ||
-            def.type == TYPE_FIRE)
-        {
-            return true;
-        }
-        else if (def.type == TYPE_DOOR)
-        {
-            return CGame::hasKey(c + 1);
-        }
-    }
-    else if (RANGE(m_type, ATTR_CRUSHER_MIN, ATTR_CRUSHER_MAX))
-    {
-        if (def.type == TYPE_PLAYER)
-            return true;
-    }
-    else if (CGame::isMoveableType(m_type) || CGame::isBulletType(m_type))
-    {
-        if (def.type == TYPE_STOP)
-            return true;
-    }
-    return false;
+    // doors open for the player holding the matching key
+    return cls == Passability::PLAYER &&
+           (mask & Passability::DOOR) &&
+           CGame::hasKey(map.at(newPos.x, newPos.y) + 1);
 }
 
 /**
@@ -47,6 +47,7 @@ public:
     ~CActor();
 
     bool canMove(const JoyAim aim) const override;
+    bool canMoveFrom(const Pos &pos, const JoyAim aim) const override;
     void move(const JoyAim aim) override;
     inline int16_t x() const override
     {
@@ -17,14 +17,16 @@
 */
 #include "game.h"
 #include <vector>
-#include <queue>
 #include <cmath>
 #include <algorithm>
 #include <array>
+#include <functional>
+#include <limits>
 #include "map.h"
 #include "logger.h"
 #include "ai_path.h"
 #include "isprite.h"
+#include "boss.h"
 #include "filemacros.h"
 #include "bossdata.h"
 #include "shared/IFile.h"
@@ -35,64 +37,336 @@ namespace PathData
     const AStarSmooth aStarSmooth;
     const BFS bFS;
     const LineOfSight lineOfSight;
+    const JPS jps;
+    const FlowField flowField;
 
     constexpr int PATH_TIMEOUT_MAX = 10; // Recompute path every 10 turns
+    constexpr int GOAL_TOLERANCE = 2;    // tiles the goal may move before a resumable search starts over
     constexpr size_t MAX_PATH_SIZE = 4096;
+
+    // aim tested for each delta, see canStep()
     constexpr JoyAim g_dirs[] = {AIM_UP, AIM_DOWN, AIM_LEFT, AIM_RIGHT};
     constexpr std::array<Pos, JoyAim::TOTAL_AIMS> g_deltas = {
-        Pos{-1, 0}, // Up
-        Pos{1, 0},  // Down
-        Pos{0, -1}, // Left
-        Pos{0, 1},  // Right
+        Pos{-1, 0}, // Left
+        Pos{1, 0},  // Right
+        Pos{0, -1}, // Up
+        Pos{0, 1},  // Down
     };
-}
+    // the direction each delta actually moves;
+    // opposite directions are paired: g_stepAims[i ^ 1] reverses g_stepAims[i]
+    constexpr JoyAim g_stepAims[] = {AIM_LEFT, AIM_RIGHT, AIM_UP, AIM_DOWN};
 
-using namespace PathData;
+    enum : int
+    {
+        NO_NODE = -1,
+    };
 
-namespace std
-{
-    template <>
-    struct hash<Pos>
+    struct node_t
     {
-        // hashes a key for Pos
-        size_t operator()(const Pos &pos) const
+        Pos pos;
+        int gCost;
+        int hCost;
+        int parent;
+        int fCost() const { return gCost + hCost; }
+    };
+
+    /**
+     * @brief Scratch space shared by the grid searches
+     *
+     * Per-cell markers are flat arrays sized to the largest grid searched so
+     * far. A cell is only considered seen or closed when its stamp matches the
+     * current generation, so nothing has to be cleared between searches.
+     * Nodes are never updated in place: a cheaper route to a cell adds a new
+     * node and the stale one stays in the heap, as with the original search.
+     */
+    struct search_t
+    {
+        std::vector<uint32_t> seen;   // generation the cell was reached
+        std::vector<uint32_t> closed; // generation the cell was closed
+        std::vector<int> best;        // best node (A*) or parent cell (BFS)
+        std::vector<node_t> nodes;
+        std::vector<int> heap; // binary heap of node indices
+        std::vector<int> queue;
+        std::vector<Pos> path;
+        std::vector<Pos> smoothed;
+        std::vector<JoyAim> segment;
+        std::vector<uint32_t> jumped; // generation a jump was taken, per cell and direction
+        std::vector<int> jumps;       // cell where that jump stopped or NO_NODE
+        std::vector<int> run;         // cells crossed by the jumps in progress
+        uint32_t generation = 0;
+        int len = 0;
+        int hei = 0;
+        Pos goal{0, 0};
+
+        void begin(const int mapLen, const int mapHei)
+        {
+            const size_t cells = static_cast<size_t>(mapLen) * mapHei;
+            if (seen.size() < cells)
+            {
+                seen.assign(cells, 0);
+                closed.assign(cells, 0);
+                best.assign(cells, NO_NODE);
+                jumped.assign(cells * g_deltas.size(), 0);
+                jumps.assign(cells * g_deltas.size(), NO_NODE);
+                generation = 0;
+            }
+            if (++generation == 0)
+            {
+                // stamps wrapped around
+                std::fill(seen.begin(), seen.end(), 0);
+                std::fill(closed.begin(), closed.end(), 0);
+                std::fill(jumped.begin(), jumped.end(), 0);
+                generation = 1;
+            }
+            len = mapLen;
+            hei = mapHei;
+            nodes.clear();
+            heap.clear();
+            queue.clear();
+            path.clear();
+            run.clear();
+        }
+
+        int cell(const Pos &pos) const { return pos.x + pos.y * len; }
+        bool isSeen(const Pos &pos) const { return seen[cell(pos)] == generation; }
+        bool isClosed(const Pos &pos) const { return closed[cell(pos)] == generation; }
+        void close(const Pos &pos) { closed[cell(pos)] = generation; }
+        int find(const Pos &pos) const { return isSeen(pos) ? best[cell(pos)] : NO_NODE; }
+
+        // lower fCost has higher priority
+        bool operator()(const int a, const int b) const
+        {
+            return nodes[a].fCost() > nodes[b].fCost();
+        }
+
+        void open(const Pos &pos, const int gCost, const int hCost, const int parent)
+        {
+            const int i = static_cast<int>(nodes.size());
+            nodes.emplace_back(node_t{pos, gCost, hCost, parent});
+            seen[cell(pos)] = generation;
+            best[cell(pos)] = i;
+            heap.emplace_back(i);
+            std::push_heap(heap.begin(), heap.end(), std::cref(*this));
+        }
+
+        int pop()
         {
-            return (static_cast<uint64_t>(pos.x) << 32) | (pos.y & 0xFFFFFFFF);
+            std::pop_heap(heap.begin(), heap.end(), std::cref(*this));
+            const int i = heap.back();
+            heap.pop_back();
+            return i;
+        }
+
+        void trace(int i)
+        {
+            for (; i != NO_NODE; i = nodes[i].parent)
+                path.emplace_back(nodes[i].pos);
+            std::reverse(path.begin(), path.end());
         }
     };
+
+    // the state below is kept per thread: a thread only drives the games
+    // bound to it (see CGame::Scope), each with caches of its own maps
+    thread_local search_t g_search;
+    thread_local size_t g_expansions = 0;
+
+    // searches that CPath spreads over several ticks
+    struct job_t
+    {
+        search_t search;
+        const CPath *owner = nullptr;
+        Pos origin{0, 0};   // sprite position when the search started
+        uint32_t epoch = 0; // map pass epoch when the search started
+        uint32_t tick = 0;  // last tick the search ran
+    };
+    thread_local std::array<job_t, CPath::MAX_SEARCHES> g_jobs;
+    thread_local std::vector<JoyAim> g_found;
+    thread_local uint32_t g_tick = 1;
+    thread_local int g_nodeBudget = CPath::NODE_BUDGET;
+    thread_local int g_budget = CPath::NODE_BUDGET;
+
+    // cached paths reused or recomputed
+    thread_local size_t g_hits = 0;
+    thread_local size_t g_misses = 0;
+
+    // distance fields shared by the chasers
+    thread_local std::array<CDistanceField, CDistanceField::MAX_FIELDS> g_fields;
+    thread_local uint32_t g_fieldGeneration = 1;
+    thread_local uint32_t g_fieldClock = 0;
+    thread_local size_t g_fieldBuilds = 0;
+
+    // connectivity of each movement class
+    thread_local std::array<CRegions, CRegions::MAX_REGIONS> g_regions;
+    thread_local uint32_t g_regionClock = 0;
+    thread_local size_t g_regionBuilds = 0;
+    thread_local size_t g_rejects = 0;
+
+    // line of sight walks, reused while the tiles they cross keep their pass masks
+    struct trace_t
+    {
+        int key = NO_NODE; // movement class or NO_NODE for an unused slot
+        uint32_t map = 0;  // CMap::id()
+        Pos start{0, 0};
+        Pos goal{0, 0};
+        uint32_t epoch = 0;
+        std::vector<JoyAim> directions;
+    };
+    constexpr size_t MAX_TRACES = 64;
+    thread_local std::array<trace_t, MAX_TRACES> g_traces;
+    thread_local size_t g_traceHits = 0;
+
+    int movementClass(const ISprite &sprite)
+    {
+        return (sprite.isBoss() << 8) | sprite.type();
+    }
+
+    // footprint of a movement class in tiles
+    Pos extent(const ISprite &sprite)
+    {
+        if (!sprite.isBoss())
+            return Pos{1, 1};
+        const int granularFactor = sprite.getGranularFactor();
+        const hitbox_t &hitbox = static_cast<const CBoss &>(sprite).data()->hitbox;
+        return Pos{static_cast<int16_t>(std::max(hitbox.width / granularFactor, 1)),
+                   static_cast<int16_t>(std::max(hitbox.height / granularFactor, 1))};
+    }
+
+    Pos advance(const Pos &pos, const JoyAim aim)
+    {
+        for (size_t i = 0; i < g_deltas.size(); ++i)
+            if (g_stepAims[i] == aim)
+                return Pos{static_cast<int16_t>(pos.x + g_deltas[i].x),
+                           static_cast<int16_t>(pos.y + g_deltas[i].y)};
+        return pos;
+    }
+
+    /**
+     * @brief Check a step of the grid searches
+     *
+     * A step along g_deltas[i] is open when the sprite could move on from
+     * the cell it enters in the direction g_dirs[i]. This is not the move
+     * the sprite makes, but the searches have always tested steps this way
+     * and the paths of the bosses, hence the recordings, depend on it.
+     * Every search, region label and distance field uses the same test.
+     *
+     * @param sprite
+     * @param pos cell left; the cell entered must be on the grid
+     * @param i index into g_deltas
+     * @return true
+     * @return false
+     */
+    bool canStep(const ISprite &sprite, const Pos &pos, const size_t i)
+    {
+        const Pos next{static_cast<int16_t>(pos.x + g_deltas[i].x),
+                       static_cast<int16_t>(pos.y + g_deltas[i].y)};
+        return sprite.canMoveFrom(next, g_dirs[i]);
+    }
+
+    bool toDirections(const std::vector<Pos> &path, std::vector<JoyAim> &directions)
+    {
+        directions.clear();
+        for (size_t i = 1; i < path.size(); ++i)
+        {
+            const int dx = path[i].x - path[i - 1].x;
+            const int dy = path[i].y - path[i - 1].y;
+            if (dx == 1 && dy == 0)
+                directions.push_back(JoyAim::AIM_RIGHT);
+            else if (dx == -1 && dy == 0)
+                directions.push_back(JoyAim::AIM_LEFT);
+            else if (dx == 0 && dy == 1)
+                directions.push_back(JoyAim::AIM_DOWN);
+            else if (dx == 0 && dy == -1)
+                directions.push_back(JoyAim::AIM_UP);
+            else
+            {
+                LOGE("Invalid path transition from (%d,%d) to (%d,%d) on line %d",
+                     path[i - 1].x, path[i - 1].y, path[i].x, path[i].y, __LINE__);
+                directions.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Number of steps along a path from origin to pos
+     *
+     * @return size_t or directions.size() + 1 if the path misses pos
+     */
+    size_t stepsTo(const Pos &origin, const Pos &pos, const std::vector<JoyAim> &directions)
+    {
+        Pos current = origin;
+        size_t steps = 0;
+        while (current != pos && steps < directions.size())
+            current = advance(current, directions[steps++]);
+        return current == pos ? steps : directions.size() + 1;
+    }
+
+    /**
+     * @brief Check that a resumable search is worth running
+     *
+     * @param sprite
+     * @param goalPos
+     * @param algo
+     * @return true if both ends are on the grid and connected
+     */
+    bool acceptQuery(const ISprite &sprite, const Pos &goalPos, const IPath &algo)
+    {
+        const int granularFactor = sprite.getGranularFactor();
+        const CMap &map = CGame::getMap();
+        const int mapLen = map.len() * granularFactor;
+        const int mapHei = map.hei() * granularFactor;
+        const Pos startPos = sprite.pos();
+        if (startPos.x < 0 || startPos.x >= mapLen || startPos.y < 0 || startPos.y >= mapHei ||
+            goalPos.x < 0 || goalPos.x >= mapLen || goalPos.y < 0 || goalPos.y >= mapHei)
+        {
+            LOGE("Invalid start (%d,%d) or goal (%d,%d) for map bounds (%d,%d) on line %d",
+                 startPos.x, startPos.y, goalPos.x, goalPos.y, mapLen, mapHei, __LINE__);
+            return false;
+        }
+        return !algo.usesRegions() || CRegions::isReachable(sprite, startPos, goalPos);
+    }
+
+    void openSearch(search_t &search, const Pos &startPos, const Pos &goalPos, const int len, const int hei)
+    {
+        search.begin(len, hei);
+        search.goal = goalPos;
+        search.open(startPos, 0, std::abs(startPos.x - goalPos.x) + std::abs(startPos.y - goalPos.y), NO_NODE);
+    }
+
 }
 
-struct Node
+using namespace PathData;
+
+bool IPath::beginSearch(const ISprite &, const Pos &, search_t &) const
 {
-    Pos pos;
-    int gCost, hCost;
-    Node *parent;
-    Node(const Pos &p, int g, int h, Node *par) : pos(p), gCost(g), hCost(h), parent(par) {}
-    int fCost() const { return gCost + hCost; }
-};
+    return false;
+}
 
-// Comparator for priority queue (min heap based on fCost)
-struct CompareNode
+bool IPath::resumeSearch(const ISprite &, search_t &, int &, std::vector<JoyAim> &directions) const
 {
-    bool operator()(const Node *a, const Node *b) const
-    {
-        return a->fCost() > b->fCost(); // Lower fCost has higher priority
-    }
-};
+    directions.clear();
+    return true;
+}
+
+bool IPath::retraces(const ISprite &, const Pos &, const Pos &, const uint32_t) const
+{
+    return false;
+}
 
 int AStar::manhattanDistance(const Pos &a, const Pos &b) const
 {
     return abs(a.x - b.x) + abs(a.y - b.y);
 }
 
-std::vector<JoyAim> AStar::findPath(ISprite &sprite, const Pos &goalPos) const
+void AStar::findPath(const ISprite &sprite, const Pos &goalPos, std::vector<JoyAim> &directions) const
 {
     const int granularFactor = sprite.getGranularFactor();
     const CMap &map = CGame::getMap();
     const int mapLen = map.len() * granularFactor;
     const int mapHei = map.hei() * granularFactor;
-    std::vector<JoyAim> directions;
     const Pos startPos = sprite.pos();
+    directions.clear();
 
     // Validate start and goal positions
     if (startPos.x < 0 || startPos.x >= mapLen || startPos.y < 0 || startPos.y >= mapHei ||
@@ -100,202 +374,267 @@ std::vector<JoyAim> AStar::findPath(ISprite &sprite, const Pos &goalPos) const
     {
         LOGE("Invalid start (%d,%d) or goal (%d,%d) for map bounds (%d,%d) on line %d",
              startPos.x, startPos.y, goalPos.x, goalPos.y, mapLen, mapHei, __LINE__);
-        return {};
+        return;
     }
 
-    // Priority queue for open list
-    std::priority_queue<Node *, std::vector<Node *>, CompareNode> openList;
-    std::unordered_map<Pos, std::unique_ptr<Node>> nodes;
-    std::unordered_map<Pos, bool> closedList;
+    if (!CRegions::isReachable(sprite, startPos, goalPos))
+        return;
+
+    search_t &search = g_search;
+    search.begin(mapLen, mapHei);
 
     // Create start node
-    nodes[startPos] = std::make_unique<Node>(startPos, 0, manhattanDistance(startPos, goalPos), nullptr);
-    openList.push(nodes[startPos].get());
+    search.open(startPos, 0, manhattanDistance(startPos, goalPos), NO_NODE);
 
-    while (!openList.empty())
+    while (!search.heap.empty())
     {
-        Node *current = openList.top();
-        openList.pop();
+        const int current = search.pop();
+        const node_t node = search.nodes[current];
+        ++g_expansions;
 
         // Reached goal
-        if (current->pos == goalPos)
+        if (node.pos == goalPos)
         {
-            // Convert path to directions
-            Node *node = current;
-            std::vector<Pos> path;
-            while (node != nullptr)
-            {
-                path.push_back(node->pos);
-                node = node->parent;
-            }
-            std::reverse(path.begin(), path.end());
-
-            // Convert positions to directions
-            for (size_t i = 1; i < path.size(); ++i)
-            {
-                int dx = path[i].x - path[i - 1].x;
-                int dy = path[i].y - path[i - 1].y;
-                if (dx == 1 && dy == 0)
-                    directions.push_back(JoyAim::AIM_RIGHT);
-                else if (dx == -1 && dy == 0)
-                    directions.push_back(JoyAim::AIM_LEFT);
-                else if (dx == 0 && dy == 1)
-                    directions.push_back(JoyAim::AIM_DOWN);
-                else if (dx == 0 && dy == -1)
-                    directions.push_back(JoyAim::AIM_UP);
-                else
-                {
-                    LOGE("Invalid path transition from (%d,%d) to (%d,%d) on line %d",
-                         path[i - 1].x, path[i - 1].y, path[i].x, path[i].y, __LINE__);
-                    return {};
-                }
-            }
-            return directions;
+            search.trace(current);
+            toDirections(search.path, directions);
+            return;
         }
 
-        closedList[current->pos] = true;
+        search.close(node.pos);
 
         // Explore neighbors
         for (size_t i = 0; i < g_deltas.size(); ++i)
         {
-            const Pos newPos{static_cast<int16_t>(current->pos.x + g_deltas[i].x),
-                             static_cast<int16_t>(current->pos.y + g_deltas[i].y)};
+            const Pos newPos{static_cast<int16_t>(node.pos.x + g_deltas[i].x),
+                             static_cast<int16_t>(node.pos.y + g_deltas[i].y)};
 
             // Check bounds before moving
             if (newPos.x < 0 || newPos.x >= mapLen || newPos.y < 0 || newPos.y >= mapHei)
                 continue;
 
-            if (closedList.find(newPos) != closedList.end())
+            if (search.isClosed(newPos))
                 continue;
 
-            // save original position
-            Pos originalPos{sprite.pos()};
-
             // Check if move is valid
-            sprite.move(newPos);
-            if (!sprite.canMove(g_dirs[i]))
-            {
-                sprite.move(originalPos);
+            if (!canStep(sprite, node.pos, i))
                 continue;
-            }
-            sprite.move(originalPos);
 
-            int newGCost = current->gCost + 1;
-            int newHCost = manhattanDistance(newPos, goalPos);
-
-            auto it = nodes.find(newPos);
-            if (it == nodes.end() || newGCost < it->second->gCost)
-            {
-                nodes[newPos] = std::make_unique<Node>(newPos, newGCost, newHCost, current);
-                openList.push(nodes[newPos].get());
-            }
+            const int newGCost = node.gCost + 1;
+            const int best = search.find(newPos);
+            if (best == NO_NODE || newGCost < search.nodes[best].gCost)
+                search.open(newPos, newGCost, manhattanDistance(newPos, goalPos), current);
         }
     }
     // No path found
-    return directions; // Empty if no path found
 }
 
-std::vector<JoyAim> BFS::findPath(ISprite &sprite, const Pos &goalPos) const
+void BFS::findPath(const ISprite &sprite, const Pos &goalPos, std::vector<JoyAim> &directions) const
 {
     const int granularFactor = sprite.getGranularFactor();
     const CMap &map = CGame::getMap();
     const int mapLen = map.len() * granularFactor;
     const int mapHei = map.hei() * granularFactor;
     const Pos startPos = sprite.pos();
+    directions.clear();
 
     if (startPos.x < 0 || startPos.x >= mapLen || startPos.y < 0 || startPos.y >= mapHei ||
         goalPos.x < 0 || goalPos.x >= mapLen || goalPos.y < 0 || goalPos.y >= mapHei)
     {
         LOGE("Invalid start (%d,%d) or goal (%d,%d) for map bounds (%d,%d) on line %d",
              startPos.x, startPos.y, goalPos.x, goalPos.y, mapLen, mapHei, __LINE__);
-        return {};
+        return;
     }
 
-    std::queue<Pos> queue;
-    std::unordered_map<Pos, Pos> parent;
-    std::unordered_map<Pos, bool> visited;
-    queue.push(startPos);
-    visited[startPos] = true;
+    if (!CRegions::isReachable(sprite, startPos, goalPos))
+        return;
+
+    // the parent of each visited cell is kept in search.best
+    search_t &search = g_search;
+    search.begin(mapLen, mapHei);
+    auto toPos = [mapLen](const int cell)
+    {
+        return Pos{static_cast<int16_t>(cell % mapLen), static_cast<int16_t>(cell / mapLen)};
+    };
 
-    while (!queue.empty())
+    const int start = search.cell(startPos);
+    search.queue.emplace_back(start);
+    search.seen[start] = search.generation;
+    for (size_t head = 0; head < search.queue.size(); ++head)
     {
-        Pos current = queue.front();
-        queue.pop();
+        const int cell = search.queue[head];
+        const Pos current = toPos(cell);
+        ++g_expansions;
 
         if (current == goalPos)
         {
-            std::vector<JoyAim> directions;
-            Pos node = current;
-            std::vector<Pos> path;
-            while (node != startPos)
-            {
-                path.push_back(node);
-                node = parent[node];
-            }
-            path.push_back(startPos);
-            std::reverse(path.begin(), path.end());
-
-            for (size_t i = 1; i < path.size(); ++i)
-            {
-                const int dx = path[i].x - path[i - 1].x;
-                const int dy = path[i].y - path[i - 1].y;
-                if (dx == 1 && dy == 0)
-                    directions.push_back(JoyAim::AIM_RIGHT);
-                else if (dx == -1 && dy == 0)
-                    directions.push_back(JoyAim::AIM_LEFT);
-                else if (dx == 0 && dy == 1)
-                    directions.push_back(JoyAim::AIM_DOWN);
-                else if (dx == 0 && dy == -1)
-                    directions.push_back(JoyAim::AIM_UP);
-                else
-                {
-                    LOGE("Invalid path transition from (%d,%d) to (%d,%d) on line %d",
-                         path[i - 1].x, path[i - 1].y, path[i].x, path[i].y, __LINE__);
-                    return {};
-                }
-            }
-            return directions;
+            for (int node = cell; node != start; node = search.best[node])
+                search.path.emplace_back(toPos(node));
+            search.path.emplace_back(startPos);
+            std::reverse(search.path.begin(), search.path.end());
+            toDirections(search.path, directions);
+            return;
         }
 
         for (size_t i = 0; i < g_deltas.size(); ++i)
         {
-            Pos newPos = {static_cast<int16_t>(current.x + g_deltas[i].x), static_cast<int16_t>(current.y + g_deltas[i].y)};
-            if (newPos.x < 0 || newPos.x >= mapLen || newPos.y < 0 || newPos.y >= mapHei || visited[newPos])
+            const Pos newPos = {static_cast<int16_t>(current.x + g_deltas[i].x), static_cast<int16_t>(current.y + g_deltas[i].y)};
+            if (newPos.x < 0 || newPos.x >= mapLen || newPos.y < 0 || newPos.y >= mapHei || search.isSeen(newPos))
                 continue;
 
-            Pos originalPos = sprite.pos();
-            sprite.move(newPos);
-            if (sprite.canMove(g_dirs[i]))
+            if (canStep(sprite, current, i))
             {
-                queue.push(newPos);
-                visited[newPos] = true;
-                parent[newPos] = current;
+                const int next = search.cell(newPos);
+                search.queue.emplace_back(next);
+                search.seen[next] = search.generation;
+                search.best[next] = cell;
             }
-            sprite.move(originalPos);
         }
     }
-    return {};
 }
 
-std::vector<JoyAim> LineOfSight::findPath(ISprite &sprite, const Pos &playerPos) const
+/**
+ * @brief Number of nodes taken off the open list by A* and BFS so far
+ *
+ * @return size_t
+ */
+size_t IPath::expansionCount()
+{
+    return g_expansions;
+}
+
+/**
+ * @brief Walk down the distance field from the sprite to the goal
+ *
+ * CPath::followPath() only takes the first step of the walk each tick.
+ *
+ * @param sprite
+ * @param playerPos goal
+ * @param directions path found; empty if the goal is out of reach
+ */
+void FlowField::findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const
+{
+    directions.clear();
+    CDistanceField &field = CDistanceField::get(sprite, playerPos);
+    Pos pos = sprite.pos();
+    for (JoyAim aim = field.descend(sprite, pos); aim != JoyAim::AIM_NONE; aim = field.descend(sprite, pos))
+    {
+        directions.emplace_back(aim);
+        pos = advance(pos, aim);
+    }
+}
+
+void LineOfSight::findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const
 {
     int granularFactor = sprite.getGranularFactor();
     const CMap &map = CGame::getMap();
     const int mapLen = map.len() * granularFactor; // Half-tile bounds
     const int mapHei = map.hei() * granularFactor;
-    const Pos startPos = sprite.pos(); // Half-tile coordinates
-    const Pos goalPos = playerPos;
+    const Pos startPos = sprite.pos();
+
+    // doors also depend on the keys held, which the map epochs do not track
+    if (sprite.type() == TYPE_PLAYER)
+    {
+        trace(sprite, startPos, playerPos, mapLen, mapHei, directions);
+        return;
+    }
+
+    const int key = movementClass(sprite);
+    const size_t hash = (((startPos.x * 31 + startPos.y) * 31 + playerPos.x) * 31 + playerPos.y) * 31 + key;
+    trace_t &cached = g_traces[hash % MAX_TRACES];
+    if (cached.key == key && cached.map == map.id() && cached.start == startPos && cached.goal == playerPos &&
+        isTraceUnchanged(sprite, startPos, playerPos, cached.epoch))
+    {
+        cached.epoch = map.passEpoch();
+        directions = cached.directions;
+        ++g_traceHits;
+        return;
+    }
+
+    trace(sprite, startPos, playerPos, mapLen, mapHei, directions);
+    cached.key = key;
+    cached.map = map.id();
+    cached.start = startPos;
+    cached.goal = playerPos;
+    cached.epoch = map.passEpoch();
+    cached.directions = directions;
+}
+
+/**
+ * @brief Check if a walk from a cell of an earlier walk toward the same goal
+ * would retrace the rest of it
+ *
+ * Each step only depends on the cell the walk stands on and on the goal,
+ * so this holds while the tiles tested between them stay the same.
+ *
+ * @param sprite
+ * @param from a cell of the earlier walk
+ * @param goal
+ * @param epoch map pass epoch of the earlier walk
+ * @return true
+ * @return false
+ */
+bool LineOfSight::retraces(const ISprite &sprite, const Pos &from, const Pos &goal, const uint32_t epoch) const
+{
+    // doors also depend on the keys held, which the map epochs do not track
+    return sprite.type() != TYPE_PLAYER && isTraceUnchanged(sprite, from, goal, epoch);
+}
+
+/**
+ * @brief Check that no tile tested by a walk changed its pass mask
+ *
+ * @param sprite
+ * @param startPos
+ * @param goalPos
+ * @param epoch map pass epoch of the walk
+ * @return true
+ * @return false
+ */
+bool LineOfSight::isTraceUnchanged(const ISprite &sprite, const Pos &startPos, const Pos &goalPos, const uint32_t epoch) const
+{
+    // the walk stays between both ends, but each step tests the move out of
+    // the cell it enters, so the tiles tested reach one cell past either end
+    const int granularFactor = sprite.getGranularFactor();
+    const Pos ext = extent(sprite);
+    const Pos topLeft{static_cast<int16_t>(std::max(std::min(startPos.x, goalPos.x) - 1, 0) / granularFactor),
+                      static_cast<int16_t>(std::max(std::min(startPos.y, goalPos.y) - 1, 0) / granularFactor)};
+    const Pos bottomRight{static_cast<int16_t>((std::max(startPos.x, goalPos.x) + 1) / granularFactor + ext.x),
+                          static_cast<int16_t>((std::max(startPos.y, goalPos.y) + 1) / granularFactor + ext.y)};
+    return CGame::getMap().isUnchangedSince(topLeft, bottomRight, epoch);
+}
+
+/**
+ * @brief Number of walks answered from the trace cache
+ *
+ * @return size_t
+ */
+size_t LineOfSight::reuseCount()
+{
+    return g_traceHits;
+}
+
+/**
+ * @brief Straight walk toward the goal on a grid of the given size
+ *
+ * @param sprite
+ * @param startPos
+ * @param goalPos
+ * @param mapLen grid width
+ * @param mapHei grid height
+ * @param directions path found; empty if the walk is blocked
+ */
+void LineOfSight::trace(const ISprite &sprite, const Pos &startPos, const Pos &goalPos, const int mapLen, const int mapHei, std::vector<JoyAim> &directions) const
+{
+    directions.clear();
 
     if (startPos.x < 0 || startPos.x >= mapLen || startPos.y < 0 || startPos.y >= mapHei ||
         goalPos.x < 0 || goalPos.x >= mapLen || goalPos.y < 0 || goalPos.y >= mapHei)
     {
         LOGE("Invalid start (%d,%d) or goal (%d,%d) for map bounds (%d,%d) on line %d",
              startPos.x, startPos.y, goalPos.x, goalPos.y, mapLen, mapHei, __LINE__);
-        return {};
+        return;
     }
 
     // Generate 4-directional path and check LOS simultaneously
-    std::vector<JoyAim> directions;
     int x = startPos.x;
     int y = startPos.y;
     const int dx = goalPos.x - startPos.x;
@@ -304,7 +643,6 @@ std::vector<JoyAim> LineOfSight::findPath(ISprite &sprite, const Pos &playerPos)
     int stepsY = std::abs(dy);
     int stepX = dx >= 0 ? 1 : -1;
     int stepY = dy >= 0 ? 1 : -1;
-    const Pos originalPos = sprite.pos();
 
     while (x != goalPos.x || y != goalPos.y)
     {
@@ -315,16 +653,14 @@ std::vector<JoyAim> LineOfSight::findPath(ISprite &sprite, const Pos &playerPos)
             Pos next = {static_cast<int16_t>(x + stepX), static_cast<int16_t>(y)};
             if (next.x >= 0 && next.x < mapLen && next.y >= 0 && next.y < mapHei)
             {
-                sprite.move(next);
                 JoyAim aim = (stepX > 0 ? AIM_RIGHT : AIM_LEFT);
-                if (sprite.canMove(aim))
+                if (sprite.canMoveFrom(next, aim))
                 {
                     directions.push_back(aim);
                     x += stepX;
                     stepsX--;
                     moved = true;
                 }
-                sprite.move(originalPos);
             }
         }
         // Then try y movement
@@ -333,27 +669,24 @@ std::vector<JoyAim> LineOfSight::findPath(ISprite &sprite, const Pos &playerPos)
             Pos next = {static_cast<int16_t>(x), static_cast<int16_t>(y + stepY)};
             if (next.x >= 0 && next.x < mapLen && next.y >= 0 && next.y < mapHei)
             {
-                const_cast<ISprite &>(sprite).move(next);
                 JoyAim aim = (stepY > 0 ? AIM_DOWN : AIM_UP);
-                if (sprite.canMove(aim))
+                if (sprite.canMoveFrom(next, aim))
                 {
                     directions.push_back(aim);
                     y += stepY;
                     stepsY--;
                     moved = true;
                 }
-                sprite.move(originalPos);
             }
         }
         if (!moved)
         {
             //     LOGE("Cannot move from (%d,%d) toward (%d,%d) on line %d",
             //        x, y, goalPos.x, goalPos.y, __LINE__);
-            return {};
+            directions.clear();
+            return;
         }
     }
-
-    return directions;
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -363,17 +696,17 @@ int AStarSmooth::manhattanDistance(const Pos &a, const Pos &b) const
     return abs(a.x - b.x) + abs(a.y - b.y);
 }
 
-std::vector<JoyAim> AStarSmooth::smoothPath(const std::vector<Pos> &path, ISprite &sprite) const
+void AStarSmooth::smoothPath(search_t &search, const ISprite &sprite, std::vector<JoyAim> &directions) const
 {
+    const std::vector<Pos> &path = search.path;
+    directions.clear();
     if (path.size() < 2)
-        return {};
-    const int granularFactor = sprite.getGranularFactor();
-    const CMap &map = CGame::getMap();
-    const int mapLen = map.len() * granularFactor; // Half-tile bounds
-    const int mapHei = map.hei() * granularFactor;
-    std::vector<Pos> smoothedPath = {path[0]};
+        return;
+    const int mapLen = search.len; // Half-tile bounds
+    const int mapHei = search.hei;
+    std::vector<Pos> &smoothedPath = search.smoothed;
+    smoothedPath.assign(1, path[0]);
 
-    LineOfSight los;
     for (size_t i = 1; i < path.size();)
     {
         size_t j = i + 1;
@@ -389,7 +722,8 @@ std::vector<JoyAim> AStarSmooth::smoothPath(const std::vector<Pos> &path, ISprit
                 break;
             }
             // Reuse LineOfSight to check if direct path is clear in half-tile space
-            if (!los.findPath(const_cast<ISprite &>(sprite), end).empty())
+            lineOfSight.trace(sprite, sprite.pos(), end, mapLen, mapHei, search.segment);
+            if (!search.segment.empty())
             {
                 j++;
             }
@@ -402,97 +736,278 @@ std::vector<JoyAim> AStarSmooth::smoothPath(const std::vector<Pos> &path, ISprit
         i = j;
     }
 
-    std::vector<JoyAim> directions;
-    for (size_t i = 1; i < smoothedPath.size(); ++i)
+    toDirections(smoothedPath, directions);
+}
+
+void AStarSmooth::findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const
+{
+    directions.clear();
+    if (!beginSearch(sprite, playerPos, g_search))
+        return;
+    int budget = std::numeric_limits<int>::max();
+    resumeSearch(sprite, g_search, budget, directions);
+}
+
+/**
+ * @brief Validate the query and open the start node
+ *
+ * @param sprite
+ * @param playerPos goal
+ * @param search
+ * @return true if there is something to search
+ * @return false if the goal is out of reach
+ */
+bool AStarSmooth::beginSearch(const ISprite &sprite, const Pos &playerPos, search_t &search) const
+{
+    if (!acceptQuery(sprite, playerPos, *this))
+        return false;
+    const int granularFactor = sprite.getGranularFactor();
+    const CMap &map = CGame::getMap();
+    openSearch(search, sprite.pos(), playerPos, map.len() * granularFactor, map.hei() * granularFactor);
+    return true;
+}
+
+/**
+ * @brief Expand nodes until the goal is reached or the budget runs out
+ *
+ * @param sprite
+ * @param search state left by beginSearch() or a previous call
+ * @param budget node expansions allowed; decremented for each one
+ * @param directions path found; empty if there is none
+ * @return true if the search is complete
+ * @return false if it must be resumed later
+ */
+bool AStarSmooth::resumeSearch(const ISprite &sprite, search_t &search, int &budget, std::vector<JoyAim> &directions) const
+{
+    const int mapLen = search.len;
+    const int mapHei = search.hei;
+    const Pos goalPos = search.goal;
+    directions.clear();
+
+    while (!search.heap.empty())
     {
-        const int dx = smoothedPath[i].x - smoothedPath[i - 1].x;
-        const int dy = smoothedPath[i].y - smoothedPath[i - 1].y;
-        if (dx == 1 && dy == 0)
-            directions.push_back(JoyAim::AIM_RIGHT);
-        else if (dx == -1 && dy == 0)
-            directions.push_back(JoyAim::AIM_LEFT);
-        else if (dx == 0 && dy == 1)
-            directions.push_back(JoyAim::AIM_DOWN);
-        else if (dx == 0 && dy == -1)
-            directions.push_back(JoyAim::AIM_UP);
-        else
+        if (budget <= 0)
+            return false;
+        --budget;
+        const int current = search.pop();
+        const node_t node = search.nodes[current];
+
+        if (node.pos == goalPos)
         {
-            LOGE("Invalid smoothed path transition from (%d,%d) to (%d,%d) on line %d",
-                 smoothedPath[i - 1].x, smoothedPath[i - 1].y, smoothedPath[i].x, smoothedPath[i].y, __LINE__);
-            return {};
+            search.trace(current);
+            smoothPath(search, sprite, directions); // Apply smoothing
+            return true;
+        }
+
+        search.close(node.pos);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const Pos newPos = {static_cast<int16_t>(node.pos.x + g_deltas[i].x), static_cast<int16_t>(node.pos.y + g_deltas[i].y)};
+            if (newPos.x < 0 || newPos.x >= mapLen || newPos.y < 0 || newPos.y >= mapHei || search.isClosed(newPos))
+                continue;
+
+            if (!canStep(sprite, node.pos, i))
+                continue;
+
+            const int newGCost = node.gCost + 1;
+            const int best = search.find(newPos);
+            if (best == NO_NODE || newGCost < search.nodes[best].gCost)
+                search.open(newPos, newGCost, manhattanDistance(newPos, goalPos), current);
         }
     }
-    return directions;
+    return true;
 }
 
-std::vector<JoyAim> AStarSmooth::findPath(ISprite &sprite, const Pos &playerPos) const
+/////////////////////////////////////////////////////////////////////
+
+int JPS::manhattanDistance(const Pos &a, const Pos &b) const
 {
-    const int granularFactor = sprite.getGranularFactor();
-    const CMap &map = CGame::getMap();
-    const int mapLen = map.len() * granularFactor; // Half-tile bounds
-    const int mapHei = map.hei() * granularFactor;
-    const Pos startPos = sprite.pos(); // Half-tile coordinates
-    const Pos goalPos = playerPos;
+    return abs(a.x - b.x) + abs(a.y - b.y);
+}
 
-    if (startPos.x < 0 || startPos.x >= mapLen || startPos.y < 0 || startPos.y >= mapHei ||
-        goalPos.x < 0 || goalPos.x >= mapLen || goalPos.y < 0 || goalPos.y >= mapHei)
+/**
+ * @brief Check a move of the jump point search
+ *
+ * Unlike the other searches, JPS tests the move the sprite makes: its
+ * pruning rules only hold when a step depends on the cells it joins, and
+ * no recording predates it.
+ *
+ * @param search
+ * @param sprite
+ * @param pos cell left
+ * @param dir index into g_deltas
+ * @return true
+ * @return false
+ */
+bool JPS::isOpen(const search_t &search, const ISprite &sprite, const Pos &pos, const size_t dir) const
+{
+    const int x = pos.x + g_deltas[dir].x;
+    const int y = pos.y + g_deltas[dir].y;
+    return x >= 0 && x < search.len &&
+           y >= 0 && y < search.hei &&
+           sprite.canMoveFrom(pos, g_stepAims[dir]);
+}
+
+/**
+ * @brief Run in a straight line until the next jump point
+ *
+ * Horizontal runs stop at the goal or next to an opening that the previous
+ * cell did not have. Vertical runs also stop wherever a horizontal run
+ * started from the current cell would find a jump point.
+ *
+ * Every cell crossed by a run leads to the same jump point in that
+ * direction, so the outcome is recorded for all of them and later runs
+ * through these cells during the same search end at once.
+ *
+ * @param search
+ * @param sprite
+ * @param pos starting cell; the jump point when one is found
+ * @param dir index into g_deltas
+ * @return true if a jump point was found
+ */
+bool JPS::jump(search_t &search, const ISprite &sprite, Pos &pos, const size_t dir) const
+{
+    const Pos &goal = search.goal;
+    auto slot = [&search, dir](const Pos &cell)
     {
-        LOGE("Invalid start (%d,%d) or goal (%d,%d) for map bounds (%d,%d) on line %d",
-             startPos.x, startPos.y, goalPos.x, goalPos.y, mapLen, mapHei, __LINE__);
-        return {};
+        return static_cast<size_t>(search.cell(cell)) * g_deltas.size() + dir;
+    };
+
+    const bool isHorizontal = dir < 2;
+    const size_t mark = search.run.size();
+    int found = NO_NODE;
+    Pos current = pos;
+    for (;;)
+    {
+        const size_t i = slot(current);
+        if (search.jumped[i] == search.generation)
+        {
+            found = search.jumps[i];
+            break;
+        }
+        search.run.emplace_back(search.cell(current));
+        if (!isOpen(search, sprite, current, dir))
+            break;
+
+        const Pos next{static_cast<int16_t>(current.x + g_deltas[dir].x),
+                       static_cast<int16_t>(current.y + g_deltas[dir].y)};
+        bool isJumpPoint = next == goal;
+        if (isHorizontal)
+        {
+            for (size_t turn = 2; turn < 4 && !isJumpPoint; ++turn)
+                isJumpPoint = isOpen(search, sprite, next, turn) && !isOpen(search, sprite, current, turn);
+        }
+        else
+        {
+            for (size_t turn = 0; turn < 2 && !isJumpPoint; ++turn)
+            {
+                Pos probe = next;
+                isJumpPoint = jump(search, sprite, probe, turn);
+            }
+        }
+        if (isJumpPoint)
+        {
+            found = search.cell(next);
+            break;
+        }
+        current = next;
     }
 
-    std::priority_queue<Node *, std::vector<Node *>, CompareNode> openList;
-    std::unordered_map<Pos, std::unique_ptr<Node>> nodes;
-    std::unordered_map<Pos, bool> closedList;
+    for (size_t i = mark; i < search.run.size(); ++i)
+    {
+        const size_t j = static_cast<size_t>(search.run[i]) * g_deltas.size() + dir;
+        search.jumped[j] = search.generation;
+        search.jumps[j] = found;
+    }
+    search.run.resize(mark);
+    if (found == NO_NODE)
+        return false;
+    pos = Pos{static_cast<int16_t>(found % search.len), static_cast<int16_t>(found / search.len)};
+    return true;
+}
 
-    nodes[startPos] = std::make_unique<Node>(startPos, 0, manhattanDistance(startPos, goalPos), nullptr);
-    openList.push(nodes[startPos].get());
+void JPS::findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const
+{
+    directions.clear();
+    if (!beginSearch(sprite, playerPos, g_search))
+        return;
+    int budget = std::numeric_limits<int>::max();
+    resumeSearch(sprite, g_search, budget, directions);
+}
 
-    while (!openList.empty())
-    {
-        Node *current = openList.top();
-        openList.pop();
+bool JPS::beginSearch(const ISprite &sprite, const Pos &playerPos, search_t &search) const
+{
+    if (!acceptQuery(sprite, playerPos, *this))
+        return false;
+    const int granularFactor = sprite.getGranularFactor();
+    const CMap &map = CGame::getMap();
+    openSearch(search, sprite.pos(), playerPos, map.len() * granularFactor, map.hei() * granularFactor);
+    return true;
+}
+
+bool JPS::resumeSearch(const ISprite &sprite, search_t &search, int &budget, std::vector<JoyAim> &directions) const
+{
+    const Pos goalPos = search.goal;
+    directions.clear();
 
-        if (current->pos == goalPos)
+    while (!search.heap.empty())
+    {
+        if (budget <= 0)
+            return false;
+        --budget;
+        const int current = search.pop();
+        const node_t node = search.nodes[current];
+        if (search.isClosed(node.pos))
+            continue;
+
+        if (node.pos == goalPos)
         {
-            std::vector<Pos> path;
-            Node *node = current;
-            while (node != nullptr)
+            // fill in the cells between the jump points
+            search.trace(current);
+            std::vector<Pos> &steps = search.smoothed;
+            steps.assign(1, search.path[0]);
+            for (size_t i = 1; i < search.path.size(); ++i)
             {
-                path.push_back(node->pos);
-                node = node->parent;
+                const Pos &target = search.path[i];
+                while (steps.back() != target)
+                {
+                    const Pos &last = steps.back();
+                    steps.emplace_back(Pos{static_cast<int16_t>(last.x + (target.x > last.x) - (target.x < last.x)),
+                                           static_cast<int16_t>(last.y + (target.y > last.y) - (target.y < last.y))});
+                }
             }
-            std::reverse(path.begin(), path.end());
-            return smoothPath(path, sprite); // Apply smoothing
+            toDirections(steps, directions);
+            return true;
         }
 
-        closedList[current->pos] = true;
+        search.close(node.pos);
 
-        for (int i = 0; i < 4; ++i)
+        // never turn back the way we came
+        size_t reverse = g_deltas.size();
+        if (node.parent != NO_NODE)
         {
-            const Pos newPos = {static_cast<int16_t>(current->pos.x + g_deltas[i].x), static_cast<int16_t>(current->pos.y + g_deltas[i].y)};
-            if (newPos.x < 0 || newPos.x >= mapLen || newPos.y < 0 || newPos.y >= mapHei || closedList[newPos])
-                continue;
+            const Pos &from = search.nodes[node.parent].pos;
+            const size_t arrival = node.pos.x < from.x   ? 0
+                                   : node.pos.x > from.x ? 1
+                                   : node.pos.y < from.y ? 2
+                                                         : 3;
+            reverse = arrival ^ 1;
+        }
 
-            const Pos originalPos = sprite.pos();
-            const_cast<ISprite &>(sprite).move(newPos);
-            if (!sprite.canMove(g_dirs[i]))
-            {
-                sprite.move(originalPos);
+        for (size_t i = 0; i < g_deltas.size(); ++i)
+        {
+            Pos jumpPos = node.pos;
+            if (i == reverse || !jump(search, sprite, jumpPos, i) || search.isClosed(jumpPos))
                 continue;
-            }
-            sprite.move(originalPos);
 
-            int newGCost = current->gCost + 1;
-            if (!nodes[newPos] || newGCost < nodes[newPos]->gCost)
-            {
-                nodes[newPos] = std::make_unique<Node>(newPos, newGCost, manhattanDistance(newPos, goalPos), current);
-                openList.push(nodes[newPos].get());
-            }
+            const int newGCost = node.gCost + manhattanDistance(node.pos, jumpPos);
+            const int best = search.find(jumpPos);
+            if (best == NO_NODE || newGCost < search.nodes[best].gCost)
+                search.open(jumpPos, newGCost, manhattanDistance(jumpPos, goalPos), current);
         }
     }
-    return {};
+    return true;
 }
 
 ////////////////////////////////////////////////
@@ -504,11 +1019,60 @@ CPath::Result CPath::followPath(ISprite &sprite, const Pos &playerPos, const IPa
              playerPos.x, playerPos.y,
              m_pathIndex, m_pathTimeout, m_cachedDirections.size(), sprite.getTTL());
 
+    if (astar.usesDistanceField())
+    {
+        // step down the field shared with the other chasers
+        const JoyAim aim = CDistanceField::get(sprite, playerPos).descend(sprite);
+        if (aim == JoyAim::AIM_NONE)
+            return Result::NoValidPath;
+        sprite.setAim(aim);
+        if (!sprite.canMove(aim))
+            return Result::Blocked;
+        step(sprite, aim);
+        return Result::MoveSuccesful;
+    }
+
+    bool isFresh = false;
+    if (astar.isResumable())
+    {
+        // the previous path is followed until the new one is ready
+        bool queued = false;
+        if (!isSearching())
+        {
+            isFresh = isCurrent(sprite, playerPos);
+            if (isFresh)
+                ++g_hits;
+            else if (startSearch(sprite, playerPos, astar))
+                ++g_misses;
+            else
+                queued = true;
+        }
+        if (m_search != NO_SEARCH)
+            resumeSearch(sprite, astar);
+        isFresh = isFresh || (!isSearching() && isCurrent(sprite, playerPos));
+        if (m_pathIndex >= m_cachedDirections.size())
+        {
+            if (queued || isSearching())
+                return Result::Searching;
+            if (!sprite.isBoss())
+                LOGI("sprite: %p -- path empty", &sprite);
+            return Result::NoValidPath; // No valid path
+        }
+    }
     // Check if path is invalid or timed out
-    if (m_pathIndex >= m_cachedDirections.size() || m_pathTimeout <= 0)
+    else if (m_pathIndex >= m_cachedDirections.size() || m_pathTimeout <= 0)
     {
-        m_cachedDirections = astar.findPath(sprite, playerPos);
-        m_pathIndex = 0;
+        if (isRetraced(sprite, playerPos, astar))
+            ++g_hits;
+        else
+        {
+            ++g_misses;
+            astar.findPath(sprite, playerPos, m_cachedDirections);
+            m_pathIndex = 0;
+            m_origin = sprite.pos();
+            m_goal = playerPos;
+            m_epoch = CGame::getMap().passEpoch();
+        }
         if (!m_pathTimeout)
             m_pathTimeout = PATH_TIMEOUT_MAX;
         if (m_cachedDirections.empty())
@@ -524,16 +1088,13 @@ CPath::Result CPath::followPath(ISprite &sprite, const Pos &playerPos, const IPa
     sprite.setAim(aim);
     if (sprite.canMove(aim))
     {
-        if (sprite.isBoss())
-        {
-            sprite.move(aim);
-        }
-        else
-        {
-            CGame::getGame()->shadowActorMove(*static_cast<CActor *>(&sprite), aim);
-        }
+        step(sprite, aim);
         ++m_pathIndex;
-        --m_pathTimeout;
+        if (m_pathTimeout)
+            --m_pathTimeout;
+        // the sprite's own move does not make a resumable path stale
+        if (isFresh)
+            m_epoch = CGame::getMap().passEpoch();
         return Result::MoveSuccesful;
     }
 
@@ -543,9 +1104,313 @@ CPath::Result CPath::followPath(ISprite &sprite, const Pos &playerPos, const IPa
     m_cachedDirections.clear();
     m_pathIndex = 0;
     m_pathTimeout = 0;
+    invalidate();
     return Result::Blocked;
 }
 
+void CPath::step(ISprite &sprite, const JoyAim aim)
+{
+    if (sprite.isBoss() || CGame::isBulletType(sprite.type()))
+    {
+        // not tracked by the monster grid
+        sprite.move(aim);
+    }
+    else
+    {
+        CGame::current().shadowActorMove(*static_cast<CActor *>(&sprite), aim);
+    }
+}
+
+/**
+ * @brief Start a resumable search in a free job slot
+ *
+ * A query that cannot be searched, e.g. a goal out of reach, ends at once
+ * with an empty path.
+ *
+ * @param sprite
+ * @param playerPos goal
+ * @param astar
+ * @return false if every slot is taken; the caller asks again later
+ */
+bool CPath::startSearch(const ISprite &sprite, const Pos &playerPos, const IPath &astar)
+{
+    for (size_t i = 0; i < g_jobs.size(); ++i)
+    {
+        job_t &job = g_jobs[i];
+        if (job.owner)
+            continue;
+        if (!astar.beginSearch(sprite, playerPos, job.search))
+        {
+            g_found.clear();
+            adopt(sprite, sprite.pos(), playerPos, CGame::getMap().passEpoch(), g_found);
+            return true;
+        }
+        job.owner = this;
+        job.origin = sprite.pos();
+        job.epoch = CGame::getMap().passEpoch();
+        job.tick = 0;
+        m_search = static_cast<int>(i);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Run the search in progress for its share of this tick's budget
+ *
+ * @param sprite
+ * @param astar
+ */
+void CPath::resumeSearch(const ISprite &sprite, const IPath &astar)
+{
+    job_t &job = g_jobs[m_search];
+    int waiting = 0;
+    for (const auto &other : g_jobs)
+        waiting += other.owner && other.tick != g_tick;
+    const int share = g_budget / std::max(waiting, 1);
+    int budget = share;
+    job.tick = g_tick;
+    const bool done = astar.resumeSearch(sprite, job.search, budget, g_found);
+    g_budget -= share - budget;
+    if (!done)
+        return;
+    const Pos origin = job.origin;
+    const Pos goal = job.search.goal;
+    const uint32_t epoch = job.epoch;
+    release();
+    adopt(sprite, origin, goal, epoch, g_found);
+}
+
+/**
+ * @brief Take over the path found by a search
+ *
+ * The sprite may have walked along its previous path while the search was
+ * running. The new path is picked up where the sprite stands. If the sprite
+ * is not on it, or if the map changed and the rest of the path is blocked,
+ * the previous path is kept and a new search is started.
+ *
+ * @param sprite
+ * @param origin sprite position when the search started
+ * @param goal
+ * @param epoch map pass epoch when the search started
+ * @param directions path found from the origin
+ */
+void CPath::adopt(const ISprite &sprite, const Pos &origin, const Pos &goal, const uint32_t epoch, const std::vector<JoyAim> &directions)
+{
+    const size_t first = stepsTo(origin, sprite.pos(), directions);
+    if (first > directions.size())
+    {
+        invalidate();
+        return;
+    }
+    if (epoch != CGame::getMap().passEpoch())
+    {
+        Pos pos = sprite.pos();
+        for (size_t i = first; i < directions.size(); ++i)
+        {
+            if (!sprite.canMoveFrom(pos, directions[i]))
+            {
+                invalidate();
+                return;
+            }
+            pos = advance(pos, directions[i]);
+        }
+    }
+    m_cachedDirections.assign(directions.begin() + first, directions.end());
+    m_pathIndex = 0;
+    stamp(sprite, goal, CGame::getMap().passEpoch());
+}
+
+/**
+ * @brief Record what the cached path depends on
+ *
+ * The path stays valid until the goal moves away or a tile changes its
+ * pass mask in one of the epoch blocks around the rest of the path.
+ *
+ * @param sprite
+ * @param goal
+ * @param epoch map pass epoch the path was checked against
+ */
+void CPath::stamp(const ISprite &sprite, const Pos &goal, const uint32_t epoch)
+{
+    const CMap &map = CGame::getMap();
+    const int granularFactor = sprite.getGranularFactor();
+    const Pos footprint = extent(sprite);
+    m_goal = goal;
+    m_epoch = epoch;
+    m_blocks.clear();
+    auto cover = [&](const Pos &pos)
+    {
+        // tiles tested by the moves out of this cell
+        const int x = pos.x / granularFactor;
+        const int y = pos.y / granularFactor;
+        for (const int tx : {x - 1, x + footprint.x})
+            for (const int ty : {y - 1, y + footprint.y})
+            {
+                const int block = map.blockOf(std::clamp(tx, 0, map.len() - 1), std::clamp(ty, 0, map.hei() - 1));
+                if (block != -1 && (m_blocks.empty() || m_blocks.back() != block))
+                    m_blocks.emplace_back(block);
+            }
+    };
+    Pos pos = sprite.pos();
+    cover(pos);
+    for (size_t i = m_pathIndex; i < m_cachedDirections.size(); ++i)
+    {
+        pos = advance(pos, m_cachedDirections[i]);
+        cover(pos);
+    }
+    std::sort(m_blocks.begin(), m_blocks.end());
+    m_blocks.erase(std::unique(m_blocks.begin(), m_blocks.end()), m_blocks.end());
+}
+
+/**
+ * @brief Check if the cached path can be followed without a new search
+ *
+ * @param sprite
+ * @param goal
+ * @return true
+ * @return false
+ */
+bool CPath::isCurrent(const ISprite &sprite, const Pos &goal) const
+{
+    if (m_epoch == NO_EPOCH || m_pathIndex >= m_cachedDirections.size())
+        return false;
+    const int tolerance = GOAL_TOLERANCE * sprite.getGranularFactor();
+    if (std::abs(goal.x - m_goal.x) + std::abs(goal.y - m_goal.y) > tolerance)
+        return false;
+    return isUnchanged();
+}
+
+/**
+ * @brief Check if a new search would only give the rest of the cached path
+ *
+ * @param sprite
+ * @param goal
+ * @param astar
+ * @return true if the search can be skipped
+ * @return false
+ */
+bool CPath::isRetraced(const ISprite &sprite, const Pos &goal, const IPath &astar) const
+{
+    if (m_epoch == NO_EPOCH || m_pathIndex >= m_cachedDirections.size() || goal != m_goal)
+        return false;
+    // the sprite may have been moved off its path
+    if (stepsTo(m_origin, sprite.pos(), m_cachedDirections) != m_pathIndex)
+        return false;
+    return astar.retraces(sprite, sprite.pos(), goal, m_epoch);
+}
+
+/**
+ * @brief Check that no tile along the path changed its pass mask since
+ * the path was last checked
+ *
+ * @return true
+ * @return false
+ */
+bool CPath::isUnchanged() const
+{
+    if (m_epoch == NO_EPOCH)
+        return false;
+    const CMap &map = CGame::getMap();
+    if (map.passEpoch() == m_epoch)
+        return true;
+    for (const int block : m_blocks)
+        if (map.blockEpoch(block) > m_epoch)
+            return false;
+    return true;
+}
+
+/**
+ * @brief Have the path recomputed on the next call to followPath()
+ *
+ */
+void CPath::invalidate()
+{
+    m_epoch = NO_EPOCH;
+}
+
+/**
+ * @brief Give up the search in progress, if any
+ *
+ */
+void CPath::release()
+{
+    if (m_search != NO_SEARCH && g_jobs[m_search].owner == this)
+        g_jobs[m_search].owner = nullptr;
+    m_search = NO_SEARCH;
+}
+
+bool CPath::isSearching() const
+{
+    return m_search != NO_SEARCH;
+}
+
+/**
+ * @brief Refill the node budget shared by the searches
+ *
+ */
+void CPath::beginTick()
+{
+    ++g_tick;
+    g_budget = g_nodeBudget;
+}
+
+/**
+ * @brief Number of steps taken on a cached path that was still current
+ *
+ * @return size_t
+ */
+size_t CPath::hitCount()
+{
+    return g_hits;
+}
+
+/**
+ * @brief Number of paths computed again
+ *
+ * @return size_t
+ */
+size_t CPath::missCount()
+{
+    return g_misses;
+}
+
+void CPath::resetCounters()
+{
+    g_hits = 0;
+    g_misses = 0;
+}
+
+/**
+ * @brief Change the number of node expansions allowed per tick
+ *
+ * @param nodes
+ */
+void CPath::setNodeBudget(const int nodes)
+{
+    g_nodeBudget = std::max(nodes, 1);
+}
+
+/**
+ * @brief Node expansions left for this tick
+ *
+ * @return int
+ */
+int CPath::budgetLeft()
+{
+    return g_budget;
+}
+
+/**
+ * @brief Read the path of a saved game
+ *
+ * A path read back is searched again at the same step as in the game that
+ * was saved; only the search itself cannot be skipped the first time.
+ *
+ * @param sfile
+ * @return true
+ * @return false
+ */
 bool CPath::read(IFile &sfile)
 {
     auto readfile = [&sfile](auto ptr, auto size) -> bool
@@ -592,6 +1457,7 @@ bool CPath::read(IFile &sfile)
     constexpr size_t DATA_SIZE = 2;
     //////////////////////////////////////
     // Read Path (saved)
+    release();
     m_cachedDirections.clear();
     size_t pathSize = 0;
     _R(&pathSize, DATA_SIZE);
@@ -607,7 +1473,8 @@ bool CPath::read(IFile &sfile)
     checkBound(m_pathIndex, MAX_PATH_SIZE);
     m_pathTimeout = 0;
     _R(&m_pathTimeout, DATA_SIZE);
-    checkBound(m_pathTimeout, MAX_PATH_SIZE);
+    invalidate();
+    m_blocks.clear();
 
     return true;
 }
@@ -638,6 +1505,71 @@ CPath::CPath()
     m_pathTimeout = 0;
 }
 
+CPath::CPath(const CPath &other) : m_cachedDirections(other.m_cachedDirections),
+                                   m_pathIndex(other.m_pathIndex),
+                                   m_pathTimeout(other.m_pathTimeout),
+                                   m_origin(other.m_origin),
+                                   m_epoch(other.m_epoch),
+                                   m_goal(other.m_goal),
+                                   m_blocks(other.m_blocks)
+{
+}
+
+CPath::CPath(CPath &&other) noexcept : m_cachedDirections(std::move(other.m_cachedDirections)),
+                                       m_pathIndex(other.m_pathIndex),
+                                       m_pathTimeout(other.m_pathTimeout),
+                                       m_origin(other.m_origin),
+                                       m_epoch(other.m_epoch),
+                                       m_goal(other.m_goal),
+                                       m_blocks(std::move(other.m_blocks)),
+                                       m_search(other.m_search)
+{
+    if (m_search != NO_SEARCH)
+        g_jobs[m_search].owner = this;
+    other.m_search = NO_SEARCH;
+}
+
+CPath &CPath::operator=(const CPath &other)
+{
+    if (this != &other)
+    {
+        release();
+        m_cachedDirections = other.m_cachedDirections;
+        m_pathIndex = other.m_pathIndex;
+        m_pathTimeout = other.m_pathTimeout;
+        m_origin = other.m_origin;
+        m_epoch = other.m_epoch;
+        m_goal = other.m_goal;
+        m_blocks = other.m_blocks;
+    }
+    return *this;
+}
+
+CPath &CPath::operator=(CPath &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_cachedDirections = std::move(other.m_cachedDirections);
+        m_pathIndex = other.m_pathIndex;
+        m_pathTimeout = other.m_pathTimeout;
+        m_origin = other.m_origin;
+        m_epoch = other.m_epoch;
+        m_goal = other.m_goal;
+        m_blocks = std::move(other.m_blocks);
+        m_search = other.m_search;
+        if (m_search != NO_SEARCH)
+            g_jobs[m_search].owner = this;
+        other.m_search = NO_SEARCH;
+    }
+    return *this;
+}
+
+CPath::~CPath()
+{
+    release();
+}
+
 const IPath *CPath::getPathAlgo(const uint8_t algo)
 {
     if (algo == BossData::ASTAR)
@@ -656,6 +1588,14 @@ const IPath *CPath::getPathAlgo(const uint8_t algo)
     {
         return &PathData::aStarSmooth;
     }
+    else if (algo == BossData::JPS)
+    {
+        return &PathData::jps;
+    }
+    else if (algo == BossData::FIELD)
+    {
+        return &PathData::flowField;
+    }
     else
     {
         LOGE("unsupported ai algo: %u", algo);
@@ -663,7 +1603,462 @@ const IPath *CPath::getPathAlgo(const uint8_t algo)
     }
 }
 
-void CPath::setTimeout(int timeout)
+////////////////////////////////////////////////
+
+/**
+ * @brief Discard all the distance fields, they are rebuilt on demand
+ *
+ */
+void CDistanceField::invalidate()
 {
-    m_pathTimeout = timeout;
-}
\ No newline at end of file
+    if (++g_fieldGeneration == 0)
+        g_fieldGeneration = 1;
+}
+
+/**
+ * @brief Distance field toward a goal for the movement class of a sprite
+ *
+ * @param sprite chaser
+ * @param goal goal in the sprite's coordinates
+ * @return CDistanceField&
+ */
+CDistanceField &CDistanceField::get(const ISprite &sprite, const Pos &goal)
+{
+    const int key = movementClass(sprite);
+    const CMap &map = CGame::getMap();
+    const int granularFactor = sprite.getGranularFactor();
+    const int len = map.len() * granularFactor;
+    const int hei = map.hei() * granularFactor;
+
+    // reuse the field of this class or replace the least recently used one
+    CDistanceField *field = &g_fields[0];
+    for (auto &candidate : g_fields)
+    {
+        if (candidate.m_key == key)
+        {
+            field = &candidate;
+            break;
+        }
+        if (candidate.m_lastUse < field->m_lastUse)
+            field = &candidate;
+    }
+    field->m_lastUse = ++g_fieldClock;
+    if (field->m_key != key || field->m_map != map.id() || field->m_goal != goal ||
+        field->m_len != len || field->m_hei != hei ||
+        field->m_generation != g_fieldGeneration)
+        field->reset(key, goal, len, hei);
+    return *field;
+}
+
+/**
+ * @brief Number of fields built so far
+ *
+ * @return size_t
+ */
+size_t CDistanceField::buildCount()
+{
+    return g_fieldBuilds;
+}
+
+/**
+ * @brief Number of steps from a cell to the goal
+ *
+ * @param sprite chaser used to test passability
+ * @param pos cell
+ * @return int distance or UNREACHED
+ */
+int CDistanceField::distance(const ISprite &sprite, const Pos &pos)
+{
+    if (!isValid(pos))
+        return UNREACHED;
+    const int target = pos.x + pos.y * m_len;
+    while (!isLabeled(target) && m_head < m_queue.size())
+        expand(sprite, m_queue[m_head++]);
+    return isLabeled(target) ? m_dist[target] : UNREACHED;
+}
+
+/**
+ * @brief Direction that brings the sprite one step closer to the goal
+ *
+ * Neighbours are tried in the same order and with the same passability test
+ * as the path searches.
+ *
+ * @param sprite chaser
+ * @return JoyAim or AIM_NONE if the goal is reached or out of reach
+ */
+JoyAim CDistanceField::descend(const ISprite &sprite)
+{
+    return descend(sprite, sprite.pos());
+}
+
+/**
+ * @brief Direction that brings a cell one step closer to the goal
+ *
+ * @param sprite chaser used to test passability
+ * @param pos cell
+ * @return JoyAim or AIM_NONE if the goal is reached or out of reach
+ */
+JoyAim CDistanceField::descend(const ISprite &sprite, const Pos &pos)
+{
+    const int dist = distance(sprite, pos);
+    if (dist == UNREACHED || dist == 0)
+        return JoyAim::AIM_NONE;
+
+    for (size_t i = 0; i < g_deltas.size(); ++i)
+    {
+        const Pos next{static_cast<int16_t>(pos.x + g_deltas[i].x),
+                       static_cast<int16_t>(pos.y + g_deltas[i].y)};
+        if (!isValid(next))
+            continue;
+        const int cell = next.x + next.y * m_len;
+        if (isLabeled(cell) && m_dist[cell] == dist - 1 &&
+            canStep(sprite, pos, i))
+            return g_stepAims[i];
+    }
+    return JoyAim::AIM_NONE;
+}
+
+void CDistanceField::reset(const int key, const Pos &goal, const int len, const int hei)
+{
+    m_key = key;
+    m_map = CGame::getMap().id();
+    m_goal = goal;
+    m_len = len;
+    m_hei = hei;
+    m_generation = g_fieldGeneration;
+    const size_t cells = static_cast<size_t>(len) * hei;
+    if (m_seen.size() < cells)
+    {
+        m_seen.assign(cells, 0);
+        m_dist.resize(cells);
+        m_stamp = 0;
+    }
+    if (++m_stamp == 0)
+    {
+        // stamps wrapped around
+        std::fill(m_seen.begin(), m_seen.end(), 0);
+        m_stamp = 1;
+    }
+    m_queue.clear();
+    m_head = 0;
+    ++g_fieldBuilds;
+    if (isValid(goal))
+        label(goal.x + goal.y * len, 0);
+}
+
+void CDistanceField::label(const int cell, const int dist)
+{
+    m_seen[cell] = m_stamp;
+    m_dist[cell] = dist;
+    m_queue.emplace_back(cell);
+}
+
+/**
+ * @brief Label the unvisited cells that can step into a labeled cell
+ *
+ * @param sprite chaser used to test passability
+ * @param cell
+ */
+void CDistanceField::expand(const ISprite &sprite, const int cell)
+{
+    const Pos pos{static_cast<int16_t>(cell % m_len), static_cast<int16_t>(cell / m_len)};
+    for (size_t i = 0; i < g_deltas.size(); ++i)
+    {
+        const Pos prev{static_cast<int16_t>(pos.x - g_deltas[i].x),
+                       static_cast<int16_t>(pos.y - g_deltas[i].y)};
+        if (!isValid(prev))
+            continue;
+        const int prevCell = prev.x + prev.y * m_len;
+        if (!isLabeled(prevCell) && canStep(sprite, prev, i))
+            label(prevCell, m_dist[cell] + 1);
+    }
+}
+
+bool CDistanceField::isValid(const Pos &pos) const
+{
+    return pos.x >= 0 && pos.x < m_len && pos.y >= 0 && pos.y < m_hei;
+}
+
+////////////////////////////////////////////////
+
+/**
+ * @brief Connectivity labels for the movement class of a sprite
+ *
+ * @param sprite
+ * @return CRegions&
+ */
+CRegions &CRegions::get(const ISprite &sprite)
+{
+    const int key = movementClass(sprite);
+    const CMap &map = CGame::getMap();
+    const int granularFactor = sprite.getGranularFactor();
+    const int len = map.len() * granularFactor;
+    const int hei = map.hei() * granularFactor;
+
+    CRegions *regions = &g_regions[0];
+    for (auto &candidate : g_regions)
+    {
+        if (candidate.m_key == key)
+        {
+            regions = &candidate;
+            break;
+        }
+        if (candidate.m_lastUse < regions->m_lastUse)
+            regions = &candidate;
+    }
+    regions->m_lastUse = ++g_regionClock;
+    if (regions->m_key != key || regions->m_map != map.id() || regions->m_len != len || regions->m_hei != hei)
+        regions->build(sprite, key, len, hei);
+    else
+        regions->sync(sprite);
+    return *regions;
+}
+
+/**
+ * @brief Check if a path could join two cells; unreachable goals are counted
+ *
+ * @param sprite chaser
+ * @param from
+ * @param to
+ * @return true
+ * @return false
+ */
+bool CRegions::isReachable(const ISprite &sprite, const Pos &from, const Pos &to)
+{
+    if (get(sprite).canReach(from, to))
+        return true;
+    ++g_rejects;
+    return false;
+}
+
+/**
+ * @brief Number of path queries rejected because the goal was out of reach
+ *
+ * @return size_t
+ */
+size_t CRegions::rejectCount()
+{
+    return g_rejects;
+}
+
+size_t CRegions::buildCount()
+{
+    return g_regionBuilds;
+}
+
+/**
+ * @brief Check if a cell could lead to another
+ *
+ * Labels without one-way exits are closed. From the others, the exits are
+ * followed label by label, so dead ends such as map corners do not open
+ * a sealed area.
+ *
+ * @param from
+ * @param to
+ * @return true if a chain of labels joins them
+ * @return false if no path joins them
+ */
+bool CRegions::canReach(const Pos &from, const Pos &to)
+{
+    if (!isValid(from) || !isValid(to))
+        return false;
+    const int root = find(from.x + from.y * m_len);
+    const int goal = find(to.x + to.y * m_len);
+    if (root == goal)
+        return true;
+    if (!m_leaky[root])
+        return false;
+    if (!m_indexed)
+        index();
+
+    if (++m_stamp == 0)
+    {
+        std::fill(m_seen.begin(), m_seen.end(), 0);
+        m_stamp = 1;
+    }
+    m_queue.clear();
+    m_queue.push_back(root);
+    m_seen[root] = m_stamp;
+    for (size_t i = 0; i < m_queue.size(); ++i)
+    {
+        const int label = m_queue[i];
+        auto link = std::lower_bound(m_links.begin(), m_links.end(), std::make_pair(label, 0));
+        for (; link != m_links.end() && link->first == label; ++link)
+        {
+            const int next = link->second;
+            if (next == goal)
+                return true;
+            if (m_seen[next] != m_stamp)
+            {
+                m_seen[next] = m_stamp;
+                m_queue.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Sort the one-way exits by the label they leave
+ *
+ * Exits made stale by merged labels are dropped on the way.
+ *
+ */
+void CRegions::index()
+{
+    std::sort(m_exits.begin(), m_exits.end());
+    m_exits.erase(std::unique(m_exits.begin(), m_exits.end()), m_exits.end());
+    m_links.clear();
+    size_t kept = 0;
+    for (const auto &exit : m_exits)
+    {
+        const int from = find(exit.first);
+        const int to = find(exit.second);
+        if (from == to)
+            continue;
+        m_exits[kept++] = exit;
+        m_links.emplace_back(from, to);
+    }
+    m_exits.resize(kept);
+    std::sort(m_links.begin(), m_links.end());
+    m_links.erase(std::unique(m_links.begin(), m_links.end()), m_links.end());
+    m_seen.resize(m_parent.size(), 0);
+    m_indexed = true;
+}
+
+void CRegions::build(const ISprite &sprite, const int key, const int len, const int hei)
+{
+    m_key = key;
+    m_map = CGame::getMap().id();
+    m_len = len;
+    m_hei = hei;
+    m_granularFactor = sprite.getGranularFactor();
+    const Pos footprint = extent(sprite);
+    m_extentX = footprint.x;
+    m_extentY = footprint.y;
+
+    const size_t cells = static_cast<size_t>(len) * hei;
+    m_parent.resize(cells);
+    for (size_t i = 0; i < cells; ++i)
+        m_parent[i] = static_cast<int>(i);
+    m_leaky.assign(cells, false);
+    m_exits.clear();
+    m_indexed = false;
+    for (const bool leaks : {false, true})
+        for (int y = 0; y < hei; ++y)
+            for (int x = 0; x < len; ++x)
+                link(sprite, x, y, leaks);
+    m_changes = CGame::getMap().changeCount();
+    ++g_regionBuilds;
+}
+
+/**
+ * @brief Catch up with the tiles changed since the last query
+ *
+ * @param sprite
+ */
+void CRegions::sync(const ISprite &sprite)
+{
+    const CMap &map = CGame::getMap();
+    if (map.changeCount() == m_changes)
+        return;
+    auto relinkTile = [this, &sprite](const Pos &tile)
+    {
+        relink(sprite, tile);
+    };
+    if (!map.visitChanges(m_changes, relinkTile))
+        build(sprite, m_key, m_len, m_hei);
+    m_changes = map.changeCount();
+}
+
+/**
+ * @brief Update the labels around a changed tile
+ *
+ * @param sprite
+ * @param tile changed tile, in map coordinates
+ */
+void CRegions::relink(const ISprite &sprite, const Pos &tile)
+{
+    // cells whose moves test this tile
+    const int minX = std::max(m_granularFactor * (tile.x - m_extentX), 0);
+    const int maxX = std::min(m_granularFactor * (tile.x + 2) - 1, m_len - 1);
+    const int minY = std::max(m_granularFactor * (tile.y - m_extentY), 0);
+    const int maxY = std::min(m_granularFactor * (tile.y + 2) - 1, m_hei - 1);
+
+    // link() pairs a cell with its right and lower neighbours
+    for (const bool leaks : {false, true})
+        for (int y = std::max(minY - 1, 0); y <= maxY; ++y)
+            for (int x = std::max(minX - 1, 0); x <= maxX; ++x)
+                link(sprite, x, y, leaks);
+}
+
+/**
+ * @brief Label a cell with its right and lower neighbours
+ *
+ * Neighbours that can step into each other are merged. Once they are, a
+ * one-way step into another label is kept as an exit and marks the label
+ * it leaves as leaky; one-way steps within a label change nothing.
+ *
+ * @param sprite
+ * @param x
+ * @param y
+ * @param leaks false to merge the labels, true to flag the leaks
+ */
+void CRegions::link(const ISprite &sprite, const int x, const int y, const bool leaks)
+{
+    const Pos pos{static_cast<int16_t>(x), static_cast<int16_t>(y)};
+    if (!isValid(pos))
+        return;
+    const int cell = x + y * m_len;
+    for (const size_t i : {1, 3})
+    {
+        const Pos next{static_cast<int16_t>(x + g_deltas[i].x),
+                       static_cast<int16_t>(y + g_deltas[i].y)};
+        if (!isValid(next))
+            continue;
+        const int nextCell = next.x + next.y * m_len;
+        const bool forward = canStep(sprite, pos, i);
+        const bool backward = canStep(sprite, next, i ^ 1);
+        if (!leaks)
+        {
+            if (forward && backward)
+                unite(cell, nextCell);
+        }
+        else if (forward != backward && find(cell) != find(nextCell))
+        {
+            const int source = forward ? cell : nextCell;
+            m_leaky[find(source)] = true;
+            m_exits.emplace_back(source, forward ? nextCell : cell);
+            m_indexed = false;
+        }
+    }
+}
+
+int CRegions::find(int cell)
+{
+    while (m_parent[cell] != cell)
+    {
+        // path halving
+        m_parent[cell] = m_parent[m_parent[cell]];
+        cell = m_parent[cell];
+    }
+    return cell;
+}
+
+void CRegions::unite(const int a, const int b)
+{
+    const int rootA = find(a);
+    const int rootB = find(b);
+    if (rootA == rootB)
+        return;
+    const int root = std::min(rootA, rootB);
+    const int child = std::max(rootA, rootB);
+    m_parent[child] = root;
+    m_leaky[root] = m_leaky[root] || m_leaky[child];
+    m_indexed = false;
+}
+
+bool CRegions::isValid(const Pos &pos) const
+{
+    return pos.x >= 0 && pos.x < m_len && pos.y >= 0 && pos.y < m_hei;
+}
@@ -26,17 +26,34 @@
 class ISprite;
 class IFile;
 
+namespace PathData
+{
+    struct search_t;
+};
+
 class IPath
 {
 public:
-    virtual std::vector<JoyAim> findPath(ISprite &sprite, const Pos &playerPos) const = 0;
+    virtual void findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const = 0;
+    // chasers step down a shared CDistanceField instead of caching their own path
+    virtual bool usesDistanceField() const { return false; }
+    // queries between two CRegions are rejected without searching
+    virtual bool usesRegions() const { return false; }
+    // CPath may spread the search over several ticks
+    virtual bool isResumable() const { return false; }
+    // a search from a cell of a path found at epoch would give the rest of it
+    virtual bool retraces(const ISprite &sprite, const Pos &from, const Pos &goal, const uint32_t epoch) const;
+    virtual bool beginSearch(const ISprite &sprite, const Pos &playerPos, PathData::search_t &search) const;
+    virtual bool resumeSearch(const ISprite &sprite, PathData::search_t &search, int &budget, std::vector<JoyAim> &directions) const;
+    static size_t expansionCount();
 };
 
 // A* Pathfinding class
 class AStar : public IPath
 {
 public:
-    std::vector<JoyAim> findPath(ISprite &sprite, const Pos &playerPos) const override;
+    void findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const override;
+    bool usesRegions() const override { return true; }
 
 private:
     int manhattanDistance(const Pos &a, const Pos &b) const;
@@ -46,50 +63,260 @@ private:
 class AStarSmooth : public IPath
 {
 public:
-    std::vector<JoyAim> findPath(ISprite &sprite, const Pos &playerPos) const override;
+    void findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const override;
+    bool usesRegions() const override { return true; }
+    bool isResumable() const override { return true; }
+    bool beginSearch(const ISprite &sprite, const Pos &playerPos, PathData::search_t &search) const override;
+    bool resumeSearch(const ISprite &sprite, PathData::search_t &search, int &budget, std::vector<JoyAim> &directions) const override;
 
 private:
     int manhattanDistance(const Pos &a, const Pos &b) const;
-    std::vector<JoyAim> smoothPath(const std::vector<Pos> &path, ISprite &sprite) const;
+    void smoothPath(PathData::search_t &search, const ISprite &sprite, std::vector<JoyAim> &directions) const;
+};
+
+// Jump Point Search over the 4-connected grid
+class JPS : public IPath
+{
+public:
+    void findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const override;
+    bool isResumable() const override { return true; }
+    bool beginSearch(const ISprite &sprite, const Pos &playerPos, PathData::search_t &search) const override;
+    bool resumeSearch(const ISprite &sprite, PathData::search_t &search, int &budget, std::vector<JoyAim> &directions) const override;
+
+private:
+    int manhattanDistance(const Pos &a, const Pos &b) const;
+    bool isOpen(const PathData::search_t &search, const ISprite &sprite, const Pos &pos, const size_t dir) const;
+    bool jump(PathData::search_t &search, const ISprite &sprite, Pos &pos, const size_t dir) const;
 };
 
 // BFS Pathfinding class
 class BFS : public IPath
 {
 public:
-    std::vector<JoyAim> findPath(ISprite &sprite, const Pos &playerPos) const override;
+    void findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const override;
+    bool usesRegions() const override { return true; }
+};
+
+// steps down a CDistanceField shared by the chasers of a movement class
+class FlowField : public IPath
+{
+public:
+    void findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const override;
+    bool usesDistanceField() const override { return true; }
 };
 
 // Line-of-Sight Pathfinding class
+// walks are reused until a tile between both ends changes its pass mask
 class LineOfSight : public IPath
 {
 public:
-    std::vector<JoyAim> findPath(ISprite &sprite, const Pos &playerPos) const override;
+    void findPath(const ISprite &sprite, const Pos &playerPos, std::vector<JoyAim> &directions) const override;
+    bool retraces(const ISprite &sprite, const Pos &from, const Pos &goal, const uint32_t epoch) const override;
+    void trace(const ISprite &sprite, const Pos &startPos, const Pos &goalPos, const int mapLen, const int mapHei, std::vector<JoyAim> &directions) const;
+    static size_t reuseCount();
+
+private:
+    bool isTraceUnchanged(const ISprite &sprite, const Pos &startPos, const Pos &goalPos, const uint32_t epoch) const;
 };
 
+/**
+ * @brief Path followed by a sprite
+ *
+ * A cached path is searched again when it runs out, when a step is blocked
+ * and every PATH_TIMEOUT_MAX steps, as it always was; boss movement in
+ * recordings depends on it. The search is skipped when the algorithm
+ * would only retrace the rest of the path: same goal, sprite still on the
+ * path and no tile changed where the walk looks.
+ *
+ * Resumable searches (AStarSmooth and JPS) are time-sliced: all of them
+ * share a budget of node expansions per tick, split evenly between the
+ * searches that have not run yet on that tick. The sprite keeps following
+ * its previous path until the new one is complete. It is only searched
+ * again once it runs out, the goal moves more than a couple of tiles away
+ * from where the path leads or a tile changes its pass mask in one of the
+ * CMap epoch blocks along the rest of the path. The budget only depends on
+ * the order in which sprites are processed, so replays stay deterministic.
+ * A*, BFS and LineOfSight, the algorithms the shipped bosses use, still
+ * search within the tick: slicing them would hand each re-plan back late
+ * and change boss movement in existing recordings.
+ *
+ * A search in progress belongs to the CPath that started it. Copies start
+ * over with a search of their own.
+ *
+ * Budgets, caches and counters are per thread. A thread that drives
+ * several games must run their ticks one after the other.
+ */
 class CPath
 {
 public:
     CPath();
-    ~CPath() {};
+    CPath(const CPath &other);
+    CPath(CPath &&other) noexcept;
+    CPath &operator=(const CPath &other);
+    CPath &operator=(CPath &&other) noexcept;
+    ~CPath();
 
     enum Result
     {
         Blocked, // Blocked
         MoveSuccesful,
         NoValidPath,
-        NotConfigured
+        NotConfigured,
+        Searching, // no path yet, the search goes on next tick
+    };
+
+    enum : int
+    {
+        NO_SEARCH = -1,
+        MAX_SEARCHES = 4,   // searches in progress at any time
+        NODE_BUDGET = 4096, // default node expansions per tick
+        NO_EPOCH = 0,
     };
 
     Result followPath(ISprite &sprite, const Pos &playerPos, const IPath &astar);
     bool read(IFile &file);
     bool write(IFile &file);
-    void setTimeout(int timeout);
+    bool isSearching() const;
     static const IPath *getPathAlgo(const uint8_t algo);
+    static void beginTick();
+    static void setNodeBudget(const int nodes);
+    static int budgetLeft();
+    static size_t hitCount();
+    static size_t missCount();
+    static void resetCounters();
+    void invalidate();
 
 private:
+    void step(ISprite &sprite, const JoyAim aim);
+    bool startSearch(const ISprite &sprite, const Pos &playerPos, const IPath &astar);
+    void resumeSearch(const ISprite &sprite, const IPath &astar);
+    void adopt(const ISprite &sprite, const Pos &origin, const Pos &goal, const uint32_t epoch, const std::vector<JoyAim> &directions);
+    void stamp(const ISprite &sprite, const Pos &goal, const uint32_t epoch);
+    bool isCurrent(const ISprite &sprite, const Pos &goal) const;
+    bool isUnchanged() const;
+    bool isRetraced(const ISprite &sprite, const Pos &goal, const IPath &astar) const;
+    void release();
+
     // Path caching
     std::vector<JoyAim> m_cachedDirections;
     size_t m_pathIndex;
     size_t m_pathTimeout;
-};
\ No newline at end of file
+    Pos m_origin{0, 0};          // sprite position when the path was found
+    uint32_t m_epoch = NO_EPOCH; // map pass epoch the path was checked against
+    Pos m_goal{0, 0};            // goal the path leads to
+    std::vector<int> m_blocks;   // epoch blocks around the path
+    int m_search = NO_SEARCH;    // job slot of the search in progress
+};
+
+/**
+ * @brief Distance to a goal for every cell of the grid
+ *
+ * The field is computed once from the goal (the player) and shared by every
+ * chaser of the same movement class: actors of the same type or bosses of
+ * the same kind. Each chaser then steps to a neighbour one unit closer to
+ * the goal instead of running a search of its own. Chasers opt in with the
+ * FIELD path algorithm; A* and BFS chasers keep their own searches, which
+ * break ties between equally short routes differently.
+ *
+ * The field is filled lazily with a reverse breadth-first search that only
+ * runs until the cell of the requesting chaser is labelled; later requests
+ * resume it where it stopped. A chaser that cannot reach the goal exhausts
+ * the search once, after which every request is answered at once. It is
+ * discarded when the goal or the grid
+ * size changes and on every call to invalidate().
+ */
+class CDistanceField
+{
+public:
+    enum : int
+    {
+        UNREACHED = -1,
+        MAX_FIELDS = 4,
+    };
+
+    static void invalidate();
+    static CDistanceField &get(const ISprite &sprite, const Pos &goal);
+    static size_t buildCount();
+    int distance(const ISprite &sprite, const Pos &pos);
+    JoyAim descend(const ISprite &sprite);
+    JoyAim descend(const ISprite &sprite, const Pos &pos);
+
+private:
+    void reset(const int key, const Pos &goal, const int len, const int hei);
+    void label(const int cell, const int dist);
+    void expand(const ISprite &sprite, const int cell);
+    bool isValid(const Pos &pos) const;
+    bool isLabeled(const int cell) const { return m_seen[cell] == m_stamp; }
+
+    int m_key = -1;
+    uint32_t m_map = 0; // CMap::id() of the map the field was built on
+    Pos m_goal{-1, -1};
+    int m_len = 0;
+    int m_hei = 0;
+    uint32_t m_generation = 0;
+    uint32_t m_lastUse = 0;
+    uint32_t m_stamp = 0;
+    std::vector<uint32_t> m_seen; // stamp of the labeled cells
+    std::vector<int> m_dist;
+    std::vector<int> m_queue;
+    size_t m_head = 0;
+};
+
+/**
+ * @brief Connected areas of the grid for a movement class
+ *
+ * Neighbouring cells that a chaser can step between both ways share a
+ * label. A label is leaky when one of its cells has a one-way step out of
+ * it, e.g. a boss stuck in a wall. A chaser standing in a sealed label can
+ * only reach cells with the same label, so the searches give up on any
+ * other goal at once instead of flooding the area around the chaser. From
+ * a leaky label, the goal must lie down a chain of one-way exits.
+ *
+ * Labels are built once per level and kept up to date from the map's change
+ * journal by relinking the cells around each changed tile. They are only
+ * ever merged or given new exits: a passage that closes again keeps its two
+ * sides joined until the next rebuild, which can let a hopeless search
+ * through but never rejects a valid one.
+ */
+class CRegions
+{
+public:
+    enum : int
+    {
+        MAX_REGIONS = 4,
+    };
+
+    static CRegions &get(const ISprite &sprite);
+    static bool isReachable(const ISprite &sprite, const Pos &from, const Pos &to);
+    static size_t rejectCount();
+    static size_t buildCount();
+    bool canReach(const Pos &from, const Pos &to);
+
+private:
+    void build(const ISprite &sprite, const int key, const int len, const int hei);
+    void sync(const ISprite &sprite);
+    void relink(const ISprite &sprite, const Pos &tile);
+    void link(const ISprite &sprite, const int x, const int y, const bool leaks);
+    void index();
+    int find(int cell);
+    void unite(const int a, const int b);
+    bool isValid(const Pos &pos) const;
+
+    int m_key = -1;
+    uint32_t m_map = 0; // CMap::id() of the map the labels were built on
+    int m_len = 0;
+    int m_hei = 0;
+    int m_granularFactor = 1;
+    int m_extentX = 1; // footprint of the movement class in tiles
+    int m_extentY = 1;
+    uint32_t m_lastUse = 0;
+    uint32_t m_changes = 0; // map journal cursor
+    std::vector<int> m_parent;
+    std::vector<bool> m_leaky; // meaningful for the root of each label
+    std::vector<std::pair<int, int>> m_exits; // one-way steps between labels, as cells
+    std::vector<std::pair<int, int>> m_links; // the same between roots, sorted by index()
+    bool m_indexed = false;
+    std::vector<uint32_t> m_seen; // BFS marks over the roots
+    uint32_t m_stamp = 0;
+    std::vector<int> m_queue;
+};
@@ -0,0 +1,83 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "arena.h"
+
+CArena::CArena(const size_t size)
+{
+    m_buffer.resize(size);
+    m_resource.emplace(m_buffer.data(), m_buffer.size(), &m_upstream);
+}
+
+std::pmr::memory_resource *CArena::resource()
+{
+    return &*m_resource;
+}
+
+/**
+ * @brief Release everything allocated since the last reset
+ *
+ * Nothing allocated from the arena may be alive when this is called.
+ */
+void CArena::reset()
+{
+    m_resource.reset();
+    if (m_upstream.m_bytes)
+    {
+        // grow so that the same workload fits next time
+        m_buffer.resize(2 * (m_buffer.size() + m_upstream.m_bytes));
+        m_upstream.m_bytes = 0;
+    }
+    m_resource.emplace(m_buffer.data(), m_buffer.size(), &m_upstream);
+}
+
+/**
+ * @brief Size of the preallocated buffer
+ *
+ * @return size_t
+ */
+size_t CArena::capacity() const
+{
+    return m_buffer.size();
+}
+
+/**
+ * @brief Number of allocations that were served by the heap
+ *
+ * @return size_t
+ */
+size_t CArena::overflowCount() const
+{
+    return m_upstream.m_count;
+}
+
+void *CArena::CUpstream::do_allocate(size_t bytes, size_t alignment)
+{
+    ++m_count;
+    m_bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void CArena::CUpstream::do_deallocate(void *p, size_t bytes, size_t alignment)
+{
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool CArena::CUpstream::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
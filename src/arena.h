@@ -0,0 +1,68 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief Monotonic arena for the transient containers of a simulation step
+ *
+ * Containers built with resource() live until the next reset(). Memory is
+ * carved out of a single preallocated buffer; requests that do not fit are
+ * forwarded to the heap and the buffer is enlarged on the following reset,
+ * so a steady workload stops touching the heap after a few ticks.
+ */
+class CArena
+{
+public:
+    CArena(const size_t size = DEFAULT_SIZE);
+    CArena(const CArena &) = delete;
+    CArena &operator=(const CArena &) = delete;
+    ~CArena() = default;
+
+    std::pmr::memory_resource *resource();
+    void reset();
+    size_t capacity() const;
+    size_t overflowCount() const;
+
+    enum : size_t
+    {
+        DEFAULT_SIZE = 16 * 1024,
+    };
+
+private:
+    // heap fallback that keeps track of what spilled over
+    class CUpstream : public std::pmr::memory_resource
+    {
+    public:
+        size_t m_count = 0;
+        size_t m_bytes = 0;
+
+    private:
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+    };
+
+    std::vector<std::byte> m_buffer;
+    CUpstream m_upstream;
+    std::optional<std::pmr::monotonic_buffer_resource> m_resource;
+};
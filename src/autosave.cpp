@@ -0,0 +1,172 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cstdio>
+#include <filesystem>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+#include "autosave.h"
+#include "logger.h"
+
+CAutoSave::CAutoSave()
+{
+#ifndef __EMSCRIPTEN__
+    m_thread = std::thread(&CAutoSave::workerLoop, this);
+#endif
+}
+
+/**
+ * @brief Finish the pending write, then stop the worker
+ *
+ */
+CAutoSave::~CAutoSave()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+/**
+ * @brief Queue a serialized game for writing
+ *
+ * Replaces any save still waiting for the worker.
+ *
+ * @param path
+ * @param data
+ */
+void CAutoSave::submit(const std::string &path, std::vector<uint8_t> &&data)
+{
+#ifdef __EMSCRIPTEN__
+    // MEMFS writes are memory copies; persisting is left to FS.syncfs
+    writeFile(path, data);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_writes;
+#else
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_path = path;
+        m_pending = std::move(data);
+        m_hasPending = true;
+    }
+    m_wake.notify_one();
+#endif
+}
+
+/**
+ * @brief Wait until every submitted save is on disk
+ *
+ */
+void CAutoSave::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]
+                { return !m_hasPending && !m_writing; });
+}
+
+/**
+ * @brief Number of saves written so far
+ *
+ * @return size_t
+ */
+size_t CAutoSave::writeCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_writes;
+}
+
+/**
+ * @brief Replace a file in a way that never leaves it half written
+ *
+ * @param path
+ * @param data
+ * @return true
+ * @return false
+ */
+bool CAutoSave::writeFile(const std::string &path, const std::vector<uint8_t> &data)
+{
+    const std::string tmpPath = path + ".tmp";
+    FILE *tfile = fopen(tmpPath.c_str(), "wb");
+    if (!tfile)
+    {
+        LOGE("can't write: %s", tmpPath.c_str());
+        return false;
+    }
+    bool result = fwrite(data.data(), data.size(), 1, tfile) == 1 || data.empty();
+    result = fflush(tfile) == 0 && result;
+#ifdef _WIN32
+    result = _commit(_fileno(tfile)) == 0 && result;
+#elif !defined(__EMSCRIPTEN__)
+    result = fsync(fileno(tfile)) == 0 && result;
+#endif
+    result = fclose(tfile) == 0 && result;
+    std::error_code ec;
+    if (!result)
+    {
+        LOGE("failed to write file: %s", tmpPath.c_str());
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        LOGE("can't rename %s to %s: %s", tmpPath.c_str(), path.c_str(), ec.message().c_str());
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+#ifdef __EMSCRIPTEN__
+    EM_ASM(
+        FS.syncfs(function(err) {
+            // Error
+            err ? console.log(err) : null;
+        }));
+#endif
+    return true;
+}
+
+void CAutoSave::workerLoop()
+{
+    std::string path;
+    std::vector<uint8_t> data;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]
+                    { return m_hasPending || m_stopping; });
+        if (!m_hasPending)
+            break;
+        path.swap(m_path);
+        data.swap(m_pending);
+        m_hasPending = false;
+        m_writing = true;
+        lock.unlock();
+        writeFile(path, data);
+        lock.lock();
+        m_writing = false;
+        ++m_writes;
+        m_idle.notify_all();
+    }
+}
@@ -0,0 +1,64 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Writes saved games to disk off the game thread
+ *
+ * The game is serialized in memory at a tick boundary and handed over
+ * with submit(). A worker thread then writes it out while the game keeps
+ * running. A save submitted while another is being written waits in a
+ * second buffer; only the latest one is kept.
+ *
+ * Files are written to a temporary name, flushed to disk and renamed over
+ * the old save, so a crash leaves either the old save or the new one.
+ *
+ * Builds without thread support write the file on the calling thread.
+ */
+class CAutoSave
+{
+public:
+    CAutoSave();
+    ~CAutoSave();
+    void submit(const std::string &path, std::vector<uint8_t> &&data);
+    void flush();
+    size_t writeCount() const;
+    static bool writeFile(const std::string &path, const std::vector<uint8_t> &data);
+
+private:
+    void workerLoop();
+
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::string m_path;
+    std::vector<uint8_t> m_pending; // waiting for the worker
+    bool m_hasPending = false;
+    bool m_writing = false;
+    bool m_stopping = false;
+    size_t m_writes = 0;
+};
@@ -29,6 +29,8 @@
 #include "filemacros.h"
 #include "map.h"
 #include "tilesdefs.h"
+#include "passability.h"
+#include "clearance.h"
 
 namespace BossPrivate
 {
@@ -53,51 +55,31 @@ CBoss::CBoss(const int16_t x, const int16_t y, const bossData_t *data) : m_bossD
 
 bool CBoss::isSolid(const Pos &pos) const
 {
-    CMap &map = CGame::getMap();
-    const auto c = map.at(pos.x, pos.y);
-    const TileDef &def = getTileDef(c);
-    return def.type != TYPE_BACKGROUND && def.type != TYPE_PLAYER;
+    const CMap &map = CGame::getMap();
+    return !(map.passMask(pos.x, pos.y) & Passability::SOLID_BOSS);
 }
 
 bool CBoss::isGhostBlocked(const Pos &pos) const
 {
-    CMap &map = CGame::getMap();
-    const auto c = map.at(pos.x, pos.y);
-    const TileDef &def = getTileDef(c);
-    return def.type == TYPE_SWAMP || def.type == TYPE_ICECUBE || c == TILES_WALLS93_3;
+    const CMap &map = CGame::getMap();
+    return !(map.passMask(pos.x, pos.y) & Passability::GHOST_BOSS);
 }
 
-std::vector<HitResult> CBoss::testHitbox2(const CMap &map,
-                                          hitboxTestCallback_t testCallback,
-                                          hitboxActionCallback_t actionCallback) const
+std::pmr::vector<HitResult> CBoss::testHitbox2(const CMap &map,
+                                               hitboxTestCallback_t testCallback,
+                                               hitboxActionCallback_t actionCallback,
+                                               std::pmr::memory_resource *resource) const
 {
-    std::vector<HitResult> results;
+    std::pmr::vector<HitResult> results(resource);
 
     // Build hitboxes in HALF-TILE units ===
-    std::vector<hitbox_t> hitboxes; // now in half-tiles
-
-    // Primary
-    hitboxes.push_back({m_x,
-                        m_y,
-                        m_bossData->hitbox.width,
-                        m_bossData->hitbox.height,
-                        static_cast<int>(BossData::HitBoxType::MAIN)});
-
-    // Secondary (frame-specific)
-    const sprite_hitbox_t *hbData = getHitboxes(m_bossData->sheet, currentFrame());
-    for (int i = 0; hbData && i < hbData->count; ++i)
-    {
-        const auto &c = hbData->hitboxes[i];
-        hitboxes.push_back({m_x + c.x - m_bossData->hitbox.x,
-                            m_y + c.y - m_bossData->hitbox.y,
-                            c.width,
-                            c.height,
-                            c.type});
-    }
+    hitbox_t hitboxes[MAX_HITBOXES]; // now in half-tiles
+    const int count = collectHitboxes(hitboxes);
 
     // === 2. For each hitbox, scan WORLD TILES it covers ===
-    for (const auto &hb : hitboxes)
+    for (int i = 0; i < count; ++i)
     {
+        const hitbox_t &hb = hitboxes[i];
         const int left = hb.x;
         const int top = hb.y;
         const int right = left + hb.width - 1;
@@ -147,98 +129,83 @@ std::vector<HitResult> CBoss::testHitbox2(const CMap &map,
     return results;
 }
 
-std::vector<HitResult> CBoss::testHitbox1(const CMap &map,
-                                          hitboxTestCallback_t testCallback,
-                                          hitboxActionCallback_t actionCallback) const
+std::pmr::vector<HitResult> CBoss::testHitbox1(const CMap &map,
+                                               hitboxTestCallback_t testCallback,
+                                               hitboxActionCallback_t actionCallback,
+                                               std::pmr::memory_resource *resource) const
 {
-    std::vector<HitResult> results;
+    std::pmr::vector<HitResult> results(resource);
+    visitHitbox(map, [&](const HitResult &result)
+                {
+                    // Test with type
+                    if (testCallback && !testCallback(result.pos, result.type))
+                        return;
+
+                    // Collect hit
+                    if (actionCallback)
+                        actionCallback(result);
+                    results.emplace_back(result); });
+    return results;
+}
 
+/**
+ * @brief Compute the hitboxes for the current frame (half-tile units)
+ *
+ * @param list receives the primary hitbox followed by the frame-specific ones
+ * @return int number of hitboxes
+ */
+int CBoss::collectHitboxes(hitbox_t (&list)[MAX_HITBOXES]) const
+{
     // Primary hitbox (half-tiles)
     const auto &hbMain = m_bossData->hitbox;
-    std::vector<hitbox_t> hitboxes;
-    hitboxes.push_back({m_x, m_y, // Keep half-tile coords
-                        hbMain.width, hbMain.height,
-                        static_cast<int>(BossData::HitBoxType::MAIN)});
+    int count = 0;
+    list[count++] = {m_x, m_y, // Keep half-tile coords
+                     hbMain.width, hbMain.height,
+                     static_cast<int>(BossData::HitBoxType::MAIN)};
 
     // Secondary hitboxes (relative to main, half-tiles)
     const sprite_hitbox_t *hbData = getHitboxes(m_bossData->sheet, currentFrame());
-    for (int i = 0; hbData != nullptr && i < hbData->count; ++i)
+    for (int i = 0; hbData != nullptr && i < hbData->count && count < MAX_HITBOXES; ++i)
     {
         const hitbox_t &c = hbData->hitboxes[i];
-        const hitbox_t hb{
+        list[count++] = {
             m_x + c.x - hbMain.x,
             m_y + c.y - hbMain.y,
             c.width,
             c.height,
             c.type};
-        hitboxes.push_back(hb);
-    }
-
-    // Test each hitbox
-    for (const auto &hb : hitboxes)
-    {
-        BossData::HitBoxType hbType = static_cast<BossData::HitBoxType>(hb.type);
-
-        // Compute world tile bounds (half-tiles to full tiles)
-        const int left = hb.x;               // Half-tile x
-        const int right = hb.x + hb.width;   // Half-tile x+width
-        const int top = hb.y;                // Half-tile y
-        const int bottom = hb.y + hb.height; // Half-tile y+height
-
-        // World tile range (inclusive)
-        const int x_start = left / BOSS_GRANULAR_FACTOR;       // floor(left/2)
-        const int x_end = (right - 1) / BOSS_GRANULAR_FACTOR;  // floor((right-1)/2)
-        const int y_start = top / BOSS_GRANULAR_FACTOR;        // floor(top/2)
-        const int y_end = (bottom - 1) / BOSS_GRANULAR_FACTOR; // floor((bottom-1)/2)
-
-        // Scan all world tiles in range
-        for (int wy = y_start; wy <= y_end; ++wy)
-        {
-            for (int wx = x_start; wx <= x_end; ++wx)
-            {
-                // Out-of-map check
-                if (!map.isValid(wx, wy))
-                {
-                    continue;
-                }
-
-                const Pos pos{static_cast<int16_t>(wx), static_cast<int16_t>(wy)};
-
-                // Test with type
-                if (testCallback && !testCallback(pos, hbType))
-                {
-                    continue;
-                }
-
-                // Collect hit
-                HitResult result{pos, hbType};
-                if (actionCallback)
-                {
-                    actionCallback(result);
-                }
-                results.emplace_back(std::move(result));
-            }
-        }
     }
-
-    return results;
+    return count;
 }
 
 bool CBoss::canMove(const JoyAim aim) const
+{
+    return canMoveFrom(Pos{m_x, m_y}, aim);
+}
+
+/**
+ * @brief Could the boss move in given direction if it stood at pos
+ *
+ * @param from position in half-tiles
+ * @param aim
+ * @return true
+ * @return false
+ */
+bool CBoss::canMoveFrom(const Pos &from, const JoyAim aim) const
 {
     const CMap &map = CGame::getMap();
     const int mapLen = map.len();
     const int mapHei = map.hei();
-    const int x = m_x / BOSS_GRANULAR_FACTOR;
-    const int y = m_y / BOSS_GRANULAR_FACTOR;
+    const int x = from.x / BOSS_GRANULAR_FACTOR;
+    const int y = from.y / BOSS_GRANULAR_FACTOR;
     const int w = m_bossData->hitbox.width / BOSS_GRANULAR_FACTOR;
     const int h = m_bossData->hitbox.height / BOSS_GRANULAR_FACTOR;
     const int maxX = mapLen * BOSS_GRANULAR_FACTOR;
     const int maxY = mapHei * BOSS_GRANULAR_FACTOR;
 
     // Check if move stays within same 8x8 grid cell and map bounds
-    int next_x = m_x;
-    int next_y = m_y;
+    int next_x = from.x;
+    int next_y = from.y;
     switch (aim)
     {
     case JoyAim::AIM_UP:
@@ -257,68 +224,37 @@ bool CBoss::canMove(const JoyAim aim) const
         LOGW("invalid aim: %.2x on %d", aim, __LINE__);
         return false;
     }
-    if (next_x / BOSS_GRANULAR_FACTOR == m_x / BOSS_GRANULAR_FACTOR &&
-        next_y / BOSS_GRANULAR_FACTOR == m_y / BOSS_GRANULAR_FACTOR &&
+    if (next_x / BOSS_GRANULAR_FACTOR == from.x / BOSS_GRANULAR_FACTOR &&
+        next_y / BOSS_GRANULAR_FACTOR == from.y / BOSS_GRANULAR_FACTOR &&
         next_x >= 0 && next_x + m_bossData->hitbox.width <= maxX &&
         next_y >= 0 && next_y + m_bossData->hitbox.height <= maxY)
     {
         return true; // Sub-tile move within same 8x8 cell and map bounds
     }
 
-    // Check collisions for new 8x8 grid cell
+    // Check the strip of tiles the footprint enters
+    const CClearance &clearance = CClearance::get(m_solidClass);
     switch (aim)
     {
     case JoyAim::AIM_UP:
         if (next_y < 0)
             return false;
-        for (int ax = x; ax < x + w; ++ax)
-        {
-            if (ax < 0 || ax >= mapLen)
-                continue;
-            const Pos pos{static_cast<int16_t>(ax), static_cast<int16_t>(y - 1)};
-            if ((this->*m_solidCheck)(pos))
-                return false;
-        }
-        break;
+        return clearance.isRowClear(x, y - 1, w);
 
     case JoyAim::AIM_DOWN:
         if (next_y + m_bossData->hitbox.height > maxY)
             return false;
-        for (int ax = x; ax < x + w; ++ax)
-        {
-            if (ax < 0 || ax >= mapLen)
-                continue;
-            const Pos pos{static_cast<int16_t>(ax), static_cast<int16_t>(y + h)};
-            if ((this->*m_solidCheck)(pos))
-                return false;
-        }
-        break;
+        return clearance.isRowClear(x, y + h, w);
 
     case JoyAim::AIM_LEFT:
         if (next_x < 0)
             return false;
-        for (int ay = y; ay < y + h; ++ay)
-        {
-            if (ay < 0 || ay >= mapHei)
-                continue;
-            const Pos pos{static_cast<int16_t>(x - 1), static_cast<int16_t>(ay)};
-            if ((this->*m_solidCheck)(pos))
-                return false;
-        }
-        break;
+        return clearance.isColumnClear(x - 1, y, h);
 
     case JoyAim::AIM_RIGHT:
         if (next_x + m_bossData->hitbox.width > maxX)
             return false;
-        for (int ay = y; ay < y + h; ++ay)
-        {
-            if (ay < 0 || ay >= mapHei)
-                continue;
-            const Pos pos{static_cast<int16_t>(x + w), static_cast<int16_t>(ay)};
-            if ((this->*m_solidCheck)(pos))
-                return false;
-        }
-        break;
+        return clearance.isColumnClear(x + w, y, h);
     default:
         LOGE("invalid aim: %.2x on line %d", aim, __LINE__);
         return false;
@@ -439,7 +375,7 @@ void CBoss::setState(const BossState state)
 
 int CBoss::maxHp() const
 {
-    auto skill = (int)CGame::getGame()->skill();
+    auto skill = (int)CGame::current().skill();
     return (int)m_bossData->hp * ((skill * 0.5) + 1);
 }
 
@@ -578,7 +514,11 @@ bool CBoss::read(IFile &sfile)
     checkBound(static_cast<uint8_t>(m_aim), JoyAim::TOTAL_AIMS);
 
     // read path
-    m_path.read(sfile);
+    if (!m_path.read(sfile))
+    {
+        LOGE("failed to read boss path");
+        return false;
+    }
 
     setSolidOperator();
     return true;
@@ -611,14 +551,14 @@ void CBoss::setSolidOperator()
 {
     LOGI("set solidOperator for boss %.2x", m_bossData->type);
     if (m_bossData->type == BOSS_MR_DEMON)
-        m_solidCheck = &CBoss::isSolid;
+        m_solidClass = Passability::SOLID_BOSS;
     else if (m_bossData->type == BOSS_GHOST)
-        m_solidCheck = &CBoss::isGhostBlocked;
+        m_solidClass = Passability::GHOST_BOSS;
     else if (m_bossData->type == BOSS_HARPY)
-        m_solidCheck = &CBoss::isSolid;
+        m_solidClass = Passability::SOLID_BOSS;
     else
     {
         LOGW("No custom solidOperator for this boss");
-        m_solidCheck = &CBoss::isSolid;
+        m_solidClass = Passability::SOLID_BOSS;
     }
 }
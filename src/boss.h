@@ -19,6 +19,8 @@
 
 #include <cinttypes>
 #include <functional>
+#include <memory_resource>
+#include <vector>
 #include "rect.h"
 #include "joyaim.h"
 #include "isprite.h"
@@ -39,7 +41,6 @@ struct HitResult
 
 using hitboxTestCallback_t = std::function<bool(const Pos &, BossData::HitBoxType)>; // Return true to skip/abort this pos
 using hitboxActionCallback_t = std::function<void(const HitResult &)>;               // Collect/process each hit
-using BossTileCheck = bool (CBoss::*)(const Pos &) const;
 
 class CBoss : public ISprite
 {
@@ -61,13 +62,20 @@ public:
     inline int16_t y() const override { return m_y; }
     inline const hitbox_t &hitbox() const { return m_bossData->hitbox; }
     uint8_t type() const override { return m_bossData->type; }
-    std::vector<HitResult> testHitbox1(const CMap &map, hitboxTestCallback_t testCallback, hitboxActionCallback_t actionCallback) const;
-    std::vector<HitResult> testHitbox2(const CMap &map, hitboxTestCallback_t testCallback, hitboxActionCallback_t actionCallback) const;
+    std::pmr::vector<HitResult> testHitbox1(const CMap &map, hitboxTestCallback_t testCallback, hitboxActionCallback_t actionCallback,
+                                            std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+    std::pmr::vector<HitResult> testHitbox2(const CMap &map, hitboxTestCallback_t testCallback, hitboxActionCallback_t actionCallback,
+                                            std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+    template <typename Visitor>
+    void visitHitbox(const CMap &map, Visitor &&visitor) const;
+    template <typename Visitor>
+    void visitHitboxRects(Visitor &&visitor) const;
 
     bool isSolid(const Pos &pos) const;
     bool isGhostBlocked(const Pos &pos) const;
     static const Pos toPos(int x, int y);
     bool canMove(const JoyAim aim) const override;
+    bool canMoveFrom(const Pos &from, const JoyAim aim) const override;
     void move(const JoyAim aim) override;
     int distance(const CActor &actor) const override;
     int speed() const { return m_speed; }
@@ -110,7 +118,9 @@ public:
     enum : int16_t
     {
         BOSS_GRANULAR_FACTOR = 2,
+        MAX_HITBOXES = 1 + MAX_HITBOX_PER_FRAME,
     };
+    int collectHitboxes(hitbox_t (&list)[MAX_HITBOXES]) const;
     bool followPath(const Pos &playerPos, const IPath &astar);
     void patrol();
     bool read(IFile &file);
@@ -130,7 +140,59 @@ private:
     BossState m_state;
     int m_speed;
     JoyAim m_aim;
-    BossTileCheck m_solidCheck = nullptr;
+    uint8_t m_solidClass = 0; // Passability::Class of the tiles the boss can enter
     void setSolidOperator();
     CPath m_path;
 };
+
+/**
+ * @brief Visit the world tile rectangle covered by each boss hitbox
+ *
+ * The primary hitbox comes first, followed by the frame-specific ones.
+ * Rectangles are not clipped to the map.
+ *
+ * @param visitor called with (const rect_t &, BossData::HitBoxType)
+ */
+template <typename Visitor>
+void CBoss::visitHitboxRects(Visitor &&visitor) const
+{
+    hitbox_t list[MAX_HITBOXES];
+    const int count = collectHitboxes(list);
+    for (int i = 0; i < count; ++i)
+    {
+        const hitbox_t &hb = list[i];
+        const BossData::HitBoxType hbType = static_cast<BossData::HitBoxType>(hb.type);
+
+        // World tile range (inclusive), half-tiles to full tiles
+        const int x_start = hb.x / BOSS_GRANULAR_FACTOR;
+        const int x_end = (hb.x + hb.width - 1) / BOSS_GRANULAR_FACTOR;
+        const int y_start = hb.y / BOSS_GRANULAR_FACTOR;
+        const int y_end = (hb.y + hb.height - 1) / BOSS_GRANULAR_FACTOR;
+        visitor(rect_t{x_start, y_start, x_end - x_start + 1, y_end - y_start + 1}, hbType);
+    }
+}
+
+/**
+ * @brief Visit every world tile covered by the boss hitboxes
+ *
+ * The primary hitbox is visited first, followed by the frame-specific
+ * ones. A tile covered by several hitboxes is visited once per hitbox.
+ *
+ * @param map current map
+ * @param visitor called with a HitResult for each covered tile
+ */
+template <typename Visitor>
+void CBoss::visitHitbox(const CMap &map, Visitor &&visitor) const
+{
+    visitHitboxRects([&map, &visitor](const rect_t &rect, const BossData::HitBoxType hbType)
+                     {
+                         for (int wy = rect.y; wy < rect.y + rect.height; ++wy)
+                         {
+                             for (int wx = rect.x; wx < rect.x + rect.width; ++wx)
+                             {
+                                 if (!map.isValid(wx, wy))
+                                     continue;
+                                 visitor(HitResult{Pos{static_cast<int16_t>(wx), static_cast<int16_t>(wy)}, hbType});
+                             }
+                         } });
+}
@@ -96,6 +96,11 @@ constexpr const sprite_hitbox_t g_hitboxes[] = {
     { 1021, 1, {{ 1, 5, 3, 3, 2 }, }},
 };
 
+constexpr const int16_t g_hitboxIndex[HITBOX_SHEETS][HITBOX_FRAMES] = {
+    {NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, 1, 0, 2},
+    {25, 24, 23, 22, 21, 20, NO_HITBOX, NO_HITBOX, 19, 18, 17, 16, 15, 14, NO_HITBOX, NO_HITBOX, 13, 12, 11, 10, 9, 26, NO_HITBOX, NO_HITBOX, 8, 7, 6, 5, 3, 4, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX, NO_HITBOX},
+};
+
 constexpr const bossData_t g_bossData[] = {
     {
         .name = "Mr. Demon",
@@ -37,6 +37,9 @@
 #define HITBOX_COUNT  27
 #define SHEET_SPACER  1000
 #define MAX_HITBOX_PER_FRAME 4
+#define HITBOX_SHEETS 2
+#define HITBOX_FRAMES 49
+#define NO_HITBOX -1
 
 namespace BossData
 {
@@ -45,7 +48,9 @@ namespace BossData
         ASTAR,
         BFS,
         LOS,
-        ASTAR_SMOOTH
+        ASTAR_SMOOTH,
+        JPS,
+        FIELD
     };
 
     enum HitBoxType:uint8_t {
@@ -120,6 +125,7 @@ struct bossData_t
 };
 extern const bossData_t g_bossData[];
 extern const sprite_hitbox_t g_hitboxes[];
+extern const int16_t g_hitboxIndex[HITBOX_SHEETS][HITBOX_FRAMES];
 
 inline constexpr const bossData_t *getBossData(const uint8_t type)
 {
@@ -133,11 +139,8 @@ inline constexpr const bossData_t *getBossData(const uint8_t type)
 
 inline constexpr const sprite_hitbox_t *getHitboxes(const int sheet, const int frameID)
 {
-    const int spriteID = sheet * SHEET_SPACER + frameID;
-    for (size_t i = 0; i < HITBOX_COUNT; ++i)
-    {
-        if (g_hitboxes[i].spriteID == spriteID)
-            return &g_hitboxes[i];
-    }
-    return nullptr;
+    if (sheet < 0 || sheet >= HITBOX_SHEETS || frameID < 0 || frameID >= HITBOX_FRAMES)
+        return nullptr;
+    const int i = g_hitboxIndex[sheet][frameID];
+    return i != NO_HITBOX ? &g_hitboxes[i] : nullptr;
 }
\ No newline at end of file
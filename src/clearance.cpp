@@ -0,0 +1,188 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <array>
+#include "clearance.h"
+#include "game.h"
+#include "map.h"
+
+namespace ClearanceData
+{
+    // one table per Passability::Class bit, for each thread running games
+    thread_local std::array<CClearance, 8> g_clearances;
+    thread_local size_t g_builds = 0;
+};
+
+using namespace ClearanceData;
+
+/**
+ * @brief Clearance table of a movement class, in sync with the current map
+ *
+ * @param passClass a single Passability::Class bit
+ * @return const CClearance&
+ */
+const CClearance &CClearance::get(const uint8_t passClass)
+{
+    size_t i = 0;
+    while (i < g_clearances.size() - 1 && !(passClass & (1 << i)))
+        ++i;
+    CClearance &clearance = g_clearances[i];
+    const CMap &map = CGame::getMap();
+    if (clearance.m_class != passClass || clearance.m_map != map.id() ||
+        clearance.m_len != map.len() || clearance.m_hei != map.hei())
+        clearance.build(passClass);
+    else
+        clearance.sync();
+    return clearance;
+}
+
+/**
+ * @brief Number of tables computed from scratch
+ *
+ * @return size_t
+ */
+size_t CClearance::buildCount()
+{
+    return g_builds;
+}
+
+/**
+ * @brief Check that a row of tiles is passable
+ *
+ * Tiles past either side of the map are ignored.
+ *
+ * @param x leftmost tile
+ * @param y
+ * @param width number of tiles
+ * @return true
+ * @return false
+ */
+bool CClearance::isRowClear(const int x, const int y, const int width) const
+{
+    const int left = std::max(x, 0);
+    const int right = std::min(x + width, m_len);
+    if (left >= right)
+        return true;
+    if (y < 0 || y >= m_hei)
+        return false;
+    return m_across[left + y * m_len] >= std::min(right - left, static_cast<int>(MAX_RUN));
+}
+
+/**
+ * @brief Check that a column of tiles is passable
+ *
+ * Tiles above or below the map are ignored.
+ *
+ * @param x
+ * @param y topmost tile
+ * @param height number of tiles
+ * @return true
+ * @return false
+ */
+bool CClearance::isColumnClear(const int x, const int y, const int height) const
+{
+    const int top = std::max(y, 0);
+    const int bottom = std::min(y + height, m_hei);
+    if (top >= bottom)
+        return true;
+    if (x < 0 || x >= m_len)
+        return false;
+    return m_down[x + top * m_len] >= std::min(bottom - top, static_cast<int>(MAX_RUN));
+}
+
+void CClearance::build(const uint8_t passClass)
+{
+    const CMap &map = CGame::getMap();
+    m_class = passClass;
+    m_map = map.id();
+    m_len = map.len();
+    m_hei = map.hei();
+    const size_t cells = static_cast<size_t>(m_len) * m_hei;
+    m_across.assign(cells, 0);
+    m_down.assign(cells, 0);
+    for (int y = m_hei - 1; y >= 0; --y)
+    {
+        for (int x = m_len - 1; x >= 0; --x)
+        {
+            if (!isFree(x, y))
+                continue;
+            const int i = x + y * m_len;
+            m_across[i] = x + 1 < m_len ? std::min(m_across[i + 1] + 1, static_cast<int>(MAX_RUN)) : 1;
+            m_down[i] = y + 1 < m_hei ? std::min(m_down[i + m_len] + 1, static_cast<int>(MAX_RUN)) : 1;
+        }
+    }
+    m_changes = map.changeCount();
+    ++g_builds;
+}
+
+/**
+ * @brief Catch up with the tiles changed since the last query
+ *
+ */
+void CClearance::sync()
+{
+    const CMap &map = CGame::getMap();
+    if (map.changeCount() == m_changes)
+        return;
+    if (!map.visitChanges(m_changes, [this](const Pos &tile)
+                          { update(tile.x, tile.y); }))
+        build(m_class);
+    m_changes = map.changeCount();
+}
+
+/**
+ * @brief Recompute the runs that cross a changed tile
+ *
+ * Only the tile itself and the free tiles leading up to it, on its row
+ * and on its column, can see their runs change.
+ *
+ * @param x
+ * @param y
+ */
+void CClearance::update(const int x, const int y)
+{
+    for (int ax = x; ax >= 0; --ax)
+    {
+        const int i = ax + y * m_len;
+        if (!isFree(ax, y))
+        {
+            m_across[i] = 0;
+            if (ax != x)
+                break;
+            continue;
+        }
+        m_across[i] = ax + 1 < m_len ? std::min(m_across[i + 1] + 1, static_cast<int>(MAX_RUN)) : 1;
+    }
+    for (int ay = y; ay >= 0; --ay)
+    {
+        const int i = x + ay * m_len;
+        if (!isFree(x, ay))
+        {
+            m_down[i] = 0;
+            if (ay != y)
+                break;
+            continue;
+        }
+        m_down[i] = ay + 1 < m_hei ? std::min(m_down[i + m_len] + 1, static_cast<int>(MAX_RUN)) : 1;
+    }
+}
+
+bool CClearance::isFree(const int x, const int y) const
+{
+    return CGame::getMap().passMask(x, y) & m_class;
+}
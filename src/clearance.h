@@ -0,0 +1,61 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Free space around each tile for one boss movement class
+ *
+ * For every tile the table holds the number of consecutive passable tiles
+ * starting there and running right (across) or down. A boss leaving its
+ * cell tests the row or column of tiles its footprint enters; with these
+ * runs that strip test is a single comparison.
+ *
+ * Tables are built on first use and then patched from the CMap change
+ * journal: a changed tile only affects the runs on its own row and column.
+ */
+class CClearance
+{
+public:
+    static const CClearance &get(const uint8_t passClass);
+    static size_t buildCount();
+    bool isRowClear(const int x, const int y, const int width) const;
+    bool isColumnClear(const int x, const int y, const int height) const;
+
+private:
+    enum : uint8_t
+    {
+        MAX_RUN = 0xff,
+    };
+
+    void build(const uint8_t passClass);
+    void sync();
+    void update(const int x, const int y);
+    bool isFree(const int x, const int y) const;
+
+    uint8_t m_class = 0;
+    uint32_t m_map = 0; // CMap::id() of the map the table was built on
+    int m_len = 0;
+    int m_hei = 0;
+    uint32_t m_changes = 0; // map journal cursor
+    std::vector<uint8_t> m_across;
+    std::vector<uint8_t> m_down;
+};
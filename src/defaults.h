@@ -23,4 +23,5 @@ enum : int32_t
 {
     DEFAULT_WIDTH = 320,
     DEFAULT_HEIGHT = 240,
+    MAX_REPLAY_SPEED = 64, // ticks per frame in turbo playback
 };
@@ -24,12 +24,16 @@
 #include <algorithm>
 #include <memory>
 #include <array>
+#include <chrono>
+#include <cinttypes>
+#include <zlib.h>
 #include "game.h"
 #include "map.h"
 #include "actor.h"
 #include "sprtypes.h"
 #include "tilesdata.h"
 #include "maparch.h"
+#include "prefetch.h"
 #include "shared/IFile.h"
 #include "shared/interfaces/ISound.h"
 #include "skills.h"
@@ -38,6 +42,7 @@
 #include "states.h"
 #include "statedata.h"
 #include "gamestats.h"
+#include "zobrist.h"
 #include "attr.h"
 #include "logger.h"
 #include "strhelper.h"
@@ -47,12 +52,24 @@
 #include "gamesfx.h"
 #include "boss.h"
 #include "tilesdefs.h"
+#include "shared/FileMem.h"
+#include "shared/helper.h"
 
 namespace GamePrivate
 {
-    constexpr uint32_t ENGINE_VERSION = (0x0200 << 16) + 0x0008;
+    constexpr uint32_t ENGINE_VERSION = (0x0200 << 16) + 0x0009;
+    constexpr uint32_t FULLMAP_VERSION = (0x0200 << 16) + 0x0008; // uncompressed, whole map
     constexpr const char GAME_SIGNATURE[]{'C', 'S', '3', 'b'};
-    Random g_randomz(12345, 0);
+    // inflated savegame: a 256x256 map with an attribute on every tile,
+    // its states and the actors stay well under this
+    constexpr uint32_t MAX_SAVE_SIZE = 8 << 20;
+    thread_local CGame *t_game = nullptr; // game bound to this thread
+
+    enum MapFormat : uint8_t
+    {
+        MAP_FULL,  // the whole map
+        MAP_DELTA, // changes made to the level in the archive
+    };
 
     enum
     {
@@ -105,13 +122,33 @@ CGame::~CGame()
 }
 
 /**
- * @brief returns the current map
+ * @brief returns the map of the game bound to this thread
  *
  * @return CMap&
  */
 CMap &CGame::getMap()
 {
-    return m_map;
+    return current().m_map;
+}
+
+CGame::Scope::Scope(CGame &game) : m_previous(t_game)
+{
+    t_game = &game;
+}
+
+CGame::Scope::~Scope()
+{
+    t_game = m_previous;
+}
+
+/**
+ * @brief Game bound to the calling thread, the default game if none is
+ *
+ * @return CGame&
+ */
+CGame &CGame::current()
+{
+    return t_game ? *t_game : *getGame();
 }
 
 /**
@@ -166,6 +203,7 @@ bool CGame::fuseBarrel(const Pos &pos)
  */
 bool CGame::move(const JoyAim aim)
 {
+    const Scope scope(*this);
     const uint8_t tileID = m_player.tileAt(aim);
     const TileDef &def = getTileDef(tileID);
     if (m_player.canMove(aim))
@@ -319,7 +357,7 @@ void CGame::consume()
                 m_events.emplace_back(EVENT_PASSAGE);
         }
     }
-    else if (attr >= MSG0 && m_map.states().hasS(attr))
+    else if (attr >= MSG0 && m_map.statesConst().hasS(attr))
     {
         // Messsage Event (scrolls, books etc)
         m_events.emplace_back(static_cast<Event>(attr));
@@ -335,16 +373,37 @@ void CGame::consume()
  */
 bool CGame::loadLevel(const GameMode mode)
 {
+    const Scope scope(*this);
+    const auto start = std::chrono::steady_clock::now();
     if (!m_quiet)
         LOGI("loading level: %d ...", m_level + 1);
+    if (!m_quiet && CPath::missCount())
+        LOGI("path cache: %zu hits, %zu misses", CPath::hitCount(), CPath::missCount());
+    CPath::resetCounters();
     setMode(mode);
 
     // clear used items list when entering a new level
     if (mode == MODE_CHUTE || mode == MODE_LEVEL_INTRO)
         m_usedItems.clear();
 
-    // extract level from MapArch
-    m_map = *(m_mapArch->at(m_level));
+    // extract level from MapArch; the tiles are copied, the rest is shared
+    const CMap &base = *m_mapArch->at(m_level);
+    CLevelPrefetch::level_t prepared;
+    const bool prefetched = m_prefetch && m_prefetch->take(m_level, base, prepared);
+    if (prefetched)
+    {
+        m_map = std::move(prepared.map);
+        std::swap(m_levelCache, prepared.cache);
+    }
+    else
+    {
+        if (m_levelCache.base != &base ||
+            m_levelCache.baseId != base.id() ||
+            m_levelCache.baseChanges != base.changeCount())
+            cacheLevel(m_levelCache, base);
+        m_map = base;
+    }
+    m_levelCache.changes = m_map.changeCount();
 
     // remove used item
     for (const auto &pos : m_usedItems)
@@ -360,7 +419,7 @@ bool CGame::loadLevel(const GameMode mode)
     m_events.clear();
 
     // Use origin pos if available
-    CStates &states = m_map.states();
+    const CStates &states = m_map.statesConst();
     const uint16_t origin = states.getU(POS_ORIGIN);
     Pos pos;
     if (m_gameStats->get(S_CHUTE) != 0)
@@ -388,13 +447,32 @@ bool CGame::loadLevel(const GameMode mode)
     if (!m_quiet)
         LOGI("Player at: %d %d", pos.x, pos.y);
     m_player = std::move(CActor(pos, TYPE_PLAYER, AIM_DOWN));
-    m_diamonds = states.hasU(MAP_GOAL) ? states.getU(MAP_GOAL) : m_map.count(TILES_DIAMOND);
+    m_diamonds = states.hasU(MAP_GOAL) ? states.getU(MAP_GOAL) : countDiamonds();
     resetKeys();
     m_health = DEFAULT_HEALTH;
     spawnMonsters();
+    // label the areas reachable by the chasing bosses ahead of the first tick
+    for (const auto &boss : m_bosses)
+    {
+        const IPath *algo = CPath::getPathAlgo(boss.data()->path);
+        if (algo && algo->usesRegions())
+            CRegions::get(boss);
+    }
     m_sfx.clear();
     resetStats();
     m_report = currentMapReport();
+    if (!m_quiet)
+    {
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (prefetched)
+        {
+            LOGI("level %d loaded in %.2f ms (prepared ahead in %.2f ms)", m_level + 1, ms, prepared.usecs / 1000.0);
+        }
+        else
+        {
+            LOGI("level %d loaded in %.2f ms", m_level + 1, ms);
+        }
+    }
     return true;
 }
 
@@ -405,15 +483,37 @@ bool CGame::loadLevel(const GameMode mode)
 void CGame::nextLevel()
 {
     addPoints(LEVEL_BONUS + m_health);
-    addPoints(m_map.states().getU(TIMEOUT) * 2);
+    addPoints(m_map.statesConst().getU(TIMEOUT) * 2);
+    m_level = nextLevelIndex();
+}
+
+/**
+ * @brief Level that follows the current one. Wraps back to 0.
+ *
+ * @return int
+ */
+int CGame::nextLevelIndex() const
+{
     if (m_level != static_cast<int>(m_mapArch->size()) - 1)
-    {
-        ++m_level;
-    }
-    else
-    {
-        m_level = 0;
-    }
+        return m_level + 1;
+    return 0;
+}
+
+/**
+ * @brief Prepare a level in the background ahead of loadLevel()
+ *
+ * Meant for the screens shown between levels. loadLevel() swaps the
+ * prepared map in if it asks for that level next.
+ *
+ * @param level
+ */
+void CGame::prefetchLevel(const int level)
+{
+    if (!m_mapArch || level < 0 || level >= static_cast<int>(m_mapArch->size()))
+        return;
+    if (!m_prefetch)
+        m_prefetch = std::make_unique<CLevelPrefetch>();
+    m_prefetch->submit(level, *m_mapArch->at(level));
 }
 
 /**
@@ -524,10 +624,12 @@ int CGame::level() const
  */
 void CGame::setMapArch(CMapArch *arch)
 {
+    if (m_prefetch && arch != m_mapArch)
+        m_prefetch->cancel();
     m_mapArch = arch;
 }
 
-bool CGame::isMonsterType(const uint8_t typeID) const
+bool CGame::isMonsterType(const uint8_t typeID)
 {
     std::array<uint8_t, 8> monsterTypes = {
         TYPE_MONSTER,
@@ -555,20 +657,39 @@ bool CGame::isMonsterType(const uint8_t typeID) const
 bool CGame::spawnMonsters()
 {
     m_monsters.clear();
+    m_projectiles.clear();
     m_bosses.clear();
-    for (int y = 0; y < m_map.hei(); ++y)
+    auto spawnAt = [this](const int x, const int y)
     {
-        for (int x = 0; x < m_map.len(); ++x)
+        uint8_t c = m_map.at(x, y);
+        const TileDef &def = getTileDef(c);
+        if (isMonsterType(def.type))
         {
-            uint8_t c = m_map.at(x, y);
-            const TileDef &def = getTileDef(c);
-            if (isMonsterType(def.type))
-            {
-                if (isPushable(def.type))
-                    m_monsters.emplace_back(std::move(CActor(x, y, def.type, JoyAim::AIM_NONE)));
-                else
-                    m_monsters.emplace_back(std::move(CActor(x, y, def.type)));
-            }
+            if (isBulletType(def.type))
+                m_projectiles.spawn(CActor(x, y, def.type), m_monsters.size());
+            else if (isPushable(def.type))
+                m_monsters.emplace_back(std::move(CActor(x, y, def.type, JoyAim::AIM_NONE)));
+            else
+                m_monsters.emplace_back(std::move(CActor(x, y, def.type)));
+        }
+    };
+    std::vector<uint32_t> changed;
+    if (changedTiles(changed))
+    {
+        // only the monsters of the archive level and the tiles changed since
+        std::vector<uint32_t> tiles;
+        tiles.reserve(m_levelCache.spawns.size() + changed.size());
+        std::set_union(m_levelCache.spawns.begin(), m_levelCache.spawns.end(),
+                       changed.begin(), changed.end(), std::back_inserter(tiles));
+        for (const uint32_t i : tiles)
+            spawnAt(i % m_map.len(), i / m_map.len());
+    }
+    else
+    {
+        for (int y = 0; y < m_map.hei(); ++y)
+        {
+            for (int x = 0; x < m_map.len(); ++x)
+                spawnAt(x, y);
         }
     }
 
@@ -610,10 +731,12 @@ bool CGame::spawnMonsters()
 
     // create a map of all monsters
     rebuildMonsterGrid();
+    m_scheduler.invalidate();
 
     if (!m_quiet)
     {
         LOGI("%zu actors found.", m_monsters.size());
+        LOGI("%zu projectiles found.", m_projectiles.size());
         LOGI("%zu bosses found.", m_bosses.size());
     }
     return true;
@@ -643,6 +766,7 @@ int CGame::findMonsterAt(const int x, const int y) const
  */
 uint8_t CGame::managePlayer(const uint8_t *joystate)
 {
+    const Scope scope(*this);
     auto const pu = m_player.getPU();
     const TileDef &def = getTileDef(pu);
     if (pu == TILES_SWAMP && m_gameStats->get(S_BOAT) == 0)
@@ -676,6 +800,7 @@ uint8_t CGame::managePlayer(const uint8_t *joystate)
  */
 Pos CGame::translate(const Pos &p, const int aim)
 {
+    const CMap &map = getMap();
     Pos t = p;
 
     switch (aim)
@@ -687,7 +812,7 @@ Pos CGame::translate(const Pos &p, const int aim)
         }
         break;
     case AIM_DOWN:
-        if (t.y < m_map.hei() - 1)
+        if (t.y < map.hei() - 1)
         {
             ++t.y;
         }
@@ -699,7 +824,7 @@ Pos CGame::translate(const Pos &p, const int aim)
         }
         break;
     case AIM_RIGHT:
-        if (t.x < m_map.len() - 1)
+        if (t.x < map.len() - 1)
         {
             ++t.x;
         }
@@ -717,14 +842,7 @@ Pos CGame::translate(const Pos &p, const int aim)
  */
 bool CGame::hasKey(const uint8_t c)
 {
-    for (uint32_t i = 0; i < MAX_KEYS; ++i)
-    {
-        if (m_keys.tiles[i] == c)
-        {
-            return true;
-        }
-    }
-    return false;
+    return c != '\0' && current().m_keyMask.test(c);
 }
 
 /**
@@ -744,6 +862,7 @@ void CGame::addKey(const uint8_t c)
         {
             m_keys.tiles[i] = c;
             m_keys.indicators[i] = MAX_KEY_STATE;
+            m_keyMask.set(c);
             break;
         }
     }
@@ -793,6 +912,8 @@ int CGame::clearAttr(const uint8_t attr)
         m_map.setAttr(x, y, 0);
         m_sfx.emplace_back(sfx_t{.x = x, .y = y, .sfxID = SFX_SPARKLE, .timeout = SFX_SPARKLE_TIMEOUT});
     }
+    if (count)
+        m_scheduler.invalidate();
     return count;
 }
 
@@ -849,7 +970,7 @@ void CGame::checkClosure()
     }
     else if (!isClosure() && isLevelCompleted()) // !m_diamonds
     {
-        const uint16_t exitKey = m_map.states().getU(POS_EXIT);
+        const uint16_t exitKey = m_map.statesConst().getU(POS_EXIT);
         if (exitKey != 0)
         {
             // Exit Notification Message
@@ -978,7 +1099,7 @@ int CGame::health() const
  */
 CGame::userKeys_t &CGame::keys()
 {
-    return m_keys;
+    return current().m_keys;
 }
 
 /**
@@ -1061,6 +1182,16 @@ CActor &CGame::getMonster(int i)
     return m_monsters[i];
 }
 
+/**
+ * @brief get the projectiles in flight
+ *
+ * @return const CProjectiles&
+ */
+const CProjectiles &CGame::projectiles() const
+{
+    return m_projectiles;
+}
+
 bool CGame::validateSignature(const char *signature, const uint32_t version)
 {
     if (memcmp(signature, GAME_SIGNATURE, sizeof(GAME_SIGNATURE)) != 0)
@@ -1076,7 +1207,7 @@ bool CGame::validateSignature(const char *signature, const uint32_t version)
         LOGW("savefile signature mismatch: `%s` -- expecting `%s`", signature, gameSig);
         return false;
     }
-    if (version != ENGINE_VERSION)
+    if (version != ENGINE_VERSION && version != FULLMAP_VERSION)
     {
         LOGW("savegame version mismatched: 0x%.8x -- expecting 0x%.8x", version, ENGINE_VERSION);
         return false;
@@ -1093,6 +1224,7 @@ bool CGame::validateSignature(const char *signature, const uint32_t version)
  */
 bool CGame::read(IFile &sfile)
 {
+    const Scope scope(*this);
     auto readfile = [&sfile](auto ptr, auto size)
     {
         return sfile.read(ptr, size) == 1;
@@ -1110,6 +1242,59 @@ bool CGame::read(IFile &sfile)
     uint32_t indexPtr = 0;
     _R(&indexPtr, sizeof(indexPtr));
 
+    if (version == FULLMAP_VERSION)
+    {
+        if (!readPlayer(sfile))
+            return false;
+        if (!getMap().read(sfile))
+        {
+            LOGE("failed to read map");
+            return false;
+        }
+        return readActors(sfile);
+    }
+
+    // everything else is deflated
+    uint32_t size = 0;
+    _R(&size, sizeof(size));
+    uint32_t packedSize = 0;
+    _R(&packedSize, sizeof(packedSize));
+    const long left = sfile.getSize() - sfile.tell();
+    if (size == 0 || size > MAX_SAVE_SIZE || packedSize == 0 || packedSize > compressBound(size) ||
+        left < 0 || packedSize > static_cast<unsigned long>(left))
+    {
+        LOGE("invalid savegame size: %u bytes deflated to %u, %ld left in file", size, packedSize, left);
+        return false;
+    }
+    std::vector<uint8_t> packed(packedSize);
+    _R(packed.data(), packed.size());
+    std::vector<uint8_t> data(size);
+    uLongf dataSize = size;
+    if (uncompress(data.data(), &dataSize, packed.data(), packed.size()) != Z_OK ||
+        dataSize != size)
+    {
+        LOGE("failed to inflate savegame");
+        return false;
+    }
+    CFileMem body;
+    body.replace(data.data(), data.size());
+    return readPlayer(body) && readMap(body) && readActors(body);
+}
+
+/**
+ * @brief Read the counters, keys, player and game stats
+ *
+ * @param sfile
+ * @return true
+ * @return false
+ */
+bool CGame::readPlayer(IFile &sfile)
+{
+    auto readfile = [&sfile](auto ptr, auto size)
+    {
+        return sfile.read(ptr, size) == 1;
+    };
+
     // general information
     _R(&m_lives, sizeof(m_lives));
     _R(&m_health, sizeof(m_health));
@@ -1117,6 +1302,7 @@ bool CGame::read(IFile &sfile)
     _R(&m_nextLife, sizeof(m_nextLife));
     _R(&m_diamonds, sizeof(m_diamonds));
     _R(m_keys.tiles, sizeof(m_keys.tiles));
+    syncKeyMask();
     clearKeyIndicators();
     _R(&m_score, sizeof(m_score));
     if (!m_player.read(sfile))
@@ -1129,38 +1315,64 @@ bool CGame::read(IFile &sfile)
         LOGE("failed to read gamestats");
         return false;
     };
+    return true;
+}
 
-    // reading map
-    CMap &map = getMap();
-    if (!map.read(sfile))
+/**
+ * @brief Read the monsters, projectiles, bosses, used items and sfx
+ *
+ * @param sfile
+ * @return true
+ * @return false
+ */
+bool CGame::readActors(IFile &sfile)
+{
+    auto readfile = [&sfile](auto ptr, auto size)
     {
-        LOGE("failed to read map");
-        return false;
-    }
+        return sfile.read(ptr, size) == 1;
+    };
 
     // monsters
     uint32_t actorCount = 0;
     _R(&actorCount, sizeof(uint32_t));
     m_monsters.clear();
-    m_monsters.resize(actorCount);
+    m_projectiles.clear();
     for (size_t i = 0; i < actorCount; ++i)
     {
-        if (!m_monsters[i].read(sfile))
+        CActor actor;
+        if (!actor.read(sfile))
         {
             LOGE("failed to read actor %lu of %u", i, actorCount);
             return false;
         }
+        if (!isBulletType(actor.type()))
+            m_monsters.emplace_back(std::move(actor));
+        else
+            m_projectiles.spawn(std::move(actor), m_monsters.size());
     }
     rebuildMonsterGrid();
+    m_scheduler.invalidate();
 
     // bosses
     uint32_t bossCount = 0;
     readfile(&bossCount, sizeof(uint32_t));
     m_bosses.clear();
-    m_bosses.resize(bossCount);
+    m_bosses.reserve(bossCount);
     for (size_t i = 0; i < bossCount; ++i)
     {
-        if (!m_bosses[i].read(sfile))
+        // peek at the boss type so the boss is built with its data
+        const long pos = sfile.tell();
+        uint8_t type = 0;
+        _R(&type, sizeof(type));
+        const bossData_t *data = getBossData(type);
+        if (!data)
+        {
+            LOGE("invalid type 0x%.2x for boss %lu of %u", type, i, bossCount);
+            return false;
+        }
+        sfile.seek(pos);
+        m_bosses.emplace_back(0, 0, data);
+        if (!m_bosses.back().read(sfile))
         {
             LOGE("failed to read boss %lu of %u", i, bossCount);
             return false;
@@ -1219,6 +1431,135 @@ bool CGame::write(IFile &tfile)
     uint32_t indexPtr = 0;
     _W(&indexPtr, sizeof(indexPtr));
 
+    CFileMem body;
+    body.open("", "wb");
+    if (!writePlayer(body) || !writeMap(body) || !writeActors(body))
+        return false;
+    std::vector<uint8_t> packed;
+    if (compressData(body.buffer(), packed) != Z_OK)
+    {
+        LOGE("failed to deflate savegame");
+        return false;
+    }
+    const uint32_t size = body.buffer().size();
+    _W(&size, sizeof(size));
+    const uint32_t packedSize = packed.size();
+    _W(&packedSize, sizeof(packedSize));
+    _W(packed.data(), packed.size());
+    return true;
+}
+
+/**
+ * @brief Read the map written by writeMap()
+ *
+ * A delta is applied to the archive level it was made from. That level
+ * must still have the same hash and size.
+ *
+ * @param sfile
+ * @return true
+ * @return false
+ */
+bool CGame::readMap(IFile &sfile)
+{
+    auto readfile = [&sfile](auto ptr, auto size)
+    {
+        return sfile.read(ptr, size) == 1;
+    };
+
+    uint8_t format = MAP_FULL;
+    _R(&format, sizeof(format));
+    if (format == MAP_FULL)
+    {
+        if (!m_map.read(sfile))
+        {
+            LOGE("failed to read map");
+            return false;
+        }
+        return true;
+    }
+    else if (format != MAP_DELTA)
+    {
+        LOGE("unknown map format: %d", format);
+        return false;
+    }
+
+    uint64_t hash = 0;
+    _R(&hash, sizeof(hash));
+    uint32_t level = 0;
+    _R(&level, sizeof(level));
+    uint16_t len = 0;
+    _R(&len, sizeof(len));
+    uint16_t hei = 0;
+    _R(&hei, sizeof(hei));
+    const CMap *base = m_mapArch ? m_mapArch->at(static_cast<int>(level)) : nullptr;
+    if (!base || base->hash() != hash || base->len() != len || base->hei() != hei)
+    {
+        LOGE("savegame level %u (%dx%d, %.16" PRIx64 ") not found in the archive", level, len, hei, hash);
+        return false;
+    }
+    if (!m_map.readDelta(sfile, *base))
+    {
+        LOGE("failed to read map delta");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Write the map as its changes to the level in the archive
+ *
+ * The level is identified by its index, hash and size. Maps that no longer
+ * match the archive layout are written whole.
+ *
+ * @param tfile
+ * @return true
+ * @return false
+ */
+bool CGame::writeMap(IFile &tfile)
+{
+    auto writefile = [&tfile](auto ptr, auto size)
+    {
+        return tfile.write(ptr, size) == 1;
+    };
+
+    const CMap *base = m_mapArch ? m_mapArch->at(m_level) : nullptr;
+    const uint8_t format = base && base->len() == m_map.len() && base->hei() == m_map.hei()
+                               ? MAP_DELTA
+                               : MAP_FULL;
+    _W(&format, sizeof(format));
+    if (format == MAP_FULL)
+    {
+        if (!m_map.write(tfile))
+        {
+            LOGE("failed to write map");
+            return false;
+        }
+        return true;
+    }
+
+    const uint64_t hash = base->hash();
+    _W(&hash, sizeof(hash));
+    const uint32_t level = m_level;
+    _W(&level, sizeof(level));
+    const uint16_t len = base->len();
+    _W(&len, sizeof(len));
+    const uint16_t hei = base->hei();
+    _W(&hei, sizeof(hei));
+    if (!m_map.writeDelta(tfile, *base))
+    {
+        LOGE("failed to write map delta");
+        return false;
+    }
+    return true;
+}
+
+bool CGame::writePlayer(IFile &tfile)
+{
+    auto writefile = [&tfile](auto ptr, auto size)
+    {
+        return tfile.write(ptr, size) == 1;
+    };
+
     // write general information
     _W(&m_lives, sizeof(m_lives));
     _W(&m_health, sizeof(m_health));
@@ -1237,26 +1578,31 @@ bool CGame::write(IFile &tfile)
         LOGE("failed write gameStats");
         return false;
     }
+    return true;
+}
 
-    // saving map
-    CMap &map = getMap();
-    if (!map.write(tfile))
+bool CGame::writeActors(IFile &tfile)
+{
+    auto writefile = [&tfile](auto ptr, auto size)
     {
-        LOGE("failed to write map");
-        return false;
-    }
+        return tfile.write(ptr, size) == 1;
+    };
 
-    // monsters
-    size_t actorCount = m_monsters.size();
+    // monsters and projectiles, in the order they were created
+    size_t actorCount = m_monsters.size() + m_projectiles.size();
     _W(&actorCount, sizeof(uint32_t));
-    for (size_t i = 0; i < m_monsters.size(); ++i)
-    {
-        if (!m_monsters[i].write(tfile))
-        {
-            LOGE("failed to write actor %lu of %lu", i, actorCount);
-            return false;
-        }
-    }
+    size_t index = 0;
+    bool result = true;
+    visitActors([&](const CActor &actor)
+                {
+                    if (result && !actor.write(tfile))
+                    {
+                        LOGE("failed to write actor %lu of %lu", index, actorCount);
+                        result = false;
+                    }
+                    ++index; });
+    if (!result)
+        return false;
 
     // bosses
     size_t bossCount = m_bosses.size();
@@ -1285,6 +1631,98 @@ bool CGame::write(IFile &tfile)
     return true;
 }
 
+/**
+ * @brief Save the game state minus the map tiles
+ *
+ * Same content as write() without the tiles and attributes, which a
+ * rewind keeps as CMap snapshots, and with the map states and the
+ * random generator added.
+ *
+ * @param tfile
+ * @return true
+ * @return false
+ */
+bool CGame::writeState(IFile &tfile)
+{
+    auto writefile = [&tfile](auto ptr, auto size)
+    {
+        return tfile.write(ptr, size) == 1;
+    };
+    if (!writePlayer(tfile))
+        return false;
+    if (!m_map.statesConst().write(tfile))
+    {
+        LOGE("failed to write map states");
+        return false;
+    }
+    if (!writeActors(tfile))
+        return false;
+    _W(&m_random, sizeof(m_random));
+    return true;
+}
+
+/**
+ * @brief Load a state saved with writeState()
+ *
+ * The map tiles must be restored first.
+ *
+ * @param sfile
+ * @return true
+ * @return false
+ */
+bool CGame::readState(IFile &sfile)
+{
+    const Scope scope(*this);
+    auto readfile = [&sfile](auto ptr, auto size)
+    {
+        return sfile.read(ptr, size) == 1;
+    };
+    if (!readPlayer(sfile))
+        return false;
+    if (!m_map.states().read(sfile))
+    {
+        LOGE("failed to read map states");
+        return false;
+    }
+    if (!readActors(sfile))
+        return false;
+    _R(&m_random, sizeof(m_random));
+    return true;
+}
+
+/**
+ * @brief Digest of the state that gameplay depends on
+ *
+ * Two runs of the same recording must end on the same value. The tiles
+ * and attributes come from the hash the map keeps up to date on every
+ * write; the counters, keys, player, monsters, projectiles, bosses and
+ * random generator are folded in here, which only costs a pass over
+ * the actors.
+ *
+ * @return uint64_t Zobrist hash
+ */
+uint64_t CGame::stateHash() const
+{
+    using namespace Zobrist;
+    uint64_t hash = m_map.hash() ^ m_gameStats->hash();
+    const int counters[] = {m_level, m_score, m_lives, m_health, m_diamonds, m_nextLife};
+    for (size_t i = 0; i < std::size(counters); ++i)
+        hash ^= key(GAME, i, counters[i]);
+    for (size_t i = 0; i < std::size(m_keys.tiles); ++i)
+        hash ^= key(KEY, i, m_keys.tiles[i]);
+    hash ^= key(PLAYER, CMap::toKey(m_player.pos()), m_player.type() | m_player.getAim() << 8);
+    visitActors([&hash](const CActor &actor)
+                { hash ^= key(ACTOR, CMap::toKey(actor.pos()), actor.type() | actor.getAim() << 8); });
+    for (size_t i = 0; i < m_bosses.size(); ++i)
+    {
+        const CBoss &boss = m_bosses[i];
+        hash ^= key(BOSS, i, static_cast<uint16_t>(boss.x()) | static_cast<uint16_t>(boss.y()) << 16);
+        hash ^= key(BOSS, i | 0x8000, boss.hp() | boss.type() << 24);
+    }
+    hash ^= key(RNG, 0, m_random.state());
+    return hash;
+}
+
 /**
  * @brief set lives count for the player
  *
@@ -1466,7 +1904,20 @@ int CGame::sugar() const
  */
 MapReport CGame::currentMapReport()
 {
-    return generateMapReport(m_map);
+    std::vector<uint32_t> changed;
+    if (!changedTiles(changed))
+        return generateMapReport(m_map);
+    MapReport report = m_levelCache.report;
+    const CMap &base = *m_levelCache.base;
+    for (const uint32_t i : changed)
+    {
+        const int x = i % m_map.len();
+        const int y = i / m_map.len();
+        countPickups(report, base.at(x, y), -1);
+        countPickups(report, m_map.at(x, y), 1);
+    }
+    report.secrets = countSecrets(m_map.attrs());
+    return report;
 }
 
 /**
@@ -1488,27 +1939,120 @@ MapReport CGame::generateMapReport(CMap &map)
         }
     }
 
+    report.bonuses = 0;
+    report.fruits = 0;
+    report.secrets = countSecrets(map.attrs());
+    for (const auto &[tile, count] : tiles)
+        countPickups(report, tile, count);
+    return report;
+}
+
+/**
+ * @brief Add fruits and bonus items to a map report
+ *
+ * @param report
+ * @param tile
+ * @param count number of tiles added, negative for tiles removed
+ */
+void CGame::countPickups(MapReport &report, const uint8_t tile, const int count)
+{
+    const TileDef &def = getTileDef(tile);
+    if (def.type != TYPE_PICKUP)
+        return;
+    if (isFruit(tile))
+        report.fruits += count;
+    if (isBonusItem(tile))
+        report.bonuses += count;
+}
+
+/**
+ * @brief Number of distinct secrets on a map
+ *
+ * @param attrs
+ * @return int
+ */
+int CGame::countSecrets(const AttrMap &attrs)
+{
     std::unordered_map<uint8_t, int> secrets;
-    const AttrMap &attrs = map.attrs();
     for (const auto &[k, v] : attrs)
     {
         if (RANGE(v, SECRET_ATTR_MIN, SECRET_ATTR_MAX))
             ++secrets[v];
     }
-    report.bonuses = 0;
-    report.fruits = 0;
-    report.secrets = secrets.size();
-    for (const auto [tile, count] : tiles)
+    return secrets.size();
+}
+
+/**
+ * @brief Scan an archive level once for what every copy of it starts with
+ *
+ * Only reads the map; safe to call off the game thread.
+ *
+ * @param cache
+ * @param base
+ */
+void CGame::cacheLevel(levelCache_t &cache, const CMap &base)
+{
+    cache.base = &base;
+    cache.baseId = base.id();
+    cache.baseChanges = base.changeCount();
+    cache.spawns.clear();
+    cache.report = MapReport{0, 0, 0};
+    cache.diamonds = 0;
+    for (int y = 0; y < base.hei(); ++y)
     {
-        const TileDef &def = getTileDef(tile);
-        if (def.type != TYPE_PICKUP)
-            continue;
-        if (isFruit(tile))
-            report.fruits += count;
-        if (isBonusItem(tile))
-            report.bonuses += count;
+        for (int x = 0; x < base.len(); ++x)
+        {
+            const uint8_t tile = base.at(x, y);
+            if (isMonsterType(getTileDef(tile).type))
+                cache.spawns.push_back(x + y * base.len());
+            countPickups(cache.report, tile, 1);
+            cache.diamonds += tile == TILES_DIAMOND;
+        }
     }
-    return report;
+}
+
+/**
+ * @brief Tiles of the current map that were written since it was copied
+ *        from the archive level
+ *
+ * @param tiles tile indices, sorted and without duplicates
+ * @return true
+ * @return false the map was replaced or rewritten since, or too many
+ *         tiles changed: it has to be scanned whole
+ */
+bool CGame::changedTiles(std::vector<uint32_t> &tiles) const
+{
+    tiles.clear();
+    if (!m_levelCache.base)
+        return false;
+    const int len = m_map.len();
+    if (!m_map.visitChanges(m_levelCache.changes, [&tiles, len](const Pos &pos)
+                            { tiles.push_back(pos.x + pos.y * len); }))
+        return false;
+    std::sort(tiles.begin(), tiles.end());
+    tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+    return true;
+}
+
+/**
+ * @brief Number of diamonds on the current map
+ *
+ * @return int
+ */
+int CGame::countDiamonds() const
+{
+    std::vector<uint32_t> changed;
+    if (!changedTiles(changed))
+        return m_map.count(TILES_DIAMOND);
+    int diamonds = m_levelCache.diamonds;
+    const CMap &base = *m_levelCache.base;
+    for (const uint32_t i : changed)
+    {
+        const int x = i % m_map.len();
+        const int y = i / m_map.len();
+        diamonds += (m_map.at(x, y) == TILES_DIAMOND) - (base.at(x, y) == TILES_DIAMOND);
+    }
+    return diamonds;
 }
 
 /**
@@ -1668,6 +2212,19 @@ void CGame::incTimeTaken()
 void CGame::resetKeys()
 {
     memset(&m_keys, '\0', sizeof(m_keys));
+    m_keyMask.reset();
+}
+
+/**
+ * @brief Rebuild the key-state mask from the key inventory
+ *
+ */
+void CGame::syncKeyMask()
+{
+    m_keyMask.reset();
+    for (const auto &c : m_keys.tiles)
+        if (c != '\0')
+            m_keyMask.set(c);
 }
 
 void CGame::decKeyIndicators()
@@ -1709,14 +2266,16 @@ void CGame::deleteMonster(const int i)
 
     // Remove from vector
     m_monsters.erase(m_monsters.begin() + i);
+    m_projectiles.eraseMonster(i);
 
     // Rebuild indices
     rebuildMonsterGrid();
+    m_scheduler.erase(i);
 }
 
 Random &CGame::getRandom()
 {
-    return g_randomz;
+    return current().m_random;
 }
 
 bool CGame::isBulletType(const uint8_t typeID)
@@ -1750,6 +2309,7 @@ bool CGame::shadowActorMove(CActor &actor, const JoyAim aim)
     {
         m_monsterGrid[CMap::toKey(newPos.x, newPos.y)] = monsterIndex;
         actor.move(aim);
+        scheduleMonster(monsterIndex);
         return true;
     }
     return false;
@@ -1771,4 +2331,39 @@ void CGame::updateMonsterGrid(const CActor &actor, const int monsterIndex)
     const Pos pos = actor.pos();
     if (monsterIndex != INVALID && m_map.isValid(pos.x, pos.y))
         m_monsterGrid[CMap::toKey(pos.x, pos.y)] = monsterIndex;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Rebuild the monster scheduler from scratch
+ *
+ */
+void CGame::scheduleMonsters()
+{
+    m_scheduler.clear();
+    for (size_t i = 0; i < m_monsters.size(); ++i)
+        scheduleMonster(i);
+}
+
+/**
+ * @brief File a monster under its speed bucket or the dormant set
+ *
+ * @param index monster index
+ */
+void CGame::scheduleMonster(const int index)
+{
+    if (index == INVALID || index >= static_cast<int>(m_monsters.size()))
+        return;
+    const CActor &actor = m_monsters[index];
+    const Pos pos = actor.pos();
+    if (!m_map.isValid(pos.x, pos.y))
+    {
+        m_scheduler.assign(index, 0, pos);
+        return;
+    }
+    const uint8_t attr = m_map.getAttr(pos.x, pos.y);
+    if (RANGE(attr, ATTR_IDLE_MIN, ATTR_IDLE_MAX))
+        m_scheduler.assign(index, CScheduler::DORMANT, pos);
+    else
+        m_scheduler.assign(index, getTileDef(m_map.at(pos.x, pos.y)).speed, pos);
+}
+
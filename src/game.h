@@ -22,16 +22,22 @@
 #include <set>
 #include <unordered_map>
 #include <memory>
+#include <memory_resource>
+#include <bitset>
 #include "actor.h"
 #include "map.h"
 #include "events.h"
+#include "scheduler.h"
+#include "arena.h"
+#include "projectiles.h"
+#include "randomz.h"
 
 class CGameStats;
 class CMapArch;
 class ISound;
 class CBoss;
-class Random;
 class IFile;
+class CLevelPrefetch;
 struct TileDef;
 enum Event;
 enum Sfx : uint16_t;
@@ -44,6 +50,24 @@ struct MapReport
     int secrets;
 };
 
+using monsterList_t = std::pmr::vector<CActor>;
+using deletedList_t = std::pmr::set<int, std::greater<int>>;
+
+/**
+ * @brief What CGame knows of the archive level the current map was copied from
+ *
+ */
+struct levelCache_t
+{
+    const CMap *base = nullptr;   // archive map
+    uint32_t baseId = 0;          // base->id() when cached
+    uint32_t baseChanges = 0;     // base->changeCount() when cached
+    uint32_t changes = 0;         // changeCount() of the game map right after the copy
+    std::vector<uint32_t> spawns; // tiles of base holding a monster, in scan order
+    MapReport report;             // pickups on base; secrets are not counted
+    int diamonds = 0;             // diamonds on base
+};
+
 struct bulletData_t
 {
     uint8_t sound;
@@ -97,6 +121,28 @@ public:
         uint8_t indicators[MAX_KEYS];
     };
 
+    /**
+     * @brief Binds a game to the calling thread for the lifetime of the scope
+     *
+     * Actors, bosses and the path finders reach the map, the keys and the
+     * random generator through the static accessors of CGame. Those resolve
+     * to the game bound to the calling thread, or to the default game from
+     * getGame() when none is. Scopes nest; the previous binding comes back
+     * when the scope ends.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(CGame &game);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        CGame *m_previous;
+    };
+
+    CGame();
     ~CGame();
     bool loadLevel(const GameMode mode);
     bool move(const JoyAim dir);
@@ -111,6 +157,8 @@ public:
     static CMap &getMap();
     void nextLevel();
     void restartLevel();
+    int nextLevelIndex() const;
+    void prefetchLevel(const int level);
     void restartGame();
     void setMode(const GameMode mode);
     GameMode mode() const;
@@ -133,6 +181,7 @@ public:
     static userKeys_t &keys();
     std::vector<CActor> &getMonsters();
     CActor &getMonster(int i);
+    const CProjectiles &projectiles() const;
     std::vector<sfx_t> &getSfx();
     void playSound(const int id) const;
     void playTileSound(const int tileID) const;
@@ -147,6 +196,7 @@ public:
     int getEvent();
     void purgeSfx();
     static CGame *getGame();
+    static CGame &current();
     static void destroy();
     bool isClosure() const;
     bool isLevelCompleted() const;
@@ -158,6 +208,7 @@ public:
     int getUserID() const;
     void setUserID(const int userID) const;
     static MapReport generateMapReport(CMap &map);
+    static void cacheLevel(levelCache_t &cache, const CMap &base);
     MapReport currentMapReport();
     const MapReport &originalMapReport();
     int timeTaken();
@@ -168,12 +219,15 @@ public:
     void setDefaultLives(int lives);
     bool read(IFile &sfile);
     bool write(IFile &tfile);
+    bool readState(IFile &sfile);
+    bool writeState(IFile &tfile);
+    uint64_t stateHash() const;
     const std::vector<CBoss> &bosses();
     int findMonsterAt(const int x, const int y) const;
     void deleteMonster(const int i);
     static Random &getRandom();
     static bool validateSignature(const char *signature, const uint32_t version);
-    bool isMonsterType(const uint8_t typeID) const;
+    static bool isMonsterType(const uint8_t typeID);
     static bool isFruit(const uint8_t tileID);
     static bool isBonusItem(const uint8_t tileID);
     static bool isBulletType(const uint8_t typeID);
@@ -196,7 +250,8 @@ private:
     int m_score = 0;
     int m_nextLife;
     int m_diamonds = 0;
-    inline static userKeys_t m_keys;
+    userKeys_t m_keys{};
+    std::bitset<256> m_keyMask; // tiles held in m_keys
     GameMode m_mode;
     int m_introHint = 0;
     std::vector<Event> m_events;
@@ -209,19 +264,38 @@ private:
     std::vector<std::string> m_hints;
     std::unique_ptr<CGameStats> m_gameStats;
     std::vector<Pos> m_usedItems;
-    std::unordered_map<uint16_t, int> m_monsterGrid;
+    std::pmr::unsynchronized_pool_resource m_gridPool;
+    std::pmr::unordered_map<uint16_t, int> m_monsterGrid{&m_gridPool};
+    CScheduler m_scheduler;
+    CProjectiles m_projectiles;
+    CArena m_arena;
+    std::vector<int> m_blastGrid;
     MapReport m_report;
+    levelCache_t m_levelCache;
+    std::unique_ptr<CLevelPrefetch> m_prefetch; // started on first use
     int m_defaultLives;
     bool m_quiet = false;
+    bool readPlayer(IFile &sfile);
+    bool writePlayer(IFile &tfile);
+    bool readMap(IFile &sfile);
+    bool writeMap(IFile &tfile);
+    bool readActors(IFile &sfile);
+    bool writeActors(IFile &tfile);
     void resetKeys();
+    void syncKeyMask();
     void clearKeyIndicators();
     void setQuiet(bool state);
     void rebuildMonsterGrid();
     void updateMonsterGrid(const CActor &actor, const int index);
+    void scheduleMonsters();
+    void scheduleMonster(const int index);
 
-    CGame();
     int clearAttr(const uint8_t attr);
     bool spawnMonsters();
+    bool changedTiles(std::vector<uint32_t> &tiles) const;
+    int countDiamonds() const;
+    static void countPickups(MapReport &report, const uint8_t tile, const int count);
+    static int countSecrets(const AttrMap &attrs);
     void addHealth(const int hp);
     void addPoints(const int points);
     void addLife();
@@ -233,14 +307,33 @@ private:
     // regular monsters (mob)
     void handleMonster(CActor &actor, const TileDef &def);
     void handleDrone(CActor &actor, const TileDef &def);
-    void handleVamPlant(CActor &actor, const TileDef &def, std::vector<CActor> &newMonsters);
+    void handleVamPlant(CActor &actor, const TileDef &def, monsterList_t &newMonsters);
     void handleCrusher(CActor &actor, const bool speeds[]);
     void handleIceCube(CActor &actor);
-    void handleBullet(CActor &actor, const TileDef &def, const int i, const bulletData_t &bullet, std::set<int, std::greater<int>> &deletedMonsters);
-    void handleBarrel(CActor &actor, const TileDef &def, const int i, std::set<int, std::greater<int>> &deletedMonsters);
+    void handleBarrel(CActor &actor, const TileDef &def, const int i, deletedList_t &deletedMonsters);
     bool pushChain(const int x, const int y, const JoyAim aim);
     bool fuseBarrel(const Pos &pos);
-    void blastRadius(const Pos &pos, const size_t radius, const int damage, std::set<int, std::greater<int>> &deletedMonsters);
+    void blastRadius(const Pos &pos, const size_t radius, const int damage, deletedList_t &deletedMonsters);
+    void blastBosses(const Pos &pos, const int radius, const int damage);
+
+    // projectiles
+    void manageProjectiles(const int limit, const bool speeds[], deletedList_t &deletedMonsters);
+    void handleBullet(CActor &actor, const TileDef &def, const int i);
+    void resolveImpacts(deletedList_t &deletedMonsters);
+    template <typename Visitor>
+    void visitActors(Visitor visitor) const
+    {
+        // monsters and projectiles in the order they were created
+        size_t j = 0;
+        for (size_t i = 0; i < m_monsters.size(); ++i)
+        {
+            for (; j < m_projectiles.size() && m_projectiles.order(j) <= static_cast<int>(i); ++j)
+                visitor(m_projectiles[j]);
+            visitor(m_monsters[i]);
+        }
+        for (; j < m_projectiles.size(); ++j)
+            visitor(m_projectiles[j]);
+    }
 
     // boss
     CActor *spawnBullet(int x, int y, JoyAim aim, uint8_t tile);
@@ -248,6 +341,7 @@ private:
     bool handleBossBullet(CBoss &boss);
     void handleBossHitboxContact(CBoss &boss);
 
-    inline static CMap m_map;
+    CMap m_map;
+    Random m_random{12345, 0};
     friend class CGameMixin;
 };
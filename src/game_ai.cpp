@@ -39,7 +39,56 @@ namespace Game
         ICE_CUBE_DAMAGE = 16,
         CRUSHER_SPEED_MASK = 3,
         AUTOKILL = -1024,
+        MAX_BOSS_CONTACTS = 16,
     };
+
+    // what a boss hitbox is touching
+    enum Contact : uint8_t
+    {
+        CONTACT_NONE,
+        CONTACT_PLAYER,
+        CONTACT_ICECUBE,
+        CONTACT_BARREL,
+    };
+
+    struct bossContact_t
+    {
+        HitResult hit;
+        Contact kind;
+    };
+
+    struct bossContacts_t
+    {
+        bossContact_t list[MAX_BOSS_CONTACTS];
+        size_t count = 0;
+        bool overflow = false;
+    };
+
+    int blastDamage(const int tx, const int ty, const int damage)
+    {
+        const int distance = (std::abs(tx) + std::abs(ty)) / 2;
+        return distance ? damage / distance : damage;
+    }
+
+    Contact classifyContact(const CMap &map, const HitResult &r)
+    {
+        const uint8_t c = map.at(r.pos.x, r.pos.y);
+        if (c == TILES_ANNIE2)
+            return CONTACT_PLAYER; // check if player is there
+        const TileDef &def = getTileDef(c);
+        if (def.type == TYPE_ICECUBE)
+            return CONTACT_ICECUBE; // check if IceCube
+        if (r.type == BossData::HitBoxType::SPECIAL1 && def.type == TYPE_BARREL)
+            return CONTACT_BARREL; // check if barrel
+        return CONTACT_NONE;
+    }
+
+    const bulletData_t &bulletData(const uint8_t type)
+    {
+        static const bulletData_t fireball{.sound = SOUND_HIT2, .sfxID = SFX_EXPLOSION1, .sfxTimeOut = SFX_EXPLOSION1_TIMEOUT};
+        static const bulletData_t lightningBolt{.sound = SOUND_HIT2, .sfxID = SFX_EXPLOSION7, .sfxTimeOut = SFX_EXPLOSION7_TIMEOUT};
+        return type == TYPE_LIGHTNING_BOLT ? lightningBolt : fireball;
+    }
 }
 
 using namespace Game;
@@ -62,10 +111,7 @@ CActor *CGame::spawnBullet(int x, int y, JoyAim aim, uint8_t tile)
     if (defPU.type == TYPE_BACKGROUND || defPU.type == TYPE_STOP)
     {
         m_map.set(x, y, tile);
-        m_monsters.emplace_back(std::move(actor));
-        int index = m_monsters.size() - 1;
-        updateMonsterGrid(m_monsters[index], index);
-        return &m_monsters[index];
+        return m_projectiles.spawn(std::move(actor), m_monsters.size());
     }
     return nullptr;
 }
@@ -155,75 +201,89 @@ bool CGame::handleBossBullet(CBoss &boss)
 
 void CGame::handleBossHitboxContact(CBoss &boss)
 {
-    int playerDamage = 0;
+    const uint32_t boss_flags = boss.data()->flags;
+    const bool iceDamage = boss_flags & BOSS_FLAG_ICE_DAMAGE;
 
-    //  Attack hitbox: Affect all player tiles it overlaps
-    boss.testHitbox1(m_map, [](const Pos &p, auto type)
-                     {
-                         (void)type;
-                         return m_map.at(p.x, p.y) == TILES_ANNIE2; // check if player is there
-                     },
-                     [boss, this, &playerDamage](const HitResult &r)
+    // classify every covered tile in a single pass
+    const CMap &map = m_map;
+    bossContacts_t contacts;
+    boss.visitHitbox(map, [&map, &contacts, iceDamage](const HitResult &r)
                      {
-                         playerDamage = std::max(boss.damage(r.type), playerDamage); // find player damage
-                     });
+                         const Contact kind = classifyContact(map, r);
+                         if (kind == CONTACT_NONE || (kind == CONTACT_ICECUBE && !iceDamage))
+                             return;
+                         if (contacts.count < MAX_BOSS_CONTACTS)
+                             contacts.list[contacts.count++] = {r, kind};
+                         else
+                             contacts.overflow = true; });
+
+    // apply the contacts of a given kind, in hitbox order. The tile is
+    // checked again since melting an icecube may have changed it.
+    auto forEachContact = [&boss, &map, &contacts](const Contact kind, auto &&action)
+    {
+        if (contacts.overflow)
+        {
+            // buffer too small: rescan the hitboxes instead
+            boss.visitHitbox(map, [&map, kind, &action](const HitResult &r)
+                             {
+                                 if (classifyContact(map, r) == kind)
+                                     action(r); });
+            return;
+        }
+        for (size_t i = 0; i < contacts.count; ++i)
+        {
+            const auto &contact = contacts.list[i];
+            if (contact.kind == kind && classifyContact(map, contact.hit) == kind)
+                action(contact.hit);
+        }
+    };
 
+    //  Attack hitbox: Affect all player tiles it overlaps
+    int playerDamage = 0;
+    forEachContact(CONTACT_PLAYER, [&boss, &playerDamage](const HitResult &r)
+                   {
+                       playerDamage = std::max(boss.damage(r.type), playerDamage); // find player damage
+                   });
     if (playerDamage)
         addHealth(-playerDamage); // hurtPlayer
 
-    const uint32_t boss_flags = boss.data()->flags;
-    if (boss_flags & BOSS_FLAG_ICE_DAMAGE)
-    {
-        boss.testHitbox1(m_map, [](const Pos &pos, auto type)
-                         {
-                             (void)type;
-                             const CMap &map = CGame::getMap();
-                             const auto c = map.at(pos.x, pos.y);
-                             const TileDef &def = getTileDef(c);
-                             return def.type == TYPE_ICECUBE; // check if IceCube
-                         },
-                         [&boss, this](const HitResult &r)
-                         {
-                             const Pos &pos = r.pos;
-                             playSound(SOUND_SPLASH01);
-                             if (r.type != BossData::HitBoxType::SPECIAL1)
-                             {
-                                 const bool justDied = boss.subtainDamage(ICE_CUBE_DAMAGE);
-                                 if (justDied)
-                                     addPoints(boss.data()->score);
-                             }
-
-                             // meltIceCube
-                             CGame *game = CGame::getGame();
-                             CMap &map = CGame::getMap();
-                             int i = game->findMonsterAt(pos.x, pos.y);
-                             if (i != CGame::INVALID)
-                             {
-                                 game->deleteMonster(i);
-                                 game->getSfx().emplace_back(sfx_t{pos.x, pos.y, SFX_EXPLOSION6, SFX_EXPLOSION6_TIMEOUT});
-                                 map.set(pos.x, pos.y, TILES_BLANK);
-                             } //
-                         });
+    if (iceDamage)
+    {
+        forEachContact(CONTACT_ICECUBE, [&boss, this](const HitResult &r)
+                       {
+                           const Pos &pos = r.pos;
+                           playSound(SOUND_SPLASH01);
+                           if (r.type != BossData::HitBoxType::SPECIAL1)
+                           {
+                               const bool justDied = boss.subtainDamage(ICE_CUBE_DAMAGE);
+                               if (justDied)
+                                   addPoints(boss.data()->score);
+                           }
+
+                           // meltIceCube
+                           int i = findMonsterAt(pos.x, pos.y);
+                           if (i != INVALID)
+                           {
+                               deleteMonster(i);
+                               m_sfx.emplace_back(sfx_t{pos.x, pos.y, SFX_EXPLOSION6, SFX_EXPLOSION6_TIMEOUT});
+                               m_map.set(pos.x, pos.y, TILES_BLANK);
+                           } //
+                       });
     }
 
     // test if boss has set off barrel
-    boss.testHitbox1(m_map, [](const Pos &pos, auto type)
-                     {
-                         if (type != BossData::HitBoxType::SPECIAL1)
-                             return false;
-                         const CMap &map = CGame::getMap();
-                         const auto c = map.at(pos.x, pos.y);
-                         const TileDef &def = getTileDef(c);
-                         return def.type == TYPE_BARREL; // check if barrel
-                     },
-                     [&boss, this](const HitResult &r)
-                     {
-                         fuseBarrel(r.pos); // lit fuse for barrel
-                     });
+    forEachContact(CONTACT_BARREL, [this](const HitResult &r)
+                   {
+                       fuseBarrel(r.pos); // lit fuse for barrel
+                   });
 }
 
 void CGame::manageBosses(const int ticks)
 {
+    const Scope scope(*this);
+    // transient containers from the previous step are gone by now
+    m_arena.reset();
+
     auto &rng = getRandom();
     rng.setTick(ticks);
 
@@ -318,8 +378,15 @@ void CGame::manageBosses(const int ticks)
 
 void CGame::manageMonsters(const int ticks)
 {
-    std::vector<CActor> newMonsters;
-    std::set<int, std::greater<int>> deletedMonsters;
+    const Scope scope(*this);
+    // transient containers from the previous step are gone by now
+    m_arena.reset();
+    // the chasers share one distance field per movement class and tick
+    CDistanceField::invalidate();
+    // resumable path searches (AStarSmooth, JPS) share a node budget per tick
+    CPath::beginTick();
+    monsterList_t newMonsters(m_arena.resource());
+    deletedList_t deletedMonsters(m_arena.resource());
 
     auto isDeleted = [&deletedMonsters](int i)
     {
@@ -331,8 +398,15 @@ void CGame::manageMonsters(const int ticks)
     for (uint32_t i = 0; i < sizeof(speeds); ++i)
         speeds[i] = i ? (ticks % i) == 0 : true;
 
-    for (size_t i = 0; i < m_monsters.size(); ++i)
+    // only visit the actors that are due on this tick
+    if (!m_scheduler.isValid(m_monsters.size()))
+        scheduleMonsters();
+    m_scheduler.begin(ticks, m_player.pos());
+    m_projectiles.begin();
+    for (int i = m_scheduler.next(); i != CScheduler::NONE; i = m_scheduler.next())
     {
+        // projectiles created ahead of this monster go first
+        manageProjectiles(i, speeds, deletedMonsters);
         if (isDeleted(i))
             continue;
         CActor &actor = m_monsters[i];
@@ -343,7 +417,10 @@ void CGame::manageMonsters(const int ticks)
         {
             const uint8_t distance = (attr & 0xf) + 1;
             if (actor.distance(m_player) <= distance)
+            {
                 m_map.setAttr(pos.x, pos.y, 0);
+                scheduleMonster(i);
+            }
             else
                 continue;
         }
@@ -372,27 +449,22 @@ void CGame::manageMonsters(const int ticks)
         {
             handleIceCube(actor);
         }
-        else if (actor.type() == TYPE_FIREBALL)
-        {
-            handleBullet(actor, def, i, {.sound = SOUND_HIT2, .sfxID = SFX_EXPLOSION1, .sfxTimeOut = SFX_EXPLOSION1_TIMEOUT}, deletedMonsters);
-        }
         else if (actor.type() == TYPE_BOULDER)
         {
             // Do nothing for now
         }
-        else if (actor.type() == TYPE_LIGHTNING_BOLT)
-        {
-            handleBullet(actor, def, i, {.sound = SOUND_HIT2, .sfxID = SFX_EXPLOSION7, .sfxTimeOut = SFX_EXPLOSION7_TIMEOUT}, deletedMonsters);
-        }
         else if (actor.type() == TYPE_BARREL)
         {
             handleBarrel(actor, def, i, deletedMonsters);
         }
         else
         {
-            LOGW("unhandled monster type: %.2x at index %lu", actor.type(), i);
+            LOGW("unhandled monster type: %.2x at index %d", actor.type(), i);
         }
     }
+    manageProjectiles(CProjectiles::LAST, speeds, deletedMonsters);
+    m_scheduler.end();
+    m_projectiles.compact();
 
     // moved here to avoid reallocation while using a reference
     for (auto &monster : newMonsters)
@@ -400,13 +472,16 @@ void CGame::manageMonsters(const int ticks)
         m_monsters.emplace_back(std::move(monster));
         int index = m_monsters.size() - 1;
         updateMonsterGrid(m_monsters[index], index); // Safe
+        scheduleMonster(index);
     }
 
     // remove deleted monsters
     for (auto const &i : deletedMonsters)
     {
         m_monsters.erase(m_monsters.begin() + i);
+        m_projectiles.eraseMonster(i);
     }
+    m_scheduler.erase(deletedMonsters);
 
     // rebuild monster grid if needed
     if (!deletedMonsters.empty())
@@ -478,7 +553,7 @@ void CGame::handleDrone(CActor &actor, const TileDef &def)
     actor.setAim(aim);
 }
 
-void CGame::handleVamPlant(CActor &actor, const TileDef &def, std::vector<CActor> &newMonsters)
+void CGame::handleVamPlant(CActor &actor, const TileDef &def, monsterList_t &newMonsters)
 {
     static constexpr JoyAim g_dirs[] = {AIM_UP, AIM_DOWN, AIM_LEFT, AIM_RIGHT};
 
@@ -506,6 +581,7 @@ void CGame::handleVamPlant(CActor &actor, const TileDef &def, std::vector<CActor
             CActor &m = m_monsters[j];
             m.setType(TYPE_VAMPLANT);
             m_map.set(p.x, p.y, TILES_VAMPLANT);
+            scheduleMonster(j);
             break;
         }
     }
@@ -578,99 +654,110 @@ void CGame::handleIceCube(CActor &actor)
     shadowActorMove(actor, aim);
 }
 
-void CGame::blastRadius(const Pos &pos, const size_t radius, const int damage, std::set<int, std::greater<int>> &deletedMonsters)
+void CGame::blastRadius(const Pos &pos, const size_t radius, const int damage, deletedList_t &deletedMonsters)
 {
-    // compute blast radius
-    std::vector<int> index;
-    index.reserve(radius * 2 + 1);
-    for (size_t i = 0; i < radius; ++i)
-        index.emplace_back(-radius + i);
-    index.emplace_back(0);
-    for (size_t i = 0; i < radius; ++i)
-        index.emplace_back(i + 1);
-
-    struct blastPos_t
-    {
-        Pos pos;
-        int damage;
-        const Pos &toPos() const { return pos; }
-    };
-    std::vector<blastPos_t> blastPositions;
+    const int r = static_cast<int>(radius);
 
     // apply blast radius
-    for (size_t i = 0; i < index.size(); ++i)
+    for (int ty = -r; ty <= r; ++ty)
     {
-        const auto &ty = index[i];
-        for (size_t j = 0; j < index.size(); ++j)
+        for (int tx = -r; tx <= r; ++tx)
         {
-            const auto &tx = index[j];
             const int16_t x = pos.x + tx;
             const int16_t y = pos.y + ty;
-            if (m_map.isValid(x, y))
+            if (!m_map.isValid(x, y))
+                continue;
+
+            // check player for splash danage
+            if (m_player.pos() == Pos{x, y})
             {
-                int distance = (std::abs(tx) + std::abs(ty)) / 2;
-                int radiusDamage = distance ? damage / std::abs(distance) : damage;
-                blastPositions.emplace_back(blastPos_t{Pos{x, y}, std::abs(radiusDamage)});
+                addHealth(blastDamage(tx, ty, damage));
+                continue;
+            }
 
-                // check player for splash danage
-                if (m_player.pos() == Pos{x, y})
+            if (tx == 0 && ty == 0)
+                continue;
+
+            // check for intersection with mob monster and other actors
+            const int id = findMonsterAt(x, y);
+            if (id != INVALID && !deletedMonsters.count(id))
+            {
+                CActor &actor = m_monsters[id];
+                if (actor.type() == TYPE_BARREL)
                 {
-                    addHealth(radiusDamage);
-                    continue;
+                    // light other barrels
+                    fuseBarrel({x, y});
                 }
-
-                if (tx == 0 && ty == 0)
-                    continue;
-
-                // check for intersection with mob monster and other actors
-                const int id = findMonsterAt(x, y);
-                if (id != INVALID && !deletedMonsters.count(id))
+                else if (actor.type() == TYPE_MONSTER || actor.type() == TYPE_DRONE || actor.type() == TYPE_VAMPLANT)
+                {
+                    // kill mob monsters
+                    deletedMonsters.emplace(id);
+                    m_sfx.emplace_back(sfx_t{pos.x, pos.y, SFX_EXPLOSION0, SFX_EXPLOSION0_TIMEOUT});
+                }
+                else if (actor.type() == TYPE_ICECUBE)
                 {
-                    CActor &actor = m_monsters[id];
-                    if (actor.type() == TYPE_BARREL)
-                    {
-                        // light other barrels
-                        fuseBarrel({x, y});
-                    }
-                    else if (actor.type() == TYPE_MONSTER || actor.type() == TYPE_DRONE || actor.type() == TYPE_VAMPLANT)
-                    {
-                        // kill mob monsters
-                        deletedMonsters.emplace(id);
-                        m_sfx.emplace_back(sfx_t{pos.x, pos.y, SFX_EXPLOSION0, SFX_EXPLOSION0_TIMEOUT});
-                    }
-                    else if (actor.type() == TYPE_ICECUBE)
-                    {
-                        // melt icecubes
-                        deletedMonsters.emplace(id);
-                        m_sfx.emplace_back(sfx_t{pos.x, pos.y, SFX_EXPLOSION6, SFX_EXPLOSION6_TIMEOUT});
-                    }
+                    // melt icecubes
+                    deletedMonsters.emplace(id);
+                    m_sfx.emplace_back(sfx_t{pos.x, pos.y, SFX_EXPLOSION6, SFX_EXPLOSION6_TIMEOUT});
                 }
             }
         }
     }
 
+    blastBosses(pos, r, damage);
+}
+
+/**
+ * @brief Apply the damage from an explosion to the bosses
+ *
+ * The blast is rasterized into a damage grid over its bounding box and
+ * intersected with the boss hitbox rectangles.
+ *
+ * @param pos center of the blast
+ * @param radius
+ * @param damage
+ */
+void CGame::blastBosses(const Pos &pos, const int radius, const int damage)
+{
+    // rasterize the blast, clipped to the map
+    const int x1 = std::max(pos.x - radius, 0);
+    const int y1 = std::max(pos.y - radius, 0);
+    const int x2 = std::min(pos.x + radius, m_map.len() - 1);
+    const int y2 = std::min(pos.y + radius, m_map.hei() - 1);
+    if (x1 > x2 || y1 > y2)
+        return;
+    const int width = x2 - x1 + 1;
+    m_blastGrid.resize(width * (y2 - y1 + 1));
+    for (int y = y1; y <= y2; ++y)
+    {
+        for (int x = x1; x <= x2; ++x)
+            m_blastGrid[(x - x1) + (y - y1) * width] = std::abs(blastDamage(x - pos.x, y - pos.y, damage));
+    }
+
     // test boss hitbox
     for (auto &boss : m_bosses)
     {
         int bossDamage = 0;
-        for (const auto &bp : blastPositions)
-        {
-            boss.testHitbox1(m_map, [&bp](const Pos &p, const auto type) { //
-                // check if damage can occur
-                return type != BossData::HitBoxType::SPECIAL1 && p == bp.toPos();
-            },
-                             [boss, &bp, &bossDamage](const HitResult &)
-                             {
-                                 // compute maximum damage
-                                 bossDamage = std::max(bp.damage, bossDamage); //
-                             });
-        }
+        boss.visitHitboxRects([&](const rect_t &rect, const BossData::HitBoxType type)
+                              {
+                                  // check if damage can occur
+                                  if (type == BossData::HitBoxType::SPECIAL1)
+                                      return;
+                                  const int left = std::max(rect.x, x1);
+                                  const int right = std::min(rect.x + rect.width - 1, x2);
+                                  const int top = std::max(rect.y, y1);
+                                  const int bottom = std::min(rect.y + rect.height - 1, y2);
+                                  for (int y = top; y <= bottom; ++y)
+                                  {
+                                      for (int x = left; x <= right; ++x)
+                                          bossDamage = std::max(m_blastGrid[(x - x1) + (y - y1) * width], bossDamage); // compute maximum damage
+                                  } });
         if (bossDamage)
             boss.subtainDamage(bossDamage);
     }
 }
 
-void CGame::handleBarrel(CActor &actor, const TileDef &def, const int i, std::set<int, std::greater<int>> &deletedMonsters)
+void CGame::handleBarrel(CActor &actor, const TileDef &def, const int i, deletedList_t &deletedMonsters)
 {
     if (actor.decTTL() == 0)
     {
@@ -690,7 +777,50 @@ void CGame::handleBarrel(CActor &actor, const TileDef &def, const int i, std::se
     }
 }
 
-void CGame::handleBullet(CActor &actor, const TileDef &def, const int i, const bulletData_t &bullet, std::set<int, std::greater<int>> &deletedMonsters)
+/**
+ * @brief Move the projectiles that come before a given monster
+ *
+ * Impacts are queued while the projectiles move and resolved together
+ * once they all had their turn.
+ *
+ * @param limit monster index or CProjectiles::LAST
+ * @param speeds speed divisors due on this tick
+ * @param deletedMonsters
+ */
+void CGame::manageProjectiles(const int limit, const bool speeds[], deletedList_t &deletedMonsters)
+{
+    for (int i = m_projectiles.next(limit); i != CProjectiles::NONE; i = m_projectiles.next(limit))
+    {
+        CActor &actor = m_projectiles[i];
+        const Pos pos = actor.pos();
+        const uint8_t attr = m_map.getAttr(pos.x, pos.y);
+        if (RANGE(attr, ATTR_IDLE_MIN, ATTR_IDLE_MAX))
+        {
+            const uint8_t distance = (attr & 0xf) + 1;
+            if (actor.distance(m_player) > distance)
+                continue;
+            m_map.setAttr(pos.x, pos.y, 0);
+        }
+
+        const TileDef &def = getTileDef(m_map.at(pos.x, pos.y));
+        if (speeds[def.speed])
+            handleBullet(actor, def, i);
+    }
+    resolveImpacts(deletedMonsters);
+}
+
+/**
+ * @brief Advance a projectile by one cell
+ *
+ * The projectile sweeps into the next cell of its path if it is open
+ * (background or stop tile); otherwise it is spent and what lies in that
+ * cell is recorded as an impact.
+ *
+ * @param actor projectile
+ * @param def tile definition of the projectile
+ * @param i projectile index
+ */
+void CGame::handleBullet(CActor &actor, const TileDef &def, const int i)
 {
     bool isMoving;
     JoyAim aim = actor.getAim();
@@ -701,56 +831,91 @@ void CGame::handleBullet(CActor &actor, const TileDef &def, const int i, const b
             return;
         isMoving = result != CPath::Result::Blocked && actor.getTTL() != 0;
         aim = actor.getAim();
-        // if (actor.canMove(aim) && actor.getTTL() != 0)
-        //     return;
-        // LOGI("sprite: %p not moving result:[%d]; aim=[%d] isPlayerThere=[%d] [%p]", &actor, result, actor.getAim(), actor.isPlayerThere(aim), actor.path());
     }
     else
     {
         isMoving = actor.canMove(aim);
         if (isMoving)
-            shadowActorMove(actor, aim);
+            actor.move(aim);
     }
 
     if (!isMoving || !actor.getTTL() == 0)
     {
-        playSound(bullet.sound);
-        // remove actor/ set to be deleted
+        // the cell is freed right away; the side effects are batched
         m_map.set(actor.x(), actor.y(), actor.getPU());
-        deletedMonsters.insert(i);
+        m_projectiles.kill(i);
+        CProjectiles::impact_t impact{
+            .pos = actor.pos(),
+            .target = translate(actor.pos(), aim),
+            .type = actor.type(),
+            .hit = CProjectiles::HIT_NONE,
+            .health = static_cast<int16_t>(def.health),
+            .monster = INVALID,
+        };
+        if (impact.target == impact.pos)
+        {
+            // coordonate outside map bounds
+            m_projectiles.addImpact(impact);
+            return;
+        }
+        const TileDef &defX = getTileDef(actor.tileAt(aim));
+        if (defX.type == TYPE_ICECUBE)
+        {
+            impact.hit = CProjectiles::HIT_ICECUBE;
+            impact.monster = findMonsterAt(impact.target.x, impact.target.y);
+            if (impact.monster != INVALID)
+                m_map.set(impact.target.x, impact.target.y, TILES_BLANK);
+        }
+        else if (actor.isPlayerThere(aim) && !isGodMode())
+        {
+            impact.hit = CProjectiles::HIT_PLAYER;
+        }
+        else if (defX.type == TYPE_BARREL)
+        {
+            impact.hit = CProjectiles::HIT_BARREL;
+        }
+        m_projectiles.addImpact(impact);
+    }
+}
+
+/**
+ * @brief Apply the queued projectile impacts in the order they occurred
+ *
+ * @param deletedMonsters
+ */
+void CGame::resolveImpacts(deletedList_t &deletedMonsters)
+{
+    const CProjectiles::impact_t *impacts = m_projectiles.impacts();
+    for (size_t j = 0; j < m_projectiles.impactCount(); ++j)
+    {
+        const CProjectiles::impact_t &impact = impacts[j];
+        const bulletData_t &bullet = bulletData(impact.type);
+        playSound(bullet.sound);
         m_sfx.emplace_back(sfx_t{
-            .x = actor.x(),
-            .y = actor.y(),
+            .x = impact.pos.x,
+            .y = impact.pos.y,
             .sfxID = bullet.sfxID,
             .timeout = bullet.sfxTimeOut,
         });
-        if (CGame::translate(Pos{actor.x(), actor.y()}, aim) == actor.pos())
-            // coordonate outside map bounds
-            return;
-        const uint8_t tileID = actor.tileAt(aim);
-        const TileDef &defX = getTileDef(tileID);
-        if (defX.type == TYPE_ICECUBE)
+        if (impact.hit == CProjectiles::HIT_ICECUBE)
         {
             playSound(SOUND_SPLASH01);
-            const Pos &pos = translate(actor.pos(), aim);
-            int i = findMonsterAt(pos.x, pos.y);
-            if (i != INVALID)
+            if (impact.monster != INVALID)
             {
-                deletedMonsters.insert(i);
-                m_sfx.emplace_back(sfx_t{.x = pos.x, .y = pos.y, .sfxID = SFX_EXPLOSION6, .timeout = SFX_EXPLOSION6_TIMEOUT});
-                m_map.set(pos.x, pos.y, TILES_BLANK);
+                deletedMonsters.insert(impact.monster);
+                m_sfx.emplace_back(sfx_t{.x = impact.target.x, .y = impact.target.y, .sfxID = SFX_EXPLOSION6, .timeout = SFX_EXPLOSION6_TIMEOUT});
             }
         }
-        else if (actor.isPlayerThere(aim) && !isGodMode())
+        else if (impact.hit == CProjectiles::HIT_PLAYER)
         {
-            addHealth(def.health);
+            addHealth(impact.health);
         }
-        else if (defX.type == TYPE_BARREL)
+        else if (impact.hit == CProjectiles::HIT_BARREL)
         {
-            const Pos &pos = translate(actor.pos(), aim);
-            fuseBarrel(pos);
+            fuseBarrel(impact.target);
         }
     }
+    m_projectiles.clearImpacts();
 }
 
 bool CGame::isPushable(const uint8_t typeID)
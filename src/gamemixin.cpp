@@ -15,6 +15,8 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <memory>
 #include "gamemixin.h"
@@ -22,12 +24,14 @@
 #include "shared/FrameSet.h"
 #include "shared/Frame.h"
 #include "shared/FileWrap.h"
+#include "shared/FileMem.h"
 #include "map.h"
 #include "game.h"
 #include "maparch.h"
 #include "animator.h"
 #include "chars.h"
 #include "recorder.h"
+#include "rewind.h"
 #include "events.h"
 #include "states.h"
 #include "statedata.h"
@@ -71,8 +75,10 @@ CGameMixin::CGameMixin()
     clearKeyStates();
     clearButtonStates();
     m_recorder = std::make_unique<CRecorder>();
+    m_rewind = std::make_unique<CRewind>();
     m_eventCountdown = 0;
     m_currentEvent = EVENT_NONE;
+    m_timer = TICK_RATE;
     initUI();
     _WIDTH = DEFAULT_WIDTH;
     _HEIGHT = DEFAULT_HEIGHT;
@@ -660,8 +666,7 @@ void CGameMixin::gatherSprites(std::vector<sprite_t> &sprites, const cameraConte
     const int &ox = context.ox;
     const int &my = context.my;
     const int &oy = context.oy;
-    const std::vector<CActor> &monsters = game.getMonsters();
-    for (const auto &monster : monsters)
+    auto addSprite = [&](const CActor &monster)
     {
         const uint8_t &tileID = map->at(monster.x(), monster.y());
         if (monster.isWithin(mx, my, mx + cols + ox, my + rows + oy) &&
@@ -676,7 +681,15 @@ void CGameMixin::gatherSprites(std::vector<sprite_t> &sprites, const cameraConte
                          .aim = monster.getAim(),
                          .attr = attr});
         }
-    }
+    };
+
+    const std::vector<CActor> &monsters = game.getMonsters();
+    for (const auto &monster : monsters)
+        addSprite(monster);
+
+    const CProjectiles &projectiles = game.projectiles();
+    for (size_t i = 0; i < projectiles.size(); ++i)
+        addSprite(projectiles[i]);
 
     const std::vector<sfx_t> &sfxAll = m_game->getSfx();
     for (const auto &sfx : sfxAll)
@@ -1055,6 +1068,15 @@ void CGameMixin::drawLevelIntro(CFrame &bitmap)
 void CGameMixin::mainLoop()
 {
     handleFunctionKeys();
+    handlePlaybackKeys();
+    if (handleRewind())
+        return;
+    if (m_recorder->isKeyframe())
+    {
+        std::vector<uint8_t> snapshot;
+        if (saveKeyframe(snapshot))
+            m_recorder->keyframe(snapshot);
+    }
     ++m_ticks;
     CGame &game = *m_game;
     if (game.mode() != CGame::MODE_CLICKSTART &&
@@ -1314,7 +1336,11 @@ void CGameMixin::manageGamePlay()
 
     game.manageMonsters(m_ticks);
     game.manageBosses(m_ticks);
-    const uint16_t exitKey = m_game->getMap().states().getU(POS_EXIT);
+    if (m_recorder->isCheckpoint())
+    {
+        m_recorder->checkpoint(game.stateHash());
+    }
+    const uint16_t exitKey = m_game->getMap().statesConst().getU(POS_EXIT);
     if (game.isClosure())
     {
         stopRecorder();
@@ -1360,6 +1386,7 @@ void CGameMixin::manageGamePlay()
                     initLevelSummary();
                     m_game->setMode(CGame::MODE_LEVEL_SUMMARY);
                     startCountdown(1 * COUNTDOWN_INTRO);
+                    prefetchLevel(m_game->nextLevelIndex());
                 }
                 else
                 {
@@ -1376,19 +1403,42 @@ void CGameMixin::manageGamePlay()
 
 void CGameMixin::nextLevel()
 {
+    const auto start = std::chrono::steady_clock::now();
     stopRecorder();
     m_healthRef = 0;
     m_game->nextLevel();
     sanityTest();
     beginLevelIntro(CGame::MODE_LEVEL_INTRO);
     openMusicForLevel(m_game->level());
+    if (!m_quiet)
+        LOGI("level transition: %.2f ms",
+             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 }
 
 void CGameMixin::restartLevel()
 {
+    const auto start = std::chrono::steady_clock::now();
     m_game->restartLevel();
     beginLevelIntro(CGame::MODE_RESTART);
     changeMoodMusic(CGame::MODE_RESTART);
+    if (!m_quiet)
+        LOGI("level restart: %.2f ms",
+             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+/**
+ * @brief Get a level ready while a screen is shown ahead of it
+ *
+ * The map is prepared by a worker thread; the music of the level is
+ * loaded if it differs from the current one.
+ *
+ * @param level
+ */
+void CGameMixin::prefetchLevel(const int level)
+{
+    m_game->prefetchLevel(level);
+    if (level != m_game->level())
+        preloadMusicForLevel(level);
 }
 
 void CGameMixin::restartGame()
@@ -1944,6 +1994,274 @@ void CGameMixin::playbackGame()
     m_recorder->start(&m_recorderFile, false);
 }
 
+/**
+ * @brief Move the playback to a given tick of the recording
+ *
+ * Restores the closest keyframe at or before the tick, then plays the
+ * ticks in between without sound.
+ *
+ * @param tick
+ * @return true
+ * @return false not playing back, or the recording has no usable keyframe
+ */
+bool CGameMixin::seekPlayback(const uint32_t tick)
+{
+    if (!m_recorder->isReading())
+        return false;
+    // going forward, a keyframe is only worth loading if it is ahead
+    uint32_t keyframe = 0;
+    const bool hasKeyframe = m_recorder->findKeyframe(tick, keyframe);
+    if (tick < m_recorder->tick() ||
+        (hasKeyframe && keyframe > m_recorder->tick()))
+    {
+        std::vector<uint8_t> snapshot;
+        if (!m_recorder->seek(tick, snapshot))
+            return false;
+        if (!loadKeyframe(snapshot))
+        {
+            LOGE("invalid keyframe");
+            stopRecorder();
+            return false;
+        }
+    }
+    const bool quiet = m_quiet;
+    setQuiet(true);
+    while (m_recorder->isReading() &&
+           m_recorder->tick() < tick &&
+           m_game->mode() == CGame::MODE_PLAY)
+    {
+        mainLoop();
+    }
+    setQuiet(quiet);
+    return m_recorder->tick() == tick;
+}
+
+/**
+ * @brief Set how many ticks are played per frame during playback
+ *
+ * @param speed 1 for real time, up to MAX_REPLAY_SPEED
+ */
+void CGameMixin::setReplaySpeed(const int speed)
+{
+    m_replaySpeed = std::clamp(speed, 1, static_cast<int>(MAX_REPLAY_SPEED));
+}
+
+/**
+ * @brief Number of ticks to run before the next frame is painted
+ *
+ * @return int
+ */
+int CGameMixin::ticksPerFrame() const
+{
+    return m_recorder->isReading() && m_game->mode() == CGame::MODE_PLAY
+               ? m_replaySpeed
+               : 1;
+}
+
+/**
+ * @brief Playback controls
+ *
+ * 1 to 7 set the speed from real time to 64 ticks per frame, BackSpace
+ * and Period skip 10 seconds backward and forward.
+ */
+void CGameMixin::handlePlaybackKeys()
+{
+    if (!m_recorder->isReading() || m_game->mode() != CGame::MODE_PLAY)
+        return;
+    for (int i = 1; i <= 7; ++i)
+    {
+        if (m_keyStates[Key_0 + i])
+            setReplaySpeed(1 << (i - 1));
+    }
+    for (const int k : {Key_BackSpace, Key_Period})
+    {
+        if (!m_keyStates[k])
+        {
+            m_keyRepeters[k] = 0;
+            continue;
+        }
+        else if (m_keyRepeters[k])
+        {
+            continue;
+        }
+        m_keyRepeters[k] = KEY_NO_REPETE;
+        const uint32_t tick = m_recorder->tick();
+        if (k == Key_BackSpace)
+            seekPlayback(tick > REPLAY_SKIP ? tick - REPLAY_SKIP : 0);
+        else
+            seekPlayback(tick + REPLAY_SKIP);
+    }
+}
+
+/**
+ * @brief Keep the last few seconds of gameplay in memory
+ *
+ * @param seconds length of the rewind, 0 to disable it
+ * @param megabytes memory cap, 0 for REWIND_MEMORY
+ */
+void CGameMixin::enableRewind(const int seconds, const int megabytes)
+{
+    const size_t mb = megabytes > 0 ? megabytes : static_cast<int>(REWIND_MEMORY);
+    m_rewind->setLimits(std::max(seconds, 0) * TICK_RATE, mb << 20);
+}
+
+/**
+ * @brief Snapshot the current tick, or step back one while rewind is held
+ *
+ * Only live gameplay is rewound: recordings have their own seek controls.
+ *
+ * @return true the tick was rewound and must not be played
+ * @return false
+ */
+bool CGameMixin::handleRewind()
+{
+    if (!m_rewind->isEnabled() ||
+        m_game->mode() != CGame::MODE_PLAY ||
+        !m_recorder->isStopped() ||
+        m_paused || m_gameMenuActive || m_prompt != PROMPT_NONE)
+        return false;
+    if (!m_keyStates[Key_BackSpace] && !m_buttonState[BUTTON_BACK])
+    {
+        if (!captureRewind())
+        {
+            LOGE("cannot capture rewind state");
+        }
+        return false;
+    }
+    CRewind::frame_t frame;
+    if (!m_rewind->pop(frame))
+        return false;
+    if (!restoreRewind(frame))
+    {
+        LOGE("cannot restore rewind state");
+        m_rewind->clear();
+    }
+    return true;
+}
+
+/**
+ * @brief Push the state of the current tick on the rewind ring
+ *
+ * The time and memory spent are logged every REWIND_REPORT ticks.
+ *
+ * @return true
+ * @return false
+ */
+bool CGameMixin::captureRewind()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const CMap &map = CGame::getMap();
+    const CMap::snapshot_t *last = m_rewind->lastMap();
+    if (last && !map.canRestore(*last))
+    {
+        // new level: the older snapshots cannot be restored anymore
+        m_rewind->clear();
+        last = nullptr;
+    }
+    CRewind::frame_t frame;
+    frame.bytes = map.snapshot(frame.map, last);
+    CFileMem tfile;
+    tfile.open("", "wb");
+    auto writefile = [&tfile](auto ptr, auto size)
+    {
+        return tfile.write(ptr, size) == IFILE_OK;
+    };
+    if (!m_game->writeState(tfile))
+        return false;
+    _W(&m_ticks, sizeof(m_ticks));
+    _W(&m_playerFrameOffset, sizeof(m_playerFrameOffset));
+    _W(&m_healthRef, sizeof(m_healthRef));
+    _W(&m_countdown, sizeof(m_countdown));
+    _W(&m_currentEvent, sizeof(m_currentEvent));
+    _W(&m_eventCountdown, sizeof(m_eventCountdown));
+    _W(&m_timer, sizeof(m_timer));
+    frame.state = tfile.buffer();
+    frame.bytes += frame.state.size();
+    const auto usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    m_rewind->push(std::move(frame), static_cast<uint32_t>(usecs.count()));
+    if (!m_quiet && m_ticks % REWIND_REPORT == 0)
+    {
+        const CRewind::cost_t &cost = m_rewind->lastCost();
+        const CRewind::cost_t &peak = m_rewind->peakCost();
+        LOGI("rewind: %zu ticks, %zu KB; snapshot %zu bytes in %u us (peak %zu bytes, %u us)",
+             m_rewind->size(), m_rewind->bytes() >> 10,
+             cost.bytes, cost.usecs, peak.bytes, peak.usecs);
+    }
+    return true;
+}
+
+/**
+ * @brief Put the game back in the state of a rewind snapshot
+ *
+ * @param frame
+ * @return true
+ * @return false
+ */
+bool CGameMixin::restoreRewind(const CRewind::frame_t &frame)
+{
+    CFileMem sfile;
+    sfile.replace(frame.state.data(), frame.state.size());
+    auto readfile = [&sfile](auto ptr, auto size)
+    {
+        return sfile.read(ptr, size) == IFILE_OK;
+    };
+    if (!CGame::getMap().restore(frame.map) || !m_game->readState(sfile))
+        return false;
+    _R(&m_ticks, sizeof(m_ticks));
+    _R(&m_playerFrameOffset, sizeof(m_playerFrameOffset));
+    _R(&m_healthRef, sizeof(m_healthRef));
+    _R(&m_countdown, sizeof(m_countdown));
+    _R(&m_currentEvent, sizeof(m_currentEvent));
+    _R(&m_eventCountdown, sizeof(m_eventCountdown));
+    _R(&m_timer, sizeof(m_timer));
+    return true;
+}
+
+/**
+ * @brief Save the game for a recording keyframe
+ *
+ * Unlike a saved game, the event timers are kept so that playback
+ * resumes exactly where the recording was.
+ *
+ * @param snapshot
+ * @return true
+ * @return false
+ */
+bool CGameMixin::saveKeyframe(std::vector<uint8_t> &snapshot)
+{
+    CFileMem tfile;
+    tfile.open("", "wb");
+    auto writefile = [&tfile](auto ptr, auto size)
+    {
+        return tfile.write(ptr, size) == IFILE_OK;
+    };
+    if (!write(tfile, "keyframe"))
+        return false;
+    _W(&m_currentEvent, sizeof(m_currentEvent));
+    _W(&m_eventCountdown, sizeof(m_eventCountdown));
+    _W(&m_timer, sizeof(m_timer));
+    snapshot = tfile.buffer();
+    return true;
+}
+
+bool CGameMixin::loadKeyframe(const std::vector<uint8_t> &snapshot)
+{
+    CFileMem sfile;
+    sfile.replace(snapshot.data(), snapshot.size());
+    auto readfile = [&sfile](auto ptr, auto size)
+    {
+        return sfile.read(ptr, size) == IFILE_OK;
+    };
+    std::string name;
+    if (!read(sfile, name))
+        return false;
+    _R(&m_currentEvent, sizeof(m_currentEvent));
+    _R(&m_eventCountdown, sizeof(m_eventCountdown));
+    _R(&m_timer, sizeof(m_timer));
+    return true;
+}
+
 void CGameMixin::plotLine(CFrame &bitmap, int x0, int y0, const int x1, const int y1, const Color color)
 {
     auto dx = abs(x1 - x0);
@@ -2073,7 +2391,7 @@ CGameMixin::message_t CGameMixin::getEventText(const int baseY)
     }
     else if (RANGE(m_currentEvent, MSG0, MSGF))
     {
-        const std::string tmp = m_game->getMap().states().getS(m_currentEvent);
+        const std::string tmp = m_game->getMap().statesConst().getS(m_currentEvent);
         const auto list = split(tmp, '\n');
         const std::string &line1 = list[0];
         const std::string &line2 = list.size() > 1 ? list[1] : "";
@@ -2467,6 +2785,11 @@ void CGameMixin::drawGameStatus(CFrame &bitmap, const visualCues_t &visualcues)
         {
             drawFont(bitmap, bx * FONT_SIZE, Y_STATUS, "REC!", WHITE, RED);
         }
+        else if (m_recorder->isReading() && m_replaySpeed > 1)
+        {
+            snprintf(tmp, sizeof(tmp), "X%-3d", m_replaySpeed);
+            drawFont(bitmap, bx * FONT_SIZE, Y_STATUS, tmp, WHITE, DARKGREEN);
+        }
         else if (m_recorder->isReading())
         {
             drawFont(bitmap, bx * FONT_SIZE, Y_STATUS, "PLAY", WHITE, DARKGREEN);
@@ -2487,6 +2810,8 @@ void CGameMixin::beginLevelIntro(CGame::GameMode mode)
     m_game->loadLevel(mode);
     centerCamera();
     clearVisualStates();
+    // a fresh copy for when the player dies
+    prefetchLevel(m_game->level());
 }
 
 /**
@@ -2550,5 +2875,5 @@ int CGameMixin::whichButton(CGameUI &ui, int x, int y)
 void CGameMixin::setQuiet(bool state)
 {
     m_quiet = state;
-    CGame::getGame()->setQuiet(state);
+    m_game->setQuiet(state);
 }
\ No newline at end of file
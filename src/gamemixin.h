@@ -32,6 +32,7 @@
 #include "rect.h"
 #include "color.h"
 #include "shared/FileWrap.h"
+#include "rewind.h"
 
 class CActor;
 class CFrameSet;
@@ -50,6 +51,10 @@ public:
     inline bool isWithin(int val, int min, int max);
     void enableHiScore();
     void setSkill(uint8_t skill);
+    bool seekPlayback(const uint32_t tick);
+    void setReplaySpeed(const int speed);
+    void enableRewind(const int seconds, const int megabytes);
+    int ticksPerFrame() const;
     static int tickRate();
     void setWidth(int w);
     void setHeight(int h);
@@ -104,6 +109,9 @@ protected:
         INDEX_PLAYER_DEAD = 4,
         HEALTHBAR_CLASSIC = 0,
         HEALTHBAR_HEARTHS = 1,
+        REPLAY_SKIP = 10 * TICK_RATE,
+        REWIND_MEMORY = 16,             // default cap in MB
+        REWIND_REPORT = 10 * TICK_RATE, // ticks between cost reports
     };
 
     enum : int32_t
@@ -258,6 +266,7 @@ protected:
     CGame *m_game = nullptr;
     CMapArch *m_maparch = nullptr;
     std::unique_ptr<CRecorder> m_recorder;
+    std::unique_ptr<CRewind> m_rewind;
     std::vector<std::string> m_helptext;
     int m_playerFrameOffset = 0;
     int m_healthRef = 0;
@@ -289,6 +298,7 @@ protected:
     CGameUI m_ui;
     CFileWrap m_recorderFile;
     bool m_quiet = false;
+    int m_replaySpeed = 1;
 
     void drawPreScreen(CFrame &bitmap);
     void drawScreen(CFrame &bitmap);
@@ -315,6 +325,7 @@ protected:
     CFrame *calcSpecialFrame(const sprite_t &sprite);
     void nextLevel();
     void restartLevel();
+    void prefetchLevel(const int level);
     void restartGame();
     void startCountdown(int f = 1);
     int rankUserScore();
@@ -372,6 +383,7 @@ protected:
     virtual void startMusic() = 0;
     virtual void setZoom(bool zoom);
     virtual void openMusicForLevel(int i) = 0;
+    virtual void preloadMusicForLevel(int i) = 0;
     virtual void setupTitleScreen() = 0;
     virtual void takeScreenshot() = 0;
     virtual void toggleFullscreen() = 0;
@@ -389,4 +401,10 @@ private:
     void stopRecorder();
     void recordGame();
     void playbackGame();
+    void handlePlaybackKeys();
+    bool handleRewind();
+    bool captureRewind();
+    bool restoreRewind(const CRewind::frame_t &frame);
+    bool saveKeyframe(std::vector<uint8_t> &snapshot);
+    bool loadKeyframe(const std::vector<uint8_t> &snapshot);
 };
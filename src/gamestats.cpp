@@ -17,6 +17,7 @@
 */
 #include "gamestats.h"
 #include "shared/IFile.h"
+#include "zobrist.h"
 
 CGameStats::CGameStats()
 {
@@ -49,6 +50,19 @@ int CGameStats::at(const GameStat key) const
     return it != m_stats.end() ? it->second : 0;
 }
 
+/**
+ * @brief Zobrist hash of all the values
+ *
+ * @return uint64_t
+ */
+uint64_t CGameStats::hash() const
+{
+    uint64_t hash = 0;
+    for (const auto &[key, value] : m_stats)
+        hash ^= Zobrist::key(Zobrist::STAT, key, value);
+    return hash;
+}
+
 /**
  * @brief Set value associated with given key
  *
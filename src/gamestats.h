@@ -64,6 +64,7 @@ public:
 
     bool read(IFile &sfile);
     bool write(IFile &tfile) const;
+    uint64_t hash() const;
 
 private:
     template <typename WriteFunc>
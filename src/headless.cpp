@@ -0,0 +1,79 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "headless.h"
+#include "recorder.h"
+#include "logger.h"
+#include "shared/IFile.h"
+
+CHeadless::CHeadless(CMapArch *maparch) : m_own(std::make_unique<CGame>())
+{
+    m_game = m_own.get();
+    m_maparch = maparch;
+    m_game->setMapArch(maparch);
+    setQuiet(true);
+}
+
+CHeadless::~CHeadless()
+{
+}
+
+/**
+ * @brief Play a recording to its end as fast as possible
+ *
+ * The recording holds a saved game followed by the joystick stream; the
+ * replay ends when the stream runs out or when the recorder is stopped
+ * (level completed, player killed).
+ *
+ * @param file recording positioned at its start
+ * @param result final state of the game
+ * @return true
+ * @return false
+ */
+bool CHeadless::replay(IFile &file, replay_t &result)
+{
+    std::string name;
+    if (!read(file, name))
+    {
+        LOGE("invalid recording");
+        return false;
+    }
+    const CGame::Scope scope(*m_game);
+    m_game->setMode(CGame::MODE_PLAY);
+    if (!m_recorder->start(&file, false))
+    {
+        m_recorder->stop();
+        LOGE("cannot read joystick stream");
+        return false;
+    }
+    uint32_t ticks = 0;
+    while (!m_recorder->isStopped() && ticks < MAX_TICKS)
+    {
+        mainLoop();
+        ++ticks;
+    }
+    m_recorder->stop();
+    if (ticks == MAX_TICKS)
+        LOGW("replay cut short after %u ticks", ticks);
+
+    result.score = m_game->score();
+    result.level = m_game->level() + 1;
+    result.ticks = ticks;
+    result.hash = m_game->stateHash();
+    result.mismatch = m_recorder->firstMismatch();
+    return true;
+}
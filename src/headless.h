@@ -0,0 +1,82 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "gamemixin.h"
+
+class IFile;
+
+/**
+ * @brief Game loop without a window, sound or clock
+ *
+ * Runs CGameMixin::mainLoop() back to back on a game of its own, feeding it
+ * the joystick states of a recording. Everything the front-ends provide
+ * (assets, music, menus, screenshots) is stubbed out since none of it
+ * affects the game state.
+ */
+class CHeadless : public CGameMixin
+{
+public:
+    struct replay_t
+    {
+        int score;
+        int level;
+        uint32_t ticks;
+        uint64_t hash;
+        int32_t mismatch; // first tick whose state hash differed from the recording, or -1
+    };
+
+    CHeadless(CMapArch *maparch);
+    ~CHeadless() override;
+    bool replay(IFile &file, replay_t &result);
+
+    void save() override {};
+    void load() override {};
+
+protected:
+    enum : uint32_t
+    {
+        MAX_TICKS = 60 * 60 * TICK_RATE, // stop runaway replays after 1h of game time
+    };
+
+    void preloadAssets() override {};
+    void sanityTest() override {};
+    bool loadScores() override { return false; };
+    bool saveScores() override { return true; };
+    void stopMusic() override {};
+    void startMusic() override {};
+    void openMusicForLevel(int) override {};
+    void preloadMusicForLevel(int) override {};
+    void setupTitleScreen() override {};
+    void takeScreenshot() override {};
+    void toggleFullscreen() override {};
+    void manageTitleScreen() override {};
+    void toggleGameMenu() override {};
+    void manageGameMenu() override {};
+    void manageOptionScreen() override {};
+    void manageUserMenu() override {};
+    void manageLevelSummary() override {};
+    void initLevelSummary() override {};
+    void changeMoodMusic(CGame::GameMode) override {};
+    void manageSkillMenu() override {};
+
+private:
+    std::unique_ptr<CGame> m_own;
+};
@@ -32,6 +32,7 @@ public:
     virtual int16_t y() const = 0;
     virtual uint8_t type() const = 0;
     virtual bool canMove(const JoyAim aim) const = 0;
+    virtual bool canMoveFrom(const Pos &pos, const JoyAim aim) const = 0;
     virtual void move(const JoyAim aim) = 0;
     virtual int distance(const CActor &actor) const = 0;
     virtual void move(const int16_t x, const int16_t y) = 0;
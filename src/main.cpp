@@ -263,6 +263,7 @@ int main(int argc, char *args[])
     data.clear();
 
     g_runtime->setSkill(params.skill);
+    g_runtime->setReplaySpeed(params.replaySpeed);
     const int startLevel = (params.level > 0 ? params.level - 1 : 0) % maparch.size();
     g_runtime->init(&maparch, startLevel);
     g_runtime->setStartLevel(startLevel);
@@ -17,13 +17,18 @@
 */
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
 #include <algorithm>
+#include <atomic>
 #include <stdexcept>
 #include <functional>
 #include "map.h"
 #include "shared/IFile.h"
 #include "states.h"
 #include "logger.h"
+#include "passability.h"
+#include "zobrist.h"
+#include "filemacros.h"
 
 namespace MapPrivate
 {
@@ -37,6 +42,7 @@ namespace MapPrivate
     constexpr uint16_t VERSION = 0;
     constexpr uint16_t MAX_SIZE = 256;
     constexpr uint16_t MAX_TITLE = 255;
+    std::atomic<uint32_t> g_nextId{1};
 };
 
 using namespace MapPrivate;
@@ -47,17 +53,24 @@ typedef struct
     char ver;
 } extrahdr_t;
 
-CMap::CMap(uint16_t len, uint16_t hei, uint8_t t) : m_states(std::make_unique<CStates>())
+CMap::CMap(uint16_t len, uint16_t hei, uint8_t t) : m_id(g_nextId++),
+                                                     m_states(std::make_shared<CStates>())
 {
     resize(len, hei, t, true);
 };
 
-CMap::CMap(const CMap &map) : m_len(map.m_len),
+CMap::CMap(const CMap &map) : m_id(g_nextId++),
+                              m_len(map.m_len),
                               m_hei(map.m_hei),
                               m_map(map.m_map),
+                              m_pass(map.m_pass),
                               m_attrs(map.m_attrs),
                               m_title(map.m_title),
-                              m_states(std::make_unique<CStates>(*map.m_states)) {}
+                              m_states(map.m_states),
+                              m_passEpoch(map.m_passEpoch),
+                              m_blockEpochs(map.m_blockEpochs),
+                              m_pageStamps(map.m_pageStamps),
+                              m_hash(map.m_hash) {}
 
 CMap::~CMap()
 {
@@ -86,16 +99,280 @@ uint8_t CMap::at(const int x, const int y) const
 
 void CMap::set(const int x, const int y, const uint8_t t)
 {
-    get(x, y) = t;
+    uint8_t &tile = get(x, y);
+    if (tile == t)
+        return;
+    const uint16_t key = toKey(x, y);
+    m_hash ^= Zobrist::key(Zobrist::TILE, key, tile) ^ Zobrist::key(Zobrist::TILE, key, t);
+    tile = t;
+    uint8_t &pass = m_pass[x + y * m_len];
+    if (pass != Passability::tileMask(t))
+    {
+        pass = Passability::tileMask(t);
+        m_blockEpochs[blockOf(x, y)] = ++m_passEpoch;
+    }
+    m_journal[m_changes++ & (JOURNAL_SIZE - 1)] = key;
+    m_pageStamps[(x + y * m_len) >> PAGE_SHIFT] = m_changes;
+}
+
+/**
+ * @brief The whole map was rewritten
+ *
+ * Flags it in the journal, derives the pass masks again and moves every
+ * epoch block to a new epoch.
+ */
+void CMap::touchAll()
+{
+    m_pass.resize(m_map.size());
+    for (size_t i = 0; i < m_map.size(); ++i)
+        m_pass[i] = Passability::tileMask(m_map[i]);
+    rehash();
+    restamp();
+}
+
+/**
+ * @brief Move the journal, epoch blocks and pages past a wholesale rewrite
+ *
+ * Unlike touchAll(), the pass masks and hash are left as they are.
+ */
+void CMap::restamp()
+{
+    m_reset = ++m_changes;
+    const size_t blocks = ((m_len + (1 << BLOCK_SHIFT) - 1) >> BLOCK_SHIFT) *
+                          ((m_hei + (1 << BLOCK_SHIFT) - 1) >> BLOCK_SHIFT);
+    m_blockEpochs.assign(blocks, ++m_passEpoch);
+    m_pageStamps.assign((m_map.size() + PAGE_SIZE - 1) >> PAGE_SHIFT, m_changes);
+    ++m_attrEpoch;
+}
+
+/**
+ * @brief Compute the Zobrist hash from scratch
+ *
+ */
+void CMap::rehash()
+{
+    m_hash = 0;
+    for (int y = 0; y < m_hei; ++y)
+        for (int x = 0; x < m_len; ++x)
+            m_hash ^= Zobrist::key(Zobrist::TILE, toKey(x, y), m_map[x + y * m_len]);
+    for (const auto &[key, attr] : m_attrs)
+        m_hash ^= Zobrist::key(Zobrist::ATTR, key, attr);
+}
+
+/**
+ * @brief Check that no tile changed its pass mask in an area since a given epoch
+ *
+ * The area is the rectangle spanned by two tiles, clipped to the map. The
+ * test is done per epoch block so it may report changes next to the area.
+ *
+ * @param a corner tile
+ * @param b opposite corner tile
+ * @param epoch value of passEpoch() when the caller last looked at the area
+ * @return true
+ * @return false
+ */
+bool CMap::isUnchangedSince(const Pos &a, const Pos &b, const uint32_t epoch) const
+{
+    if (m_passEpoch == epoch)
+        return true;
+    if (m_len == 0 || m_hei == 0)
+        return false;
+    const int x1 = std::clamp(std::min<int>(a.x, b.x), 0, m_len - 1) >> BLOCK_SHIFT;
+    const int x2 = std::clamp(std::max<int>(a.x, b.x), 0, m_len - 1) >> BLOCK_SHIFT;
+    const int y1 = std::clamp(std::min<int>(a.y, b.y), 0, m_hei - 1) >> BLOCK_SHIFT;
+    const int y2 = std::clamp(std::max<int>(a.y, b.y), 0, m_hei - 1) >> BLOCK_SHIFT;
+    const int stride = (m_len + (1 << BLOCK_SHIFT) - 1) >> BLOCK_SHIFT;
+    for (int y = y1; y <= y2; ++y)
+        for (int x = x1; x <= x2; ++x)
+            if (m_blockEpochs[x + y * stride] > epoch)
+                return false;
+    return true;
+}
+
+/**
+ * @brief Check for a clear line between two tiles
+ *
+ * The tiles crossed by the Bresenham line between both ends must let the
+ * given movement classes through; the ends themselves are not checked.
+ * Results are kept in a small cache of recent rays, so asking the same
+ * question on every tick only walks the line again after a tile changed
+ * its pass mask near it.
+ *
+ * Not thread safe: only meant for the game thread.
+ *
+ * @param from
+ * @param to
+ * @param passClass Passability::Class bits of tiles that do not block the view
+ * @return true
+ * @return false
+ */
+bool CMap::isVisible(const Pos &from, const Pos &to, const uint8_t passClass) const
+{
+    if (!isValid(from.x, from.y) || !isValid(to.x, to.y) || passClass == Passability::NONE)
+        return false;
+    if (m_rays.empty())
+        m_rays.resize(RAY_CACHE_SIZE, ray_t{Pos{0, 0}, Pos{0, 0}, 0, Passability::NONE, false});
+    const uint32_t key = (toKey(from) * 31u + toKey(to)) * 7u + passClass;
+    ray_t &ray = m_rays[(key ^ (key >> 8)) & (RAY_CACHE_SIZE - 1)];
+    if (ray.passClass == passClass && ray.from == from && ray.to == to &&
+        isUnchangedSince(from, to, ray.epoch))
+    {
+        ray.epoch = m_passEpoch;
+        ++m_rayHits;
+        return ray.visible;
+    }
+    ray = ray_t{from, to, m_passEpoch, passClass, traceRay(from, to, passClass)};
+    return ray.visible;
+}
+
+bool CMap::traceRay(const Pos &from, const Pos &to, const uint8_t passClass) const
+{
+    if (from == to)
+        return true;
+    const int dx = std::abs(to.x - from.x);
+    const int dy = -std::abs(to.y - from.y);
+    const int sx = from.x < to.x ? 1 : -1;
+    const int sy = from.y < to.y ? 1 : -1;
+    int err = dx + dy;
+    int x = from.x;
+    int y = from.y;
+    while (true)
+    {
+        const int e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y += sy;
+        }
+        if (x == to.x && y == to.y)
+            return true;
+        if (!(m_pass[x + y * m_len] & passClass))
+            return false;
+    }
+}
+
+/**
+ * @brief Take a snapshot of the tiles and attributes
+ *
+ * Pages and attributes left untouched since the previous snapshot are
+ * shared with it instead of being copied.
+ *
+ * @param snap
+ * @param prev previous snapshot of this map or nullptr
+ * @return size_t bytes copied
+ */
+size_t CMap::snapshot(snapshot_t &snap, const snapshot_t *prev) const
+{
+    const bool shared = prev && canRestore(*prev);
+    snap.map = m_id;
+    snap.reset = m_reset;
+    snap.changes = m_changes;
+    snap.attrEpoch = m_attrEpoch;
+    snap.len = m_len;
+    snap.hei = m_hei;
+    size_t bytes = 0;
+    snap.pages.resize(m_pageStamps.size());
+    for (size_t i = 0; i < snap.pages.size(); ++i)
+    {
+        if (shared && m_pageStamps[i] <= prev->changes)
+        {
+            snap.pages[i] = prev->pages[i];
+            continue;
+        }
+        auto page = std::make_shared<page_t>();
+        const size_t start = i << PAGE_SHIFT;
+        std::copy_n(m_map.begin() + start, std::min<size_t>(PAGE_SIZE, m_map.size() - start), page->begin());
+        snap.pages[i] = std::move(page);
+        bytes += sizeof(page_t);
+    }
+    if (shared && prev->attrEpoch == m_attrEpoch)
+    {
+        snap.attrs = prev->attrs;
+    }
+    else
+    {
+        snap.attrs = std::make_shared<const AttrMap>(m_attrs);
+        bytes += m_attrs.size() * sizeof(AttrMap::value_type);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Check that a snapshot was taken from the map as it is laid out now
+ *
+ * Snapshots are invalidated when the map is replaced, resized or
+ * rewritten wholesale.
+ *
+ * @param snap
+ * @return true
+ * @return false
+ */
+bool CMap::canRestore(const snapshot_t &snap) const
+{
+    return snap.map == m_id && snap.reset == m_reset &&
+           snap.len == m_len && snap.hei == m_hei &&
+           snap.pages.size() == m_pageStamps.size();
+}
+
+/**
+ * @brief Bring the tiles and attributes back to a snapshot
+ *
+ * Only the cells that differ are written, through set() and setAttr(), so
+ * that the journal, pass masks and hash stay in step.
+ *
+ * @param snap
+ * @return true
+ * @return false snapshot of another map or layout
+ */
+bool CMap::restore(const snapshot_t &snap)
+{
+    if (!canRestore(snap))
+        return false;
+    for (size_t i = 0; i < snap.pages.size(); ++i)
+    {
+        const page_t &page = *snap.pages[i];
+        const size_t start = i << PAGE_SHIFT;
+        const size_t count = std::min<size_t>(PAGE_SIZE, m_map.size() - start);
+        if (std::equal(page.begin(), page.begin() + count, m_map.begin() + start))
+            continue;
+        for (size_t j = 0; j < count; ++j)
+        {
+            if (m_map[start + j] != page[j])
+                set((start + j) % m_len, (start + j) / m_len, page[j]);
+        }
+    }
+    if (*snap.attrs != m_attrs)
+    {
+        std::vector<uint16_t> cleared;
+        for (const auto &[key, attr] : m_attrs)
+        {
+            if (!snap.attrs->count(key))
+                cleared.push_back(key);
+        }
+        for (const uint16_t key : cleared)
+            setAttr(toPos(key).x, toPos(key).y, 0);
+        for (const auto &[key, attr] : *snap.attrs)
+            setAttr(toPos(key).x, toPos(key).y, attr);
+    }
+    return true;
 }
 
 void CMap::clear()
 {
-    m_states->clear();
+    if (m_states.use_count() > 1)
+        m_states = std::make_shared<CStates>();
+    else
+        m_states->clear();
     m_map.clear();
     m_len = 0;
     m_hei = 0;
     m_attrs.clear();
+    touchAll();
 }
 
 bool CMap::read(const char *fname)
@@ -139,10 +416,9 @@ bool CMap::read(IFile &file)
         file.seek(pos);
         return pos;
     };
-    auto states = &m_states;
-    auto readStates = [&file, states]() -> bool
+    auto readStates = [&file, this]() -> bool
     {
-        return (*states)->read(file);
+        return states().read(file);
     };
 
     return readImpl(readfile, tell, seek, readStates);
@@ -165,10 +441,9 @@ bool CMap::read(FILE *sfile)
         return fseek(sfile, pos, SEEK_SET) == 0;
     };
 
-    auto states = &m_states;
-    auto readStates = [sfile, states]() -> bool
+    auto readStates = [sfile, this]() -> bool
     {
-        return (*states)->read(sfile);
+        return states().read(sfile);
     };
 
     return readImpl(readfile, tell, seek, readStates);
@@ -230,6 +505,7 @@ bool CMap::readImpl(ReadFunc &&readfile, std::function<size_t()> tell, std::func
         LOGE("%s", m_lastError.c_str());
         return false;
     }
+    touchAll();
 
     // Read attributes
     m_attrs.clear();
@@ -259,7 +535,7 @@ bool CMap::readImpl(ReadFunc &&readfile, std::function<size_t()> tell, std::func
     extrahdr_t hdr;
     memset(&hdr, 0, sizeof(hdr));
     m_title = "";
-    m_states->clear();
+    states().clear();
 
     size_t ptr = tell();
     if (readfile(&hdr, sizeof(hdr)))
@@ -323,10 +599,9 @@ bool CMap::fromMemory(uint8_t *mem)
         return true;
     };
 
-    auto states = &m_states;
-    auto readStates = [&mem, states]() -> bool
+    auto readStates = [&mem, this]() -> bool
     {
-        return (*states)->fromMemory(mem);
+        return states().fromMemory(mem);
     };
 
     return readImpl(readfile, tell, seek, readStates);
@@ -359,6 +634,117 @@ bool CMap::write(IFile &tfile) const
     return m_states->write(tfile);
 }
 
+/**
+ * @brief Write only what differs from another map of the same size
+ *
+ * Tiles and attributes are stored as (key, value) pairs, a cleared
+ * attribute being written as 0. The title comes from the base map.
+ *
+ * @param tfile
+ * @param base map this one was copied from
+ * @return true
+ * @return false
+ */
+bool CMap::writeDelta(IFile &tfile, const CMap &base) const
+{
+    auto writefile = [&tfile](auto ptr, auto size)
+    {
+        return tfile.write(ptr, size) == 1;
+    };
+    if (m_len != base.m_len || m_hei != base.m_hei)
+    {
+        LOGE("delta against a %dx%d map; expecting %dx%d", base.m_len, base.m_hei, m_len, m_hei);
+        return false;
+    }
+
+    std::vector<uint16_t> tiles;
+    for (size_t i = 0; i < m_map.size(); ++i)
+    {
+        if (m_map[i] != base.m_map[i])
+            tiles.push_back(toKey(i % m_len, i / m_len));
+    }
+    uint32_t count = tiles.size();
+    _W(&count, sizeof(count));
+    for (const uint16_t key : tiles)
+    {
+        const uint8_t tile = m_map[(key & 0xff) + (key >> 8) * m_len];
+        _W(&key, sizeof(key));
+        _W(&tile, sizeof(tile));
+    }
+
+    std::vector<std::pair<uint16_t, uint8_t>> attrs;
+    for (const auto &[key, attr] : m_attrs)
+    {
+        const auto it = base.m_attrs.find(key);
+        if (it == base.m_attrs.end() || it->second != attr)
+            attrs.emplace_back(key, attr);
+    }
+    for (const auto &[key, attr] : base.m_attrs)
+    {
+        if (!m_attrs.count(key))
+            attrs.emplace_back(key, 0);
+    }
+    count = attrs.size();
+    _W(&count, sizeof(count));
+    for (const auto &[key, attr] : attrs)
+    {
+        _W(&key, sizeof(key));
+        _W(&attr, sizeof(attr));
+    }
+    return m_states->write(tfile);
+}
+
+/**
+ * @brief Rebuild the map from a base map and the output of writeDelta()
+ *
+ * @param sfile
+ * @param base map the delta was taken against
+ * @return true
+ * @return false
+ */
+bool CMap::readDelta(IFile &sfile, const CMap &base)
+{
+    auto readfile = [&sfile](auto ptr, auto size)
+    {
+        return sfile.read(ptr, size) == 1;
+    };
+    *this = base;
+
+    uint32_t count = 0;
+    _R(&count, sizeof(count));
+    if (count > m_map.size())
+    {
+        LOGE("too many tiles in map delta: %u", count);
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint16_t key = 0;
+        uint8_t tile = 0;
+        _R(&key, sizeof(key));
+        _R(&tile, sizeof(tile));
+        const Pos pos = toPos(key);
+        if (!isValid(pos.x, pos.y))
+        {
+            LOGE("tile (%d, %d) outside of the map", pos.x, pos.y);
+            return false;
+        }
+        set(pos.x, pos.y, tile);
+    }
+
+    _R(&count, sizeof(count));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint16_t key = 0;
+        uint8_t attr = 0;
+        _R(&key, sizeof(key));
+        _R(&attr, sizeof(attr));
+        const Pos pos = toPos(key);
+        setAttr(pos.x, pos.y, attr);
+    }
+    return states().read(sfile);
+}
+
 template <typename WriteFunc>
 bool CMap::writeCommon(WriteFunc writefile) const
 {
@@ -458,6 +844,7 @@ void CMap::fill(uint8_t ch)
         for (int i = 0; i < m_len * m_hei; ++i)
             m_map[i] = ch;
     m_attrs.clear();
+    touchAll();
 }
 
 uint8_t CMap::getAttr(const uint8_t x, const uint8_t y) const
@@ -477,6 +864,8 @@ uint8_t CMap::getAttr(const uint8_t x, const uint8_t y) const
 void CMap::setAttr(const uint8_t x, const uint8_t y, const uint8_t a)
 {
     const uint16_t key = toKey(x, y);
+    m_hash ^= Zobrist::key(Zobrist::ATTR, key, getAttr(x, y)) ^ Zobrist::key(Zobrist::ATTR, key, a);
+    ++m_attrEpoch;
     if (a == 0)
     {
         m_attrs.erase(key);
@@ -506,7 +895,38 @@ CMap &CMap::operator=(const CMap &map)
         m_map = map.m_map;
         m_attrs = map.m_attrs;
         m_title = map.m_title;
-        *m_states = *map.m_states;
+        m_states = map.m_states;
+        // derived from the tiles, which are the same
+        m_pass = map.m_pass;
+        m_hash = map.m_hash;
+        restamp();
+    }
+    return *this;
+}
+
+/**
+ * @brief Take over the content of another map
+ *
+ * The two maps trade their tiles, attributes and states; this map keeps
+ * its id and journal, like a copy.
+ *
+ * @param map
+ * @return CMap&
+ */
+CMap &CMap::operator=(CMap &&map)
+{
+    if (this != &map)
+    {
+        std::swap(m_len, map.m_len);
+        std::swap(m_hei, map.m_hei);
+        m_map.swap(map.m_map);
+        m_pass.swap(map.m_pass);
+        m_attrs.swap(map.m_attrs);
+        m_title.swap(map.m_title);
+        m_states.swap(map.m_states);
+        std::swap(m_hash, map.m_hash);
+        restamp();
+        map.restamp();
     }
     return *this;
 }
@@ -589,6 +1009,7 @@ void CMap::shift(Direction aim)
     }
 
     m_attrs = std::move(newAttrs); // Update attributes
+    touchAll();
 }
 
 uint16_t CMap::toKey(const uint8_t x, const uint8_t y)
@@ -631,8 +1052,17 @@ void CMap::setTitle(const char *title)
     m_title = title;
 }
 
+/**
+ * @brief States of the map, for writing
+ *
+ * Copies of a map share its states until one of them asks for them here.
+ *
+ * @return CStates&
+ */
 CStates &CMap::states()
 {
+    if (m_states.use_count() > 1)
+        m_states = std::make_shared<CStates>(*m_states);
     return *m_states;
 }
 
@@ -661,6 +1091,7 @@ bool CMap::resize(uint16_t in_len, uint16_t in_hei, uint8_t t, bool fast)
 
     m_len = in_len;
     m_hei = in_hei;
+    touchAll();
     return true;
 }
 
@@ -671,4 +1102,5 @@ void CMap::replaceTile(const uint8_t src, const uint8_t repl)
         if (tileID == src)
             tileID = repl;
     }
+    touchAll();
 }
\ No newline at end of file
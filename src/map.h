@@ -17,10 +17,12 @@
 */
 #pragma once
 
+#include <array>
 #include <unordered_map>
 #include <string>
 #include <functional>
 #include <memory> // For unique_ptr
+#include <vector>
 #include "shared/IFile.h"
 
 typedef std::unordered_map<uint16_t, uint8_t> AttrMap;
@@ -73,6 +75,8 @@ public:
     bool read(IFile &file);
     bool write(FILE *tfile) const;
     bool write(IFile &tfile) const;
+    bool readDelta(IFile &sfile, const CMap &base);
+    bool writeDelta(IFile &tfile, const CMap &base) const;
     void clear();
     int len() const;
     int hei() const;
@@ -85,6 +89,7 @@ public:
     size_t size() const;
     const char *lastError();
     CMap &operator=(const CMap &map);
+    CMap &operator=(CMap &&map);
     bool fromMemory(uint8_t *mem);
     const char *title();
     void setTitle(const char *title);
@@ -99,6 +104,15 @@ public:
     {
         return x >= 0 && x < m_len && y >= 0 && y < m_hei;
     }
+    /**
+     * @brief Movement classes that may step onto a cell
+     *
+     * @return uint8_t bit mask of Passability::Class; none outside the map
+     */
+    inline uint8_t passMask(const int x, const int y) const
+    {
+        return isValid(x, y) ? m_pass[x + y * m_len] : 0;
+    }
 
     enum Direction : int16_t
     {
@@ -112,17 +126,149 @@ public:
     void shift(Direction aim);
     void debug();
 
+    enum : uint32_t
+    {
+        JOURNAL_SIZE = 1024,  // power of two
+        BLOCK_SHIFT = 4,      // epoch blocks of 16x16 tiles
+        RAY_CACHE_SIZE = 256, // power of two
+        PAGE_SHIFT = 8,       // snapshot pages of 256 tiles
+        PAGE_SIZE = 1 << PAGE_SHIFT,
+    };
+
+    typedef std::array<uint8_t, PAGE_SIZE> page_t;
+
+    /**
+     * @brief Tiles and attributes of the map at one point in time
+     *
+     * The tiles are split into fixed-size pages. A page that was not
+     * written between two snapshots is shared by both rather than copied.
+     */
+    struct snapshot_t
+    {
+        uint32_t map = 0;       // id() of the map
+        uint32_t reset = 0;     // journal reset count of the map
+        uint32_t changes = 0;   // changeCount() when taken
+        uint32_t attrEpoch = 0; // attribute writes when taken
+        uint16_t len = 0;
+        uint16_t hei = 0;
+        std::vector<std::shared_ptr<const page_t>> pages;
+        std::shared_ptr<const AttrMap> attrs;
+    };
+    size_t snapshot(snapshot_t &snap, const snapshot_t *prev) const;
+    bool canRestore(const snapshot_t &snap) const;
+    bool restore(const snapshot_t &snap);
+
+    /**
+     * @brief Number of tiles changed with set() so far
+     *
+     * Used as a cursor into the change journal.
+     */
+    uint32_t changeCount() const { return m_changes; }
+
+    /**
+     * @brief Visit the cells written with set() since a given change count
+     *
+     * @param since value of changeCount() when the caller last synced
+     * @param visitor called with each changed cell, oldest first
+     * @return false if the journal no longer covers that range: the map was
+     *         replaced, reloaded or rewritten wholesale in the meantime and
+     *         the caller must rescan it completely
+     */
+    template <typename Visitor>
+    bool visitChanges(const uint32_t since, Visitor visitor) const
+    {
+        const uint32_t count = m_changes - since;
+        if (count > m_changes - m_reset || count > JOURNAL_SIZE)
+            return false;
+        for (uint32_t i = since; i != m_changes; ++i)
+            visitor(toPos(m_journal[i & (JOURNAL_SIZE - 1)]));
+        return true;
+    }
+
+    /**
+     * @brief Counter bumped whenever the pass mask of a tile changes
+     *
+     */
+    uint32_t passEpoch() const { return m_passEpoch; }
+
+    /**
+     * @brief Epoch block holding a tile
+     *
+     * @return int block index or -1 outside the map
+     */
+    inline int blockOf(const int x, const int y) const
+    {
+        return isValid(x, y) ? (x >> BLOCK_SHIFT) + (y >> BLOCK_SHIFT) * ((m_len + (1 << BLOCK_SHIFT) - 1) >> BLOCK_SHIFT) : -1;
+    }
+
+    /**
+     * @brief Value of passEpoch() when a tile of the block last changed its pass mask
+     *
+     * @param block index from blockOf()
+     */
+    uint32_t blockEpoch(const int block) const { return m_blockEpochs[block]; }
+
+    /**
+     * @brief Number that tells this map apart from any other CMap in the process
+     *
+     * Caches built from a map keep it along with their journal cursor or
+     * epoch; those are only meaningful for the map they were taken from.
+     */
+    uint32_t id() const { return m_id; }
+
+    /**
+     * @brief Zobrist hash of the tiles and attributes
+     *
+     * Kept up to date by set() and setAttr() at a constant cost per write.
+     */
+    uint64_t hash() const { return m_hash; }
+
+    bool isUnchangedSince(const Pos &a, const Pos &b, const uint32_t epoch) const;
+    bool isVisible(const Pos &from, const Pos &to, const uint8_t passClass) const;
+
+    /**
+     * @brief Number of isVisible() queries answered from the ray cache
+     *
+     */
+    size_t rayHitCount() const { return m_rayHits; }
+
 private:
+    struct ray_t
+    {
+        Pos from;
+        Pos to;
+        uint32_t epoch;    // passEpoch() when the ray was last checked
+        uint8_t passClass; // NONE for an unused slot
+        bool visible;
+    };
+
+    void touchAll();
+    void restamp();
+    void rehash();
+    bool traceRay(const Pos &from, const Pos &to, const uint8_t passClass) const;
+
     template <typename WriteFunc>
     bool writeCommon(WriteFunc writefile) const;
     template <typename ReadFunc>
     bool readImpl(ReadFunc &&readfile, std::function<size_t()> tell, std::function<bool(size_t)> seek, std::function<bool()> readStates);
 
+    uint32_t m_id;
     uint16_t m_len;
     uint16_t m_hei;
     std::vector<uint8_t> m_map;
+    std::vector<uint8_t> m_pass; // Passability::Class bits for each cell
     AttrMap m_attrs;
     std::string m_lastError;
     std::string m_title;
-    std::unique_ptr<CStates> m_states;
+    std::shared_ptr<CStates> m_states; // shared with the map copied from until written
+    std::array<uint16_t, JOURNAL_SIZE> m_journal; // keys of the last cells changed
+    uint32_t m_changes = 0;
+    uint32_t m_reset = 0; // change count when the whole map was last rewritten
+    uint32_t m_passEpoch = 0;
+    std::vector<uint32_t> m_blockEpochs;
+    std::vector<uint32_t> m_pageStamps; // change count of the last write to each page
+    uint32_t m_attrEpoch = 0;
+    uint64_t m_hash = 0;
+    mutable std::vector<ray_t> m_rays; // recent isVisible() results, allocated on first use
+    mutable size_t m_rayHits = 0;
 };
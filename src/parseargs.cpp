@@ -31,6 +31,7 @@ void showHelp()
          "-m <maparch>              set maparch override (full path)\n"
          "-w <workspace>            set user workspace\n"
          "--window 999x999          set window size\n"
+         "--replay-speed <n>        play recordings n ticks per frame\n"
          "\n"
          "flags:\n"
          "--easy                    switch to easy mode\n"
@@ -55,6 +56,7 @@ void initArgs(params_t &params)
     params.width = DEFAULT_WIDTH;
     params.height = DEFAULT_HEIGHT;
     params.strip_private = false;
+    params.replaySpeed = 1;
 }
 
 bool parseArgs(const std::vector<std::string> &list, params_t &params, bool &appExit)
@@ -134,6 +136,23 @@ bool parseArgs(const std::vector<std::string> &list, params_t &params, bool &app
                 result = false;
             }
         }
+        else if (strcmp(list[i].c_str(), "--replay-speed") == 0)
+        {
+            if (i + 1 < list.size() && list[i + 1].c_str()[0] != '-')
+            {
+                params.replaySpeed = strtol(list[++i].c_str(), nullptr, 10);
+                if (params.replaySpeed < 1 || params.replaySpeed > MAX_REPLAY_SPEED)
+                {
+                    LOGE("invalid speed: %d for --replay-speed (1-%d)", params.replaySpeed, MAX_REPLAY_SPEED);
+                    result = false;
+                }
+            }
+            else
+            {
+                LOGE("missing speed for --replay-speed");
+                result = false;
+            }
+        }
         else if (strcmp(list[i].c_str(), "--short") == 0)
         {
             LOGI("switching to short resolution");
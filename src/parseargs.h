@@ -34,6 +34,7 @@ typedef struct
     std::string workspace;
     int width;
     int height;
+    int replaySpeed;
 } params_t;
 
 bool parseArgs(const std::vector<std::string> &list, params_t &params, bool &appExit);
\ No newline at end of file
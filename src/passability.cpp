@@ -0,0 +1,122 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <array>
+#include <cstddef>
+#include "passability.h"
+#include "tilesdata.h"
+#include "tilesdefs.h"
+#include "sprtypes.h"
+#include "attr.h"
+
+namespace Passability
+{
+    using Table = std::array<uint8_t, 256>;
+
+    uint8_t classifyTile(const uint8_t tileID)
+    {
+        if (tileID >= TILES_TOTAL_COUNT)
+            return NONE;
+        const TileDef &def = getTileDef(tileID);
+        uint8_t mask = NONE;
+        switch (def.type)
+        {
+        case TYPE_BACKGROUND:
+            mask = PLAYER | MONSTER | CRUSHER | MOVEABLE | BULLET | SOLID_BOSS;
+            break;
+        case TYPE_SWAMP:
+        case TYPE_PICKUP:
+        case TYPE_DIAMOND:
+        case TYPE_CHUTE:
+        case TYPE_KEY:
+        case TYPE_FIRE:
+            mask = PLAYER;
+            break;
+        case TYPE_STOP:
+            mask = PLAYER | MOVEABLE | BULLET;
+            break;
+        case TYPE_DOOR:
+            mask = DOOR;
+            break;
+        case TYPE_PLAYER:
+            mask = CRUSHER | SOLID_BOSS;
+            break;
+        }
+        if (def.type != TYPE_SWAMP && def.type != TYPE_ICECUBE && tileID != TILES_WALLS93_3)
+            mask |= GHOST_BOSS;
+        return mask;
+    }
+
+    Class classifyActor(const uint8_t typeID)
+    {
+        if (typeID == TYPE_PLAYER)
+            return PLAYER;
+        if (RANGE(typeID, ATTR_CRUSHER_MIN, ATTR_CRUSHER_MAX))
+            return CRUSHER;
+        if (typeID == TYPE_BOULDER || typeID == TYPE_ICECUBE)
+            return MOVEABLE;
+        if (typeID == TYPE_FIREBALL || typeID == TYPE_LIGHTNING_BOLT)
+            return BULLET;
+        return MONSTER;
+    }
+
+    const Table &tileMasks()
+    {
+        static const Table table = []()
+        {
+            Table t{};
+            for (size_t i = 0; i < t.size(); ++i)
+                t[i] = classifyTile(static_cast<uint8_t>(i));
+            return t;
+        }();
+        return table;
+    }
+
+    const Table &actorClasses()
+    {
+        static const Table table = []()
+        {
+            Table t{};
+            for (size_t i = 0; i < t.size(); ++i)
+                t[i] = classifyActor(static_cast<uint8_t>(i));
+            return t;
+        }();
+        return table;
+    }
+}
+
+/**
+ * @brief Classes that may step onto a tile
+ *
+ * @param tileID
+ * @return uint8_t bit mask of Passability::Class
+ */
+uint8_t Passability::tileMask(const uint8_t tileID)
+{
+    return tileMasks()[tileID];
+}
+
+/**
+ * @brief Movement class of an actor type
+ *
+ * @param typeID
+ * @return Passability::Class
+ */
+Passability::Class Passability::actorClass(const uint8_t typeID)
+{
+    return static_cast<Class>(actorClasses()[typeID]);
+}
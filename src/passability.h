@@ -0,0 +1,47 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Movement classes that share the same passability rules
+ *
+ * The map keeps one byte per cell holding a bit for each class, set when a
+ * sprite of that class may step onto the tile (see CMap::passMask). Doors
+ * are flagged separately since they open for the player once the matching
+ * key was picked up.
+ */
+namespace Passability
+{
+    enum Class : uint8_t
+    {
+        NONE = 0x00,
+        PLAYER = 0x01,
+        MONSTER = 0x02,
+        CRUSHER = 0x04,
+        MOVEABLE = 0x08, // boulders and ice cubes
+        BULLET = 0x10,
+        SOLID_BOSS = 0x20, // bosses stopped by any solid tile
+        GHOST_BOSS = 0x40, // bosses only stopped by swamps, ice cubes and walls93_3
+        DOOR = 0x80,       // passable by the player holding the key
+    };
+
+    uint8_t tileMask(const uint8_t tileID);
+    Class actorClass(const uint8_t typeID);
+}
@@ -0,0 +1,207 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <chrono>
+#include "prefetch.h"
+#include "logger.h"
+
+CLevelPrefetch::CLevelPrefetch()
+{
+#ifndef __EMSCRIPTEN__
+    m_thread = std::thread(&CLevelPrefetch::workerLoop, this);
+#endif
+}
+
+/**
+ * @brief Drop the pending level, then stop the worker
+ *
+ */
+CLevelPrefetch::~CLevelPrefetch()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_hasPending = false;
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+/**
+ * @brief Start preparing a level
+ *
+ * Replaces the level prepared or waiting for the worker, unless it is the
+ * same one.
+ *
+ * @param index level index in the archive
+ * @param base archive map of that level; must outlive the request
+ */
+void CLevelPrefetch::submit(const int index, const CMap &base)
+{
+#ifdef __EMSCRIPTEN__
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_hasReady && matches(m_ready, index, base))
+        return;
+    request(m_ready, index, base);
+    prepare(m_ready);
+    m_hasReady = true;
+    ++m_prepares;
+#else
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const level_t &latest = m_hasPending || m_preparing ? m_pending : m_ready;
+        if ((m_hasPending || m_preparing || m_hasReady) && matches(latest, index, base))
+            return;
+        request(m_pending, index, base);
+        m_hasPending = true;
+        m_hasReady = false;
+        ++m_generation;
+    }
+    m_wake.notify_one();
+#endif
+}
+
+/**
+ * @brief Hand over a prepared level
+ *
+ * Waits for the worker if it is still busy with that level.
+ *
+ * @param index level index in the archive
+ * @param base archive map of that level
+ * @param level receives the prepared level
+ * @return true
+ * @return false the level was not submitted or its archive map has changed
+ */
+bool CLevelPrefetch::take(const int index, const CMap &base, level_t &level)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if ((m_hasPending || m_preparing) && matches(m_pending, index, base))
+        m_idle.wait(lock, [this]
+                    { return !m_hasPending && !m_preparing; });
+    if (!m_hasReady || !matches(m_ready, index, base))
+        return false;
+    moveLevel(level, m_ready);
+    m_hasReady = false;
+    return true;
+}
+
+/**
+ * @brief Forget every level submitted so far
+ *
+ * Returns once the worker no longer reads from an archive map.
+ *
+ */
+void CLevelPrefetch::cancel()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_hasPending = false;
+    m_hasReady = false;
+    ++m_generation;
+    m_idle.wait(lock, [this]
+                { return !m_preparing; });
+}
+
+/**
+ * @brief Number of levels prepared so far
+ *
+ * @return size_t
+ */
+size_t CLevelPrefetch::prepareCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_prepares;
+}
+
+void CLevelPrefetch::workerLoop()
+{
+    level_t work;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]
+                    { return m_hasPending || m_stopping; });
+        if (m_stopping)
+            break;
+        const uint32_t generation = m_generation;
+        copyRequest(work, m_pending);
+        m_hasPending = false;
+        m_preparing = true;
+        lock.unlock();
+        prepare(work);
+        lock.lock();
+        m_preparing = false;
+        ++m_prepares;
+        if (generation == m_generation)
+        {
+            moveLevel(m_ready, work);
+            m_hasReady = true;
+        }
+        m_idle.notify_all();
+    }
+}
+
+/**
+ * @brief Copy and scan the archive map of a level
+ *
+ * @param level
+ */
+void CLevelPrefetch::prepare(level_t &level)
+{
+    const auto start = std::chrono::steady_clock::now();
+    level.map = *level.base;
+    CGame::cacheLevel(level.cache, *level.base);
+    const auto usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    level.usecs = static_cast<uint32_t>(usecs.count());
+}
+
+void CLevelPrefetch::request(level_t &level, const int index, const CMap &base)
+{
+    level.index = index;
+    level.base = &base;
+    level.baseId = base.id();
+    level.baseChanges = base.changeCount();
+}
+
+void CLevelPrefetch::copyRequest(level_t &dest, const level_t &src)
+{
+    dest.index = src.index;
+    dest.base = src.base;
+    dest.baseId = src.baseId;
+    dest.baseChanges = src.baseChanges;
+}
+
+bool CLevelPrefetch::matches(const level_t &level, const int index, const CMap &base)
+{
+    return level.index == index && level.base == &base &&
+           level.baseId == base.id() && level.baseChanges == base.changeCount();
+}
+
+/**
+ * @brief Move a prepared level; the tiles are swapped, not copied
+ *
+ * @param dest
+ * @param src
+ */
+void CLevelPrefetch::moveLevel(level_t &dest, level_t &src)
+{
+    copyRequest(dest, src);
+    dest.map = std::move(src.map);
+    std::swap(dest.cache, src.cache);
+    dest.usecs = src.usecs;
+}
@@ -0,0 +1,81 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "game.h"
+
+/**
+ * @brief Prepares the next level off the game thread
+ *
+ * While a summary or intro screen is up, the level that follows is copied
+ * from the archive and scanned for its monsters and pickups by a worker
+ * thread. CGame::loadLevel() then swaps the prepared map in instead of
+ * building it on the frame where the player presses continue.
+ *
+ * Only the latest level submitted is kept. A prepared level is handed out
+ * only if its archive map is unchanged since it was submitted.
+ *
+ * Builds without thread support prepare the level on the calling thread.
+ */
+class CLevelPrefetch
+{
+public:
+    struct level_t
+    {
+        int index = -1;
+        const CMap *base = nullptr; // archive map
+        uint32_t baseId = 0;        // base->id() when submitted
+        uint32_t baseChanges = 0;   // base->changeCount() when submitted
+        CMap map;                   // copy of base
+        levelCache_t cache;         // scan of base
+        uint32_t usecs = 0;         // time spent preparing
+    };
+
+    CLevelPrefetch();
+    ~CLevelPrefetch();
+    void submit(const int index, const CMap &base);
+    bool take(const int index, const CMap &base, level_t &level);
+    void cancel();
+    size_t prepareCount() const;
+
+private:
+    void workerLoop();
+    static void prepare(level_t &level);
+    static void request(level_t &level, const int index, const CMap &base);
+    static void copyRequest(level_t &dest, const level_t &src);
+    static bool matches(const level_t &level, const int index, const CMap &base);
+    static void moveLevel(level_t &dest, level_t &src);
+
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    level_t m_pending; // waiting for the worker; only the request is set
+    level_t m_ready;
+    uint32_t m_generation = 0; // bumped by submit() and cancel()
+    bool m_hasPending = false;
+    bool m_hasReady = false;
+    bool m_preparing = false;
+    bool m_stopping = false;
+    size_t m_prepares = 0;
+};
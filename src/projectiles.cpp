@@ -0,0 +1,193 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include "projectiles.h"
+
+CProjectiles::CProjectiles()
+{
+    m_actors.reserve(RESERVED);
+    m_order.reserve(RESERVED);
+    m_alive.reserve(RESERVED);
+    m_impacts.reserve(RESERVED);
+}
+
+/**
+ * @brief Remove all projectiles
+ *
+ */
+void CProjectiles::clear()
+{
+    for (size_t i = 0; i < m_size; ++i)
+        m_actors[i] = CActor();
+    m_size = 0;
+    m_cursor = 0;
+    m_impacts.clear();
+}
+
+/**
+ * @brief Add a projectile behind the others
+ *
+ * Slots freed by compact() are reused first; the pool only grows once
+ * they are all taken, which invalidates references to the projectiles.
+ *
+ * @param actor projectile body
+ * @param order number of monsters ahead of the projectile
+ * @return CActor*
+ */
+CActor *CProjectiles::spawn(CActor &&actor, const int order)
+{
+    if (m_size == m_actors.size())
+    {
+        m_actors.emplace_back(std::move(actor));
+        m_order.emplace_back(order);
+        m_alive.emplace_back(true);
+    }
+    else
+    {
+        m_actors[m_size] = std::move(actor);
+        m_order[m_size] = order;
+        m_alive[m_size] = true;
+    }
+    return &m_actors[m_size++];
+}
+
+/**
+ * @brief Mark a projectile as spent; it is reclaimed by compact()
+ *
+ * @param i
+ */
+void CProjectiles::kill(const int i)
+{
+    if (i >= 0 && static_cast<size_t>(i) < m_size)
+        m_alive[i] = false;
+}
+
+bool CProjectiles::isAlive(const int i) const
+{
+    return i >= 0 && static_cast<size_t>(i) < m_size && m_alive[i];
+}
+
+/**
+ * @brief Reclaim the spent projectiles, keeping the others in order
+ *
+ */
+void CProjectiles::compact()
+{
+    size_t j = 0;
+    for (size_t i = 0; i < m_size; ++i)
+    {
+        if (!m_alive[i])
+            continue;
+        if (i != j)
+        {
+            m_actors[j] = std::move(m_actors[i]);
+            m_order[j] = m_order[i];
+            m_alive[j] = true;
+        }
+        ++j;
+    }
+    for (size_t i = j; i < m_size; ++i)
+        m_actors[i] = CActor();
+    m_size = j;
+    m_cursor = std::min(m_cursor, m_size);
+}
+
+/**
+ * @brief A monster was removed from the monster list
+ *
+ * @param index index of the monster that was removed
+ */
+void CProjectiles::eraseMonster(const int index)
+{
+    for (size_t i = 0; i < m_size; ++i)
+    {
+        if (m_order[i] > index)
+            --m_order[i];
+    }
+}
+
+int CProjectiles::order(const int i) const
+{
+    return m_order[i];
+}
+
+size_t CProjectiles::size() const
+{
+    return m_size;
+}
+
+CActor &CProjectiles::operator[](const int i)
+{
+    return m_actors[i];
+}
+
+const CActor &CProjectiles::operator[](const int i) const
+{
+    return m_actors[i];
+}
+
+/**
+ * @brief Start a pass over the projectiles
+ *
+ */
+void CProjectiles::begin()
+{
+    m_cursor = 0;
+}
+
+/**
+ * @brief Next live projectile that comes before a given monster
+ *
+ * @param limit monster index or LAST for the remaining projectiles
+ * @return int projectile index or NONE
+ */
+int CProjectiles::next(const int limit)
+{
+    while (m_cursor < m_size && m_order[m_cursor] <= limit)
+    {
+        const size_t i = m_cursor++;
+        if (m_alive[i])
+            return static_cast<int>(i);
+    }
+    return NONE;
+}
+
+/**
+ * @brief Queue the effects of a projectile hitting something
+ *
+ * @param impact
+ */
+void CProjectiles::addImpact(const impact_t &impact)
+{
+    m_impacts.emplace_back(impact);
+}
+
+const CProjectiles::impact_t *CProjectiles::impacts() const
+{
+    return m_impacts.data();
+}
+
+size_t CProjectiles::impactCount() const
+{
+    return m_impacts.size();
+}
+
+void CProjectiles::clearImpacts()
+{
+    m_impacts.clear();
+}
@@ -0,0 +1,94 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "actor.h"
+
+/**
+ * @brief Pool for fireballs and lightning bolts
+ *
+ * Projectiles are kept out of the monster list: they are not tracked by the
+ * monster grid or the scheduler and their slots are recycled in place.
+ * Room for RESERVED projectiles is set aside up front; past that the pool
+ * grows rather than dropping shots.
+ * They still occupy a tile on the map since monsters, bosses and the player
+ * collide against them.
+ *
+ * Each projectile records how many monsters were ahead of it in the actor
+ * list (its order) so that the game can keep visiting monsters and
+ * projectiles in the sequence they were created.
+ */
+class CProjectiles
+{
+public:
+    enum : int
+    {
+        NONE = -1,
+        RESERVED = 128,
+        LAST = 0x7fffffff,
+    };
+
+    enum Hit : uint8_t
+    {
+        HIT_NONE,
+        HIT_ICECUBE,
+        HIT_PLAYER,
+        HIT_BARREL,
+    };
+
+    struct impact_t
+    {
+        Pos pos;        // where the projectile died
+        Pos target;     // cell in front of the projectile
+        uint8_t type;   // projectile type
+        Hit hit;        // what was struck
+        int16_t health; // damage dealt to the player
+        int monster;    // icecube index for HIT_ICECUBE
+    };
+
+    CProjectiles();
+    void clear();
+    CActor *spawn(CActor &&actor, const int order);
+    void kill(const int i);
+    bool isAlive(const int i) const;
+    void compact();
+    void eraseMonster(const int index);
+    int order(const int i) const;
+    size_t size() const;
+    CActor &operator[](const int i);
+    const CActor &operator[](const int i) const;
+
+    void begin();
+    int next(const int limit);
+
+    void addImpact(const impact_t &impact);
+    const impact_t *impacts() const;
+    size_t impactCount() const;
+    void clearImpacts();
+
+private:
+    std::vector<CActor> m_actors;
+    std::vector<int> m_order;
+    std::vector<uint8_t> m_alive;
+    std::vector<impact_t> m_impacts;
+    size_t m_size = 0;
+    size_t m_cursor = 0;
+};
@@ -37,6 +37,9 @@ public:
     // Reset to initial seed and tick
     void reset();
 
+    // Current generator state
+    uint32_t state() const { return state_; }
+
 private:
     uint32_t state_;
     uint32_t initialSeed_;
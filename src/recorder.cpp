@@ -16,9 +16,20 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <algorithm>
+#include <cinttypes>
 #include <cstring>
+#include <zlib.h>
 #include "recorder.h"
 #include "logger.h"
+#include "shared/helper.h"
+
+namespace RecorderPrivate
+{
+    constexpr char CHECKPOINT_SIG[] = {'H', 'S', 'H', '!'};
+    constexpr char KEYFRAME_SIG[] = {'K', 'E', 'Y', '!'};
+};
+
+using namespace RecorderPrivate;
 
 CRecorder::CRecorder(const size_t bufSize)
 {
@@ -48,6 +59,13 @@ bool CRecorder::start(IFile *file, bool isWrite)
     m_index = 0;
     m_count = 0;
     m_size = 0;
+    m_ticks = 0;
+    m_checkpoints.clear();
+    m_nextCheckpoint = 0;
+    m_mismatch = NO_MISMATCH;
+    m_keyframes.clear();
+    m_index = 0;
+    m_batchSize = 0;
 
     m_mode = isWrite ? MODE_WRITE : MODE_READ;
     m_file = file;
@@ -55,6 +73,7 @@ bool CRecorder::start(IFile *file, bool isWrite)
     {
         const uint32_t version = VERSION;
         const uint8_t placeholder[] = {0, 0, 0, 0};
+        m_version = VERSION;
         writeFile(SIG, sizeof(SIG));
         writeFile(&version, sizeof(version));
         m_offset = file->tell();
@@ -75,13 +94,20 @@ bool CRecorder::start(IFile *file, bool isWrite)
             return false;
         }
         readFile(&version, sizeof(version));
-        if (version != VERSION)
+        if (version != VERSION_0 && version != VERSION_1)
         {
             LOGE("version mismatch: 0x%.8x; expecting :0x%.8x", version, VERSION);
             return false;
         }
+        m_version = version;
         readFile(&m_size, sizeof(m_size)); // total datasize of data
-        readNextBatch();
+        m_length = m_size;
+        // state hashes and keyframes, if any, follow the input data
+        m_start = m_file->tell();
+        m_file->seek(m_start + m_size);
+        if (readCheckpoints() && m_version >= VERSION_1)
+            readKeyframes();
+        m_file->seek(m_start);
     }
     else
     {
@@ -104,6 +130,7 @@ bool CRecorder::readNextBatch()
 
 void CRecorder::append(const uint8_t *input)
 {
+    ++m_ticks;
     // encode input
     uint8_t data = 0;
     for (int i = 0; i < INPUTS; ++i)
@@ -119,31 +146,54 @@ void CRecorder::append(const uint8_t *input)
     else if (m_current == data)
     {
         ++m_count;
-        if (m_count == MAX_CPT)
-        {
-            storeData(false);
-            m_newInfo = true;
-        }
     }
     else
     {
         storeData(false);
         m_current = data;
-        ++m_count;
+        m_count = 1;
     }
 }
 
+/**
+ * @brief Write out the current run
+ *
+ * Runs of up to MAX_CPT ticks fit in the count nibble. Longer runs have
+ * a zero count followed by their length as a varint.
+ *
+ * @param finalize flush the buffer to disk
+ */
 void CRecorder::storeData(bool finalize)
 {
     if (m_count && !m_newInfo)
-        m_buffer[m_index++] = m_current | (m_count << 4);
+    {
+        if (m_count <= MAX_CPT)
+        {
+            putByte(m_current | (m_count << 4));
+        }
+        else
+        {
+            putByte(m_current);
+            uint32_t count = m_count;
+            for (; count >= VARINT_MORE; count >>= VARINT_BITS)
+                putByte((count & (VARINT_MORE - 1)) | VARINT_MORE);
+            putByte(count);
+        }
+    }
     m_count = 0;
-    if ((m_index == m_bufSize) || finalize)
+    if (finalize)
     {
         dump();
     }
 }
 
+void CRecorder::putByte(const uint8_t data)
+{
+    m_buffer[m_index++] = data;
+    if (m_index == m_bufSize)
+        dump();
+}
+
 void CRecorder::dump()
 {
     if (m_index)
@@ -155,39 +205,50 @@ void CRecorder::dump()
     m_index = 0;
 }
 
-void CRecorder::nextData()
+bool CRecorder::nextByte(uint8_t &data)
 {
-    const uint8_t data = m_buffer[m_index++];
-    m_current = data & MAX_CPT;
-    m_count = data >> 4;
+    // fetch next batch from disk
+    if (m_index == m_batchSize &&
+        (m_size == 0 || !readNextBatch()))
+        return false;
+    data = m_buffer[m_index++];
+    return true;
 }
 
-bool CRecorder::get(uint8_t *output)
+/**
+ * @brief Read the next run
+ *
+ * @return true
+ * @return false at the end of the stream
+ */
+bool CRecorder::nextData()
 {
-    if (m_newInfo)
-    {
-        nextData();
-        m_newInfo = false;
-        --m_count;
-    }
-    else if (m_count != 0)
-    {
-        --m_count;
-    }
-    else
+    uint8_t data = 0;
+    if (!nextByte(data))
+        return false;
+    m_current = data & MAX_CPT;
+    m_count = data >> 4;
+    if (m_count == 0 && m_version >= VERSION_1)
     {
-        // fetch next batch from disk
-        if (m_index == m_batchSize)
+        for (int shift = 0; shift < 32; shift += VARINT_BITS)
         {
-            if (m_size != 0)
-                readNextBatch();
-            else
+            if (!nextByte(data))
                 return false;
+            m_count |= static_cast<uint32_t>(data & (VARINT_MORE - 1)) << shift;
+            if (!(data & VARINT_MORE))
+                break;
         }
-        nextData();
-        --m_count;
     }
+    return m_count != 0;
+}
+
+bool CRecorder::get(uint8_t *output)
+{
+    if (m_count == 0 && !nextData())
+        return false;
+    --m_count;
     decode(output, m_current);
+    ++m_ticks;
     return true;
 }
 
@@ -205,6 +266,15 @@ void CRecorder::stop()
     if (m_mode == MODE_WRITE)
     {
         storeData(true);
+        if (!writeCheckpoints())
+        {
+            LOGE("CRecorder::stop() failed to write checkpoints");
+        }
+        else if (!writeKeyframes())
+        {
+            LOGE("CRecorder::stop() failed to write keyframes");
+        }
+        m_keyframes.clear();
         m_file->seek(m_offset);
         if (m_file->write(&m_size, sizeof(m_size)) != IFILE_OK)
             LOGE("CRecorder::stop() write fail");
@@ -228,4 +298,295 @@ bool CRecorder::isReading() const
 bool CRecorder::isStopped() const
 {
     return m_mode == MODE_CLOSED;
-}
\ No newline at end of file
+}
+/**
+ * @brief Is a state hash due after the current tick
+ *
+ * While recording, one every CHECKPOINT_INTERVAL ticks. During playback,
+ * whenever the recording holds one for this tick.
+ *
+ * @return true
+ * @return false
+ */
+bool CRecorder::isCheckpoint() const
+{
+    if (m_mode == MODE_WRITE)
+        return m_ticks % CHECKPOINT_INTERVAL == 0 &&
+               (m_checkpoints.empty() || m_checkpoints.back().tick != m_ticks);
+    if (m_mode == MODE_READ)
+        return m_nextCheckpoint < m_checkpoints.size() &&
+               m_checkpoints[m_nextCheckpoint].tick == m_ticks;
+    return false;
+}
+
+/**
+ * @brief Store the state hash of the current tick or check it against the recording
+ *
+ * @param hash CGame::stateHash()
+ */
+void CRecorder::checkpoint(const uint64_t hash)
+{
+    if (!isCheckpoint())
+        return;
+    if (m_mode == MODE_WRITE)
+    {
+        if (m_checkpoints.size() < MAX_CHECKPOINTS)
+            m_checkpoints.push_back({m_ticks, hash});
+        return;
+    }
+    const checkpoint_t &expected = m_checkpoints[m_nextCheckpoint++];
+    if (expected.hash != hash && m_mismatch == NO_MISMATCH)
+    {
+        m_mismatch = static_cast<int32_t>(m_ticks);
+        LOGW("playback diverged at tick %u: state hash %.16" PRIx64 "; expecting %.16" PRIx64,
+             m_ticks, hash, expected.hash);
+    }
+}
+
+/**
+ * @brief First tick whose state hash differed from the recording
+ *
+ * @return int32_t tick or NO_MISMATCH
+ */
+int32_t CRecorder::firstMismatch() const
+{
+    return m_mismatch;
+}
+
+bool CRecorder::readCheckpoints()
+{
+    auto readFile = [this](auto ptr, auto size)
+    {
+        return m_file->read(ptr, size) == IFILE_OK;
+    };
+    char sig[sizeof(CHECKPOINT_SIG)];
+    uint32_t count = 0;
+    // recordings made before checkpoints end with the input data
+    if (!readFile(sig, sizeof(sig)) ||
+        memcmp(sig, CHECKPOINT_SIG, sizeof(sig)) != 0 ||
+        !readFile(&count, sizeof(count)) ||
+        count > MAX_CHECKPOINTS)
+        return false;
+    m_checkpoints.resize(count);
+    for (auto &checkpoint : m_checkpoints)
+    {
+        if (!readFile(&checkpoint.tick, sizeof(checkpoint.tick)) ||
+            !readFile(&checkpoint.hash, sizeof(checkpoint.hash)))
+        {
+            LOGE("truncated checkpoints");
+            m_checkpoints.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CRecorder::writeCheckpoints()
+{
+    auto writeFile = [this](auto ptr, auto size)
+    {
+        return m_file->write(ptr, size) == IFILE_OK;
+    };
+    const uint32_t count = m_checkpoints.size();
+    if (!writeFile(CHECKPOINT_SIG, sizeof(CHECKPOINT_SIG)) ||
+        !writeFile(&count, sizeof(count)))
+        return false;
+    for (const auto &checkpoint : m_checkpoints)
+    {
+        if (!writeFile(&checkpoint.tick, sizeof(checkpoint.tick)) ||
+            !writeFile(&checkpoint.hash, sizeof(checkpoint.hash)))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Take a keyframe every n ticks while recording
+ *
+ * @param ticks interval or 0 to record without keyframes
+ */
+void CRecorder::setKeyframeInterval(const uint32_t ticks)
+{
+    m_keyframeInterval = ticks;
+}
+
+/**
+ * @brief Is a keyframe due before the next tick
+ *
+ * @return true
+ * @return false
+ */
+bool CRecorder::isKeyframe() const
+{
+    return m_mode == MODE_WRITE && m_keyframeInterval != 0 &&
+           m_ticks % m_keyframeInterval == 0 &&
+           m_keyframes.size() < MAX_KEYFRAMES &&
+           (m_keyframes.empty() || m_keyframes.back().tick != m_ticks);
+}
+
+/**
+ * @brief Store a saved game from which playback can resume
+ *
+ * The current run is closed so that the next tick starts on a fresh byte
+ * of the stream.
+ *
+ * @param snapshot saved game as of the ticks recorded so far
+ */
+void CRecorder::keyframe(const std::vector<uint8_t> &snapshot)
+{
+    if (!isKeyframe())
+        return;
+    storeData(false);
+    m_newInfo = true;
+    keyframe_t keyframe{m_ticks, m_size + m_index, static_cast<uint32_t>(snapshot.size()), 0, 0, {}};
+    if (compressData(snapshot, keyframe.data) != Z_OK)
+    {
+        LOGE("failed to pack keyframe at tick %u", m_ticks);
+        return;
+    }
+    keyframe.packed = keyframe.data.size();
+    m_keyframes.push_back(std::move(keyframe));
+}
+
+/**
+ * @brief Tick of the last keyframe at or before a given tick
+ *
+ * @param tick
+ * @param keyframe
+ * @return true
+ * @return false no such keyframe
+ */
+bool CRecorder::findKeyframe(const uint32_t tick, uint32_t &keyframe) const
+{
+    const keyframe_t *last = lastKeyframe(tick);
+    if (!last)
+        return false;
+    keyframe = last->tick;
+    return true;
+}
+
+/**
+ * @brief Move the playback to the last keyframe at or before a tick
+ *
+ * The caller restores the snapshot then plays the remaining ticks, if
+ * any, to reach the tick it asked for.
+ *
+ * @param tick
+ * @param snapshot saved game of the keyframe
+ * @return true
+ * @return false no keyframe or unreadable keyframe
+ */
+bool CRecorder::seek(const uint32_t tick, std::vector<uint8_t> &snapshot)
+{
+    const keyframe_t *last = lastKeyframe(tick);
+    if (m_mode != MODE_READ || !last)
+    {
+        LOGW("no keyframe at or before tick %u", tick);
+        return false;
+    }
+    const keyframe_t &keyframe = *last;
+    std::vector<uint8_t> packed(keyframe.packed);
+    snapshot.resize(keyframe.size);
+    uLongf size = keyframe.size;
+    if (!m_file->seek(keyframe.pos) ||
+        m_file->read(packed.data(), packed.size()) != IFILE_OK ||
+        uncompress(snapshot.data(), &size, packed.data(), packed.size()) != Z_OK ||
+        size != keyframe.size)
+    {
+        LOGE("cannot read keyframe at tick %u", keyframe.tick);
+        return false;
+    }
+
+    m_file->seek(m_start + keyframe.offset);
+    m_size = m_length - keyframe.offset;
+    m_index = 0;
+    m_batchSize = 0;
+    m_count = 0;
+    m_ticks = keyframe.tick;
+    m_nextCheckpoint = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), m_ticks,
+                                        [](const uint32_t tick, const checkpoint_t &checkpoint)
+                                        { return tick < checkpoint.tick; }) -
+                       m_checkpoints.begin();
+    if (m_mismatch > static_cast<int32_t>(m_ticks))
+        m_mismatch = NO_MISMATCH;
+    return true;
+}
+
+/**
+ * @brief Number of ticks recorded or played so far
+ *
+ * @return uint32_t
+ */
+uint32_t CRecorder::tick() const
+{
+    return m_ticks;
+}
+
+size_t CRecorder::keyframeCount() const
+{
+    return m_keyframes.size();
+}
+
+const CRecorder::keyframe_t *CRecorder::lastKeyframe(const uint32_t tick) const
+{
+    auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), tick,
+                               [](const uint32_t tick, const keyframe_t &keyframe)
+                               { return tick < keyframe.tick; });
+    return it == m_keyframes.begin() ? nullptr : &*--it;
+}
+
+bool CRecorder::readKeyframes()
+{
+    auto readFile = [this](auto ptr, auto size)
+    {
+        return m_file->read(ptr, size) == IFILE_OK;
+    };
+    char sig[sizeof(KEYFRAME_SIG)];
+    uint32_t count = 0;
+    if (!readFile(sig, sizeof(sig)) ||
+        memcmp(sig, KEYFRAME_SIG, sizeof(sig)) != 0 ||
+        !readFile(&count, sizeof(count)) ||
+        count > MAX_KEYFRAMES)
+        return false;
+    const long fileSize = m_file->getSize();
+    m_keyframes.resize(count);
+    for (auto &keyframe : m_keyframes)
+    {
+        if (!readFile(&keyframe.tick, sizeof(keyframe.tick)) ||
+            !readFile(&keyframe.offset, sizeof(keyframe.offset)) ||
+            !readFile(&keyframe.size, sizeof(keyframe.size)) ||
+            !readFile(&keyframe.packed, sizeof(keyframe.packed)) ||
+            keyframe.offset > m_length ||
+            m_file->tell() + static_cast<long>(keyframe.packed) > fileSize)
+        {
+            LOGE("truncated keyframes");
+            m_keyframes.clear();
+            return false;
+        }
+        keyframe.pos = m_file->tell();
+        m_file->seek(keyframe.pos + keyframe.packed);
+    }
+    return true;
+}
+
+bool CRecorder::writeKeyframes()
+{
+    auto writeFile = [this](auto ptr, auto size)
+    {
+        return m_file->write(ptr, size) == IFILE_OK;
+    };
+    const uint32_t count = m_keyframes.size();
+    if (!writeFile(KEYFRAME_SIG, sizeof(KEYFRAME_SIG)) ||
+        !writeFile(&count, sizeof(count)))
+        return false;
+    for (const auto &keyframe : m_keyframes)
+    {
+        if (!writeFile(&keyframe.tick, sizeof(keyframe.tick)) ||
+            !writeFile(&keyframe.offset, sizeof(keyframe.offset)) ||
+            !writeFile(&keyframe.size, sizeof(keyframe.size)) ||
+            !writeFile(&keyframe.packed, sizeof(keyframe.packed)) ||
+            !writeFile(keyframe.data.data(), keyframe.data.size()))
+            return false;
+    }
+    return true;
+}
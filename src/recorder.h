@@ -19,8 +19,18 @@
 
 #include <cinttypes>
 #include <cstdio>
+#include <vector>
 #include "shared/IFile.h"
 
+/**
+ * @brief Joystick stream of a recording
+ *
+ * The stream is a run-length list of input states. Format v1 writes
+ * runs longer than 15 ticks as a varint and can hold keyframes: saved
+ * games taken every few seconds along with the stream offset they
+ * resume from, so that playback can seek without replaying from the
+ * start. Format v0 recordings still play.
+ */
 class CRecorder
 {
 public:
@@ -34,6 +44,21 @@ public:
     bool isRecording() const;
     bool isReading() const;
     bool isStopped() const;
+    bool isCheckpoint() const;
+    void checkpoint(const uint64_t hash);
+    int32_t firstMismatch() const;
+    void setKeyframeInterval(const uint32_t ticks);
+    bool isKeyframe() const;
+    void keyframe(const std::vector<uint8_t> &snapshot);
+    bool findKeyframe(const uint32_t tick, uint32_t &keyframe) const;
+    bool seek(const uint32_t tick, std::vector<uint8_t> &snapshot);
+    uint32_t tick() const;
+    size_t keyframeCount() const;
+
+    enum : int32_t
+    {
+        NO_MISMATCH = -1,
+    };
 
 private:
     enum
@@ -44,23 +69,64 @@ private:
         MODE_CLOSED = 0,
         MODE_READ = 1,
         MODE_WRITE = 2,
-        VERSION = 0,
+        VERSION_0 = 0, // 4-bit run lengths
+        VERSION_1 = 1, // varint run lengths, keyframes
+        VERSION = VERSION_1,
+        CHECKPOINT_INTERVAL = 24, // ticks between two state hashes
+        KEYFRAME_INTERVAL = 720,  // ticks between two keyframes (30s)
+        MAX_CHECKPOINTS = 0x100000,
+        MAX_KEYFRAMES = 0x10000,
+        VARINT_BITS = 7,
+        VARINT_MORE = 0x80,
+    };
+
+    struct checkpoint_t
+    {
+        uint32_t tick;
+        uint64_t hash;
     };
+
+    struct keyframe_t
+    {
+        uint32_t tick;             // ticks played before the keyframe
+        uint32_t offset;           // stream offset of the next tick
+        uint32_t size;             // snapshot size once inflated
+        uint32_t packed;           // snapshot size in the file
+        long pos;                  // file position of the packed snapshot
+        std::vector<uint8_t> data; // packed snapshot, while recording
+    };
+
     uint8_t m_mode;
     bool m_newInfo = true;
     uint8_t m_current;
     uint32_t m_count;
     uint32_t m_index;
     uint32_t m_size;
+    uint32_t m_version = VERSION;
+    long m_start = 0;      // file position of the stream
+    uint32_t m_length = 0; // stream size
     uint32_t m_batchSize;
     uint8_t *m_buffer = nullptr;
     size_t m_bufSize;
     IFile *m_file = nullptr;
     size_t m_offset;
+    uint32_t m_ticks = 0;
+    std::vector<checkpoint_t> m_checkpoints;
+    size_t m_nextCheckpoint = 0;
+    int32_t m_mismatch = NO_MISMATCH;
+    uint32_t m_keyframeInterval = KEYFRAME_INTERVAL;
+    std::vector<keyframe_t> m_keyframes;
 
     void decode(uint8_t *output, uint8_t data);
     void storeData(bool finalize);
+    void putByte(const uint8_t data);
     void dump();
     bool readNextBatch();
-    void nextData();
+    bool nextByte(uint8_t &data);
+    bool nextData();
+    bool readCheckpoints();
+    bool writeCheckpoints();
+    const keyframe_t *lastKeyframe(const uint32_t tick) const;
+    bool readKeyframes();
+    bool writeKeyframes();
 };
\ No newline at end of file
@@ -0,0 +1,125 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include "rewind.h"
+
+/**
+ * @brief Bound the ring by duration and memory
+ *
+ * @param ticks snapshots kept, 0 to disable rewinding
+ * @param bytes memory the snapshots may use
+ */
+void CRewind::setLimits(const size_t ticks, const size_t bytes)
+{
+    m_maxTicks = ticks;
+    m_maxBytes = bytes;
+    if (!m_maxTicks)
+        clear();
+}
+
+bool CRewind::isEnabled() const
+{
+    return m_maxTicks != 0;
+}
+
+void CRewind::clear()
+{
+    m_frames.clear();
+    m_bytes = 0;
+}
+
+/**
+ * @brief Map snapshot of the newest frame, to share pages with
+ *
+ * @return const CMap::snapshot_t* or nullptr if empty
+ */
+const CMap::snapshot_t *CRewind::lastMap() const
+{
+    return m_frames.empty() ? nullptr : &m_frames.back().map;
+}
+
+/**
+ * @brief Add the snapshot of the current tick, dropping the oldest as needed
+ *
+ * A page shared with the next frame stays alive with it, so the memory
+ * freed by dropping a frame is only what that frame owned alone.
+ *
+ * @param frame
+ * @param usecs time taken to capture it
+ */
+void CRewind::push(frame_t &&frame, const uint32_t usecs)
+{
+    m_last = {frame.bytes, usecs};
+    m_peak.bytes = std::max(m_peak.bytes, m_last.bytes);
+    m_peak.usecs = std::max(m_peak.usecs, m_last.usecs);
+    m_bytes += frame.bytes;
+    m_frames.emplace_back(std::move(frame));
+    while (m_frames.size() > 1 &&
+           (m_frames.size() > m_maxTicks || m_bytes > m_maxBytes))
+    {
+        m_bytes -= m_frames.front().bytes;
+        m_frames.pop_front();
+    }
+}
+
+/**
+ * @brief Take out the newest snapshot
+ *
+ * @param frame
+ * @return true
+ * @return false the ring is empty
+ */
+bool CRewind::pop(frame_t &frame)
+{
+    if (m_frames.empty())
+        return false;
+    frame = std::move(m_frames.back());
+    m_frames.pop_back();
+    m_bytes -= frame.bytes;
+    return true;
+}
+
+size_t CRewind::size() const
+{
+    return m_frames.size();
+}
+
+size_t CRewind::bytes() const
+{
+    return m_bytes;
+}
+
+/**
+ * @brief Memory and time spent on the last snapshot
+ *
+ * @return const cost_t&
+ */
+const CRewind::cost_t &CRewind::lastCost() const
+{
+    return m_last;
+}
+
+/**
+ * @brief Largest memory and time spent on a single snapshot
+ *
+ * @return const cost_t&
+ */
+const CRewind::cost_t &CRewind::peakCost() const
+{
+    return m_peak;
+}
@@ -0,0 +1,68 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "map.h"
+
+/**
+ * @brief The last few seconds of gameplay, one snapshot per tick
+ *
+ * Each snapshot holds the map as CMap pages, shared with the snapshot
+ * before it when untouched, along with the rest of the game state
+ * serialized in memory. The oldest snapshots are dropped once the ring
+ * holds more ticks or more bytes than allowed.
+ */
+class CRewind
+{
+public:
+    struct frame_t
+    {
+        CMap::snapshot_t map;
+        std::vector<uint8_t> state; // CGame::writeState() and front-end state
+        size_t bytes;               // memory owned by this frame alone
+    };
+
+    struct cost_t
+    {
+        size_t bytes;   // memory added by the snapshot
+        uint32_t usecs; // time taken to capture it
+    };
+
+    void setLimits(const size_t ticks, const size_t bytes);
+    bool isEnabled() const;
+    void clear();
+    const CMap::snapshot_t *lastMap() const;
+    void push(frame_t &&frame, const uint32_t usecs);
+    bool pop(frame_t &frame);
+    size_t size() const;
+    size_t bytes() const;
+    const cost_t &lastCost() const;
+    const cost_t &peakCost() const;
+
+private:
+    std::deque<frame_t> m_frames;
+    size_t m_maxTicks = 0;
+    size_t m_maxBytes = 0;
+    size_t m_bytes = 0;
+    cost_t m_last{0, 0};
+    cost_t m_peak{0, 0};
+};
@@ -41,6 +41,8 @@
 #include "attr.h"
 #include "color.h"
 #include "filemacros.h"
+#include "autosave.h"
+#include "recorder.h"
 
 #define _f(x) static_cast<float>(x)
 
@@ -50,6 +52,7 @@
 #endif
 const char HISCORE_FILE[] = "hiscores-cs3.dat";
 const char SAVEGAME_FILE[] = "savegame-cs3.dat";
+const char AUTOSAVE_NAME[] = "Autosave";
 
 CRuntime::CRuntime() : CGameMixin()
 {
@@ -283,9 +286,45 @@ void CRuntime::cleanup()
     LOGI("cleanup()");
 }
 
+/**
+ * @brief Run the game for one frame
+ *
+ * In turbo playback several ticks run back to back; only the state after
+ * the last one gets painted.
+ */
 void CRuntime::run()
 {
     mainLoop();
+    for (int i = 1; i < ticksPerFrame(); ++i)
+    {
+        mainLoop();
+    }
+    autoSave();
+}
+
+/**
+ * @brief Save the game in the background every m_autoSaveInterval ticks
+ *
+ * Only the serialization runs on the game thread; the file is written
+ * by CAutoSave.
+ */
+void CRuntime::autoSave()
+{
+    if (!m_autoSave || m_game->mode() != CGame::MODE_PLAY ||
+        !m_recorder->isStopped() || m_gameMenuActive)
+        return;
+    if (--m_autoSaveCountdown > 0)
+        return;
+    m_autoSaveCountdown = m_autoSaveInterval;
+    CFileMem tfile;
+    tfile.open("", "wb");
+    if (!write(tfile, AUTOSAVE_NAME))
+    {
+        LOGE("failed to serialize autosave");
+        return;
+    }
+    std::vector<uint8_t> data = tfile.buffer();
+    m_autoSave->submit(getSavePath(), std::move(data));
 }
 
 bool CRuntime::isMenuActive()
@@ -1112,6 +1151,19 @@ void CRuntime::openMusicForLevel(int i)
     openMusic(filename);
 }
 
+/**
+ * @brief Load the music of a level while the current one plays on
+ *
+ * @param i level index
+ */
+void CRuntime::preloadMusicForLevel(int i)
+{
+    if (!m_music || !m_musicEnabled || m_musicFiles.empty())
+        return;
+    const std::string music = getMusicPath(m_musicFiles[i % m_musicFiles.size()]);
+    m_music->preload(music.c_str());
+}
+
 void CRuntime::openMusic(const std::string &filename)
 {
     if (!m_quiet)
@@ -1557,6 +1609,25 @@ void CRuntime::initOptions()
     }
 
     m_trace = isTrue(m_config["trace"]);
+
+    const int autoSaveSeconds = strtol(m_config["autosave"].c_str(), nullptr, 10);
+    if (autoSaveSeconds > 0)
+    {
+        m_autoSave = std::make_unique<CAutoSave>();
+        m_autoSaveInterval = autoSaveSeconds * tickRate();
+        m_autoSaveCountdown = m_autoSaveInterval;
+        if (!m_quiet)
+            LOGI("autosave every %d seconds", autoSaveSeconds);
+    }
+
+    const int rewindSeconds = strtol(m_config["rewind_seconds"].c_str(), nullptr, 10);
+    if (rewindSeconds > 0)
+    {
+        const int rewindMemory = strtol(m_config["rewind_memory"].c_str(), nullptr, 10);
+        enableRewind(rewindSeconds, rewindMemory);
+        if (!m_quiet)
+            LOGI("rewind enabled: %d seconds", rewindSeconds);
+    }
 }
 
 /**
@@ -2733,29 +2804,17 @@ bool CRuntime::saveToFile(const std::string filepath, const std::string name)
 {
     if (!m_quiet)
         LOGI("writing: %s", filepath.c_str());
-    CFileWrap tfile;
-    if (tfile.open(filepath.c_str(), "wb"))
-    {
-        if (!write(tfile, name))
-        {
-            LOGE("failed to write file: %s", filepath.c_str());
-            return false;
-        }
-        tfile.close();
-#ifdef __EMSCRIPTEN__
-        EM_ASM(
-            FS.syncfs(function(err) {
-                // Error
-                err ? console.log(err) : null;
-            }));
-#endif
-    }
-    else
+    CFileMem tfile;
+    tfile.open("", "wb");
+    if (!write(tfile, name))
     {
-        LOGE("can't write: %s", filepath.c_str());
+        LOGE("failed to write file: %s", filepath.c_str());
         return false;
     }
-    return true;
+    // don't race an autosave to the same file
+    if (m_autoSave)
+        m_autoSave->flush();
+    return CAutoSave::writeFile(filepath, tfile.buffer());
 }
 
 bool CRuntime::loadFromFile(const std::string filepath, std::string &name)
@@ -29,6 +29,7 @@ class ISound;
 class CFrameSet;
 class CMenu;
 class CGameUI;
+class CAutoSave;
 typedef std::vector<std::string> StringVector;
 
 struct Rez
@@ -108,6 +109,7 @@ private:
     };
 
     static void cleanup();
+    void autoSave();
     void preloadAssets() override;
     bool initControllers();
     void initMusic();
@@ -116,6 +118,7 @@ private:
     bool loadScores() override;
     bool saveScores() override;
     void openMusicForLevel(int i) override;
+    void preloadMusicForLevel(int i) override;
     void setupTitleScreen() override;
     void takeScreenshot() override;
     void sanityTest() override {};
@@ -137,6 +140,9 @@ private:
     std::unique_ptr<CMenu> m_userMenu;
     std::unique_ptr<CMenu> m_skillMenu;
     std::unique_ptr<CFrameSet> m_titlePix;
+    std::unique_ptr<CAutoSave> m_autoSave;
+    int m_autoSaveInterval = 0; // ticks between autosaves
+    int m_autoSaveCountdown = 0;
     bool m_musicEnabled = false;
     App m_app;
     std::unordered_map<std::string, std::string> m_config;
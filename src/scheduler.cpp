@@ -0,0 +1,280 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include "scheduler.h"
+
+/**
+ * @brief Remove all actors from the scheduler
+ *
+ */
+void CScheduler::clear()
+{
+    m_slots.clear();
+    for (auto &bucket : m_buckets)
+        bucket.clear();
+    for (auto &cell : m_cells)
+        cell.clear();
+    m_queue.clear();
+    m_cursor = 0;
+    m_dormant = 0;
+    m_running = false;
+    m_dirty = false;
+}
+
+/**
+ * @brief Force a full rebuild before the next pass
+ *
+ */
+void CScheduler::invalidate()
+{
+    m_dirty = true;
+}
+
+/**
+ * @brief Check if the scheduler is in sync with the monster list
+ *
+ * @param count number of actors in the monster list
+ * @return true
+ * @return false
+ */
+bool CScheduler::isValid(const size_t count) const
+{
+    return !m_dirty && m_slots.size() == count;
+}
+
+/**
+ * @brief File an actor under a speed bucket or the dormant set
+ *
+ * Called whenever an actor is added, moves or changes tile. During a
+ * pass, an actor further down the list that becomes due is queued so
+ * that it is still visited on this tick.
+ *
+ * @param index actor index in the monster list
+ * @param bucket speed divisor of the actor's tile or DORMANT
+ * @param pos actor position
+ */
+void CScheduler::assign(const int index, const uint8_t bucket, const Pos &pos)
+{
+    if (index < 0)
+        return;
+    if (static_cast<size_t>(index) > m_slots.size())
+        // an actor was added behind our back
+        m_dirty = true;
+    if (static_cast<size_t>(index) >= m_slots.size())
+        m_slots.resize(index + 1, slot_t{UNASSIGNED, 0});
+
+    const slot_t slot{
+        bucket == DORMANT || bucket < SPEED_BUCKETS ? bucket : uint8_t{0},
+        toCell(pos),
+    };
+    slot_t &current = m_slots[index];
+    if (current.bucket == slot.bucket &&
+        (slot.bucket != DORMANT || current.cell == slot.cell))
+        return;
+
+    if (current.bucket != UNASSIGNED)
+    {
+        removeSorted(listFor(current), index);
+        if (current.bucket == DORMANT)
+            --m_dormant;
+    }
+    current = slot;
+    insertSorted(listFor(current), index);
+    if (current.bucket == DORMANT)
+        ++m_dormant;
+
+    if (!m_running)
+        return;
+    const int last = m_cursor ? m_queue[m_cursor - 1] : NONE;
+    const bool wanted = slot.bucket == DORMANT ? isNear(slot.cell) : isDue(slot.bucket);
+    if (index > last && wanted)
+    {
+        auto it = std::lower_bound(m_queue.begin() + m_cursor, m_queue.end(), index);
+        if (it == m_queue.end() || *it != index)
+            m_queue.insert(it, index);
+    }
+}
+
+/**
+ * @brief Remove a single actor and shift the following indices
+ *
+ * @param index
+ */
+void CScheduler::erase(const int index)
+{
+    const int indices[] = {index};
+    erase(indices);
+}
+
+/**
+ * @brief Prepare the list of actors to visit on this tick
+ *
+ * @param ticks current tick
+ * @param origin player position; dormant actors around it are candidates
+ */
+void CScheduler::begin(const int ticks, const Pos &origin)
+{
+    m_ticks = ticks;
+    m_minCellX = std::max(origin.x - MAX_WAKE_DISTANCE, 0) >> CELL_SHIFT;
+    m_maxCellX = std::min(origin.x + MAX_WAKE_DISTANCE, GRID_SIZE - 1) >> CELL_SHIFT;
+    m_minCellY = std::max(origin.y - MAX_WAKE_DISTANCE, 0) >> CELL_SHIFT;
+    m_maxCellY = std::min(origin.y + MAX_WAKE_DISTANCE, GRID_SIZE - 1) >> CELL_SHIFT;
+
+    m_queue.clear();
+    for (uint8_t i = 0; i < SPEED_BUCKETS; ++i)
+    {
+        if (isDue(i))
+            m_queue.insert(m_queue.end(), m_buckets[i].begin(), m_buckets[i].end());
+    }
+    if (m_dormant)
+    {
+        for (int y = m_minCellY; y <= m_maxCellY; ++y)
+        {
+            for (int x = m_minCellX; x <= m_maxCellX; ++x)
+            {
+                const auto &cell = m_cells[x + y * CELL_GRID];
+                m_queue.insert(m_queue.end(), cell.begin(), cell.end());
+            }
+        }
+    }
+    std::sort(m_queue.begin(), m_queue.end());
+    m_cursor = 0;
+    m_running = true;
+}
+
+/**
+ * @brief Next actor to visit, in ascending index order
+ *
+ * @return int actor index or NONE when the pass is complete
+ */
+int CScheduler::next()
+{
+    return m_cursor < m_queue.size() ? m_queue[m_cursor++] : NONE;
+}
+
+/**
+ * @brief Close the current pass
+ *
+ */
+void CScheduler::end()
+{
+    m_running = false;
+}
+
+size_t CScheduler::size() const
+{
+    return m_slots.size();
+}
+
+size_t CScheduler::dormantCount() const
+{
+    return m_dormant;
+}
+
+/**
+ * @brief Number of candidates handed out by the last pass
+ *
+ * @return size_t
+ */
+size_t CScheduler::visitCount() const
+{
+    return m_queue.size();
+}
+
+bool CScheduler::isDue(const uint8_t bucket) const
+{
+    return bucket == 0 || (m_ticks % bucket) == 0;
+}
+
+bool CScheduler::isNear(const uint8_t cell) const
+{
+    const int x = cell % CELL_GRID;
+    const int y = cell / CELL_GRID;
+    return x >= m_minCellX && x <= m_maxCellX &&
+           y >= m_minCellY && y <= m_maxCellY;
+}
+
+std::vector<int> &CScheduler::listFor(const slot_t &slot)
+{
+    return slot.bucket == DORMANT ? m_cells[slot.cell] : m_buckets[slot.bucket];
+}
+
+/**
+ * @brief Drop the actors marked for deletion and renumber the others
+ *
+ */
+void CScheduler::compact()
+{
+    std::vector<int> &remap = m_remap;
+    remap.assign(m_slots.size(), NONE);
+    size_t j = 0;
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        if (m_slots[i].bucket == UNASSIGNED)
+            continue;
+        remap[i] = j;
+        m_slots[j++] = m_slots[i];
+    }
+    m_slots.resize(j);
+
+    auto renumber = [&remap](std::vector<int> &list)
+    {
+        size_t k = 0;
+        for (const int i : list)
+        {
+            if (remap[i] != NONE)
+                list[k++] = remap[i];
+        }
+        list.resize(k);
+    };
+
+    for (auto &bucket : m_buckets)
+        renumber(bucket);
+    m_dormant = 0;
+    for (auto &cell : m_cells)
+    {
+        renumber(cell);
+        m_dormant += cell.size();
+    }
+    if (m_running)
+    {
+        const std::vector<int> visited(m_queue.begin(), m_queue.begin() + m_cursor);
+        renumber(m_queue);
+        m_cursor = std::count_if(visited.begin(), visited.end(), [&remap](int i)
+                                 { return remap[i] != NONE; });
+    }
+}
+
+uint8_t CScheduler::toCell(const Pos &pos)
+{
+    return (pos.x >> CELL_SHIFT) + (pos.y >> CELL_SHIFT) * CELL_GRID;
+}
+
+void CScheduler::insertSorted(std::vector<int> &list, const int index)
+{
+    auto it = std::lower_bound(list.begin(), list.end(), index);
+    if (it == list.end() || *it != index)
+        list.insert(it, index);
+}
+
+void CScheduler::removeSorted(std::vector<int> &list, const int index)
+{
+    auto it = std::lower_bound(list.begin(), list.end(), index);
+    if (it != list.end() && *it == index)
+        list.erase(it);
+}
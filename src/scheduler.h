@@ -0,0 +1,105 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "map.h"
+
+/**
+ * @brief Sleep/wake scheduler for the monster list
+ *
+ * Actors are filed under the speed divisor of their tile (bucket) or,
+ * when they sit on an ATTR_IDLE tile, into a dormant set indexed by
+ * coarse map cells. Each tick only the buckets due on that tick and the
+ * dormant cells surrounding the player are visited.
+ *
+ * The scheduler only narrows down the candidates: the caller still applies
+ * the idle and speed rules to every index it receives. Indices are handed
+ * out in ascending order so that actors are processed in the same order
+ * as a plain scan of the monster list.
+ */
+class CScheduler
+{
+public:
+    enum : uint8_t
+    {
+        SPEED_BUCKETS = 9,
+        UNASSIGNED = 0xfe,
+        DORMANT = 0xff,
+    };
+
+    enum : int
+    {
+        NONE = -1,
+        GRID_SIZE = 256,
+        CELL_SHIFT = 4,
+        CELL_GRID = GRID_SIZE >> CELL_SHIFT,
+        MAX_WAKE_DISTANCE = 10,
+    };
+
+    void clear();
+    void invalidate();
+    bool isValid(const size_t count) const;
+    void assign(const int index, const uint8_t bucket, const Pos &pos);
+    void erase(const int index);
+    template <typename T>
+    void erase(const T &indices)
+    {
+        for (const auto &i : indices)
+            if (i >= 0 && i < static_cast<int>(m_slots.size()))
+                m_slots[i].bucket = UNASSIGNED;
+        compact();
+    }
+    void begin(const int ticks, const Pos &origin);
+    int next();
+    void end();
+    size_t size() const;
+    size_t dormantCount() const;
+    size_t visitCount() const;
+
+private:
+    struct slot_t
+    {
+        uint8_t bucket;
+        uint8_t cell;
+    };
+
+    std::vector<slot_t> m_slots;
+    std::vector<int> m_buckets[SPEED_BUCKETS];
+    std::vector<int> m_cells[CELL_GRID * CELL_GRID];
+    std::vector<int> m_queue;
+    std::vector<int> m_remap;
+    size_t m_cursor = 0;
+    size_t m_dormant = 0;
+    int m_ticks = 0;
+    uint8_t m_minCellX = 0;
+    uint8_t m_maxCellX = 0;
+    uint8_t m_minCellY = 0;
+    uint8_t m_maxCellY = 0;
+    bool m_running = false;
+    bool m_dirty = true;
+
+    bool isDue(const uint8_t bucket) const;
+    bool isNear(const uint8_t cell) const;
+    std::vector<int> &listFor(const slot_t &slot);
+    void compact();
+    static uint8_t toCell(const Pos &pos);
+    static void insertSorted(std::vector<int> &list, const int index);
+    static void removeSorted(std::vector<int> &list, const int index);
+};
@@ -64,6 +64,8 @@ CMusicSDL::CMusicSDL()
 CMusicSDL::~CMusicSDL()
 {
     close();
+    if (m_next)
+        Mix_FreeMusic(m_next);
 }
 
 #ifdef __EMSCRIPTEN__
@@ -85,7 +87,17 @@ bool CMusicSDL::open(const char *file)
         return true;
     }
 #endif
-    m_data.mixData = Mix_LoadMUS(file);
+    if (m_next && m_nextFile == file)
+    {
+        // already loaded by preload()
+        m_data.mixData = m_next;
+        m_next = nullptr;
+        m_nextFile.clear();
+    }
+    else
+    {
+        m_data.mixData = Mix_LoadMUS(file);
+    }
     if (m_data.mixData)
     {
         m_type = TYPE_PRELOAD;
@@ -99,6 +111,36 @@ bool CMusicSDL::open(const char *file)
     return valid;
 }
 
+/**
+ * @brief Load a music ahead of the open() call that plays it
+ *
+ * The current music keeps playing. Only the last music preloaded is kept.
+ *
+ * @param file
+ * @return true
+ * @return false
+ */
+bool CMusicSDL::preload(const char *file)
+{
+#if defined(__EMSCRIPTEN__)
+    if (!endswith(file, ".xm"))
+        return true; // streamed
+#endif
+    if (m_next && m_nextFile == file)
+        return true;
+    if (m_next)
+        Mix_FreeMusic(m_next);
+    m_next = Mix_LoadMUS(file);
+    if (!m_next)
+    {
+        m_nextFile.clear();
+        LOGE("Failed to load music `%s` : %s", file, SDL_GetError());
+        return false;
+    }
+    m_nextFile = file;
+    return true;
+}
+
 #ifdef __EMSCRIPTEN__
 EMSCRIPTEN_KEEPALIVE
 #endif
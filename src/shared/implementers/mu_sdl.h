@@ -32,6 +32,7 @@ public:
     CMusicSDL();
     ~CMusicSDL() override;
     bool open(const char *file) override;
+    bool preload(const char *file) override;
     bool play(int loop = -1) override;
     void stop() override;
     void close() override;
@@ -55,7 +56,9 @@ protected:
         Mix_Music *mixData;
     } MusicData;
 
-    MusicData m_data; // Background Music
+    MusicData m_data;            // Background Music
+    Mix_Music *m_next = nullptr; // loaded ahead by preload()
+    std::string m_nextFile;
     uint8_t m_type = TYPE_NONE;
     bool m_playing = false;
 #if defined(EMSCRIPTEN)
@@ -22,6 +22,7 @@ class IMusic
 public:
     virtual ~IMusic() = 0;
     virtual bool open(const char *file) = 0;
+    virtual bool preload(const char *file) = 0;
     virtual bool play(int loop = -1) = 0;
     virtual void stop() = 0;
     virtual void close() = 0;
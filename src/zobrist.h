@@ -0,0 +1,57 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Zobrist-style keys for the game state hash
+ *
+ * Each (kind, slot, value) triple maps to a pseudo-random 64-bit key and a
+ * state is the XOR of the keys of its parts. Changing a part costs two
+ * XORs: the key of the old value out, the key of the new value in. Keys are
+ * derived on the fly instead of read from tables; a value of 0 has a key
+ * of 0 so that empty tiles and cleared fields cost nothing.
+ */
+namespace Zobrist
+{
+    enum Kind : uint8_t
+    {
+        TILE,
+        ATTR,
+        GAME,
+        STAT,
+        KEY,
+        PLAYER,
+        ACTOR,
+        BOSS,
+        RNG,
+    };
+
+    inline uint64_t key(const Kind kind, const uint32_t slot, const uint32_t value)
+    {
+        if (value == 0)
+            return 0;
+        // splitmix64 finalizer
+        uint64_t z = (static_cast<uint64_t>(kind) << 56) ^ (static_cast<uint64_t>(slot) << 32) ^ value;
+        z += 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+};
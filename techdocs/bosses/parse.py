@@ -47,7 +47,9 @@ namespace BossData
         ASTAR,
         BFS,
         LOS,
-        ASTAR_SMOOTH
+        ASTAR_SMOOTH,
+        JPS,
+        FIELD
     };
 
     enum HitBoxType:uint8_t {
@@ -127,6 +129,7 @@ CPP_INLINE_BODY = """
 
 extern const bossData_t g_bossData[];
 extern const sprite_hitbox_t g_hitboxes[];
+extern const int16_t g_hitboxIndex[HITBOX_SHEETS][HITBOX_FRAMES];
 
 inline constexpr const bossData_t *getBossData(const uint8_t type)
 {
@@ -140,13 +143,10 @@ inline constexpr const bossData_t *getBossData(const uint8_t type)
 
 inline constexpr const sprite_hitbox_t *getHitboxes(const int sheet, const int frameID)
 {
-    const int spriteID = sheet * SHEET_SPACER + frameID;
-    for (size_t i = 0; i < HITBOX_COUNT; ++i)
-    {
-        if (g_hitboxes[i].spriteID == spriteID)
-            return &g_hitboxes[i];
-    }
-    return nullptr;
+    if (sheet < 0 || sheet >= HITBOX_SHEETS || frameID < 0 || frameID >= HITBOX_FRAMES)
+        return nullptr;
+    const int i = g_hitboxIndex[sheet][frameID];
+    return i != NO_HITBOX ? &g_hitboxes[i] : nullptr;
 }
 
 """.strip()
@@ -232,6 +232,10 @@ def sanity_check(seq):
     if invalid_fields:
         print(f"invalid fields: {invalid_fields} for `{seq['name']}`")
         result = False
+    for k in path_fields:
+        if k in seq and seq[k] not in [f"Path::{x}" for x in path_names]:
+            print(f"invalid path algo: {seq[k]} for `{seq['name']}`")
+            result = False
     return result
 
 
@@ -300,6 +304,16 @@ def write_cpp(file_path):
             tfile.write(f"{TAB}{frame},\n")
         tfile.write(f"}};\n\n")
 
+        # direct lookup: [sheet][frame] => g_hitboxes index
+        sheets, frames = hitbox_index_size()
+        index = [["NO_HITBOX"] * frames for _ in range(sheets)]
+        for i, frame_id in enumerate(all_frames.keys()):
+            index[frame_id // SHEET_SPACER][frame_id % SHEET_SPACER] = str(i)
+        tfile.write("constexpr const int16_t g_hitboxIndex[HITBOX_SHEETS][HITBOX_FRAMES] = {\n")
+        for row in index:
+            tfile.write(f"{TAB}{{{', '.join(row)}}},\n")
+        tfile.write(f"}};\n\n")
+
         tfile.write("constexpr const bossData_t g_bossData[] = {\n")
         for seq in all_seqs:
             tfile.write(f"{TAB}{{\n")
@@ -335,6 +349,12 @@ def write_header(file_path: str):
         tfile.write(CPP_INLINE_BODY)
 
 
+def hitbox_index_size():
+    sheets = max([k // SHEET_SPACER for k in all_frames.keys()], default=-1) + 1
+    frames = max([k % SHEET_SPACER for k in all_frames.keys()], default=-1) + 1
+    return max(sheets, 1), max(frames, 1)
+
+
 def prepare_defines():
     for seq in all_seqs:
         if not sanity_check(seq):
@@ -347,6 +367,10 @@ def prepare_defines():
     boss_types.append(f"#define HITBOX_COUNT  {len(all_frames)}")
     boss_types.append(f"#define SHEET_SPACER  {SHEET_SPACER}")
     boss_types.append(f"#define MAX_HITBOX_PER_FRAME {MAX_HITBOX_PER_FRAME}")
+    sheets, frames = hitbox_index_size()
+    boss_types.append(f"#define HITBOX_SHEETS {sheets}")
+    boss_types.append(f"#define HITBOX_FRAMES {frames}")
+    boss_types.append(f"#define NO_HITBOX -1")
 
 
 attr_names = [
@@ -376,6 +400,8 @@ attr_names = [
     "color_name",
     "aims",
 ]
+path_names = ["NONE", "ASTAR", "BFS", "LOS", "ASTAR_SMOOTH", "JPS", "FIELD"]
+path_fields = ["path", "bullet_algo"]
 seq_names = ["moving", "attack", "hurt", "death", "idle"]
 misc_names = ["hitbox", "sheet"]
 composite_fields = ["bullet", "distance", "speed", "color", "damage"]
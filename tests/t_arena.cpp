@@ -0,0 +1,129 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <memory_resource>
+#include "t_arena.h"
+#include "../src/arena.h"
+#include "../src/game.h"
+#include "../src/maparch.h"
+#include "../src/logger.h"
+
+// count heap allocations while g_countAllocs is set
+static bool g_countAllocs = false;
+static size_t g_allocs = 0;
+
+void *operator new(size_t size)
+{
+    if (g_countAllocs)
+        ++g_allocs;
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+bool test_arena()
+{
+    CArena arena(64);
+    auto fill = [&arena]()
+    {
+        std::pmr::vector<int> v(arena.resource());
+        for (int i = 0; i < 100; ++i)
+            v.emplace_back(i);
+        return v.size() == 100;
+    };
+
+    if (!fill())
+    {
+        LOGE("arena vector is corrupted");
+        return false;
+    }
+    if (arena.overflowCount() == 0)
+    {
+        LOGE("expected the first pass to spill over");
+        return false;
+    }
+
+    // the buffer grows on reset; the same workload now fits
+    arena.reset();
+    const size_t overflows = arena.overflowCount();
+    for (int i = 0; i < 10; ++i)
+    {
+        fill();
+        arena.reset();
+    }
+    if (arena.overflowCount() != overflows)
+    {
+        LOGE("arena still spills over after growing: %zu", arena.overflowCount() - overflows);
+        return false;
+    }
+    return true;
+}
+
+bool test_arena_tick()
+{
+    constexpr const char *IN_FILE = "tests/in/levels1.mapz";
+    enum
+    {
+        LEVEL = 3,
+        WARMUP_TICKS = 200,
+        TICKS = 1000,
+    };
+
+    CMapArch arch;
+    if (!arch.read(IN_FILE))
+    {
+        LOGE("can't read %s", IN_FILE);
+        return false;
+    }
+    CGame &game = *CGame::getGame();
+    game.setMapArch(&arch);
+    game.setLevel(LEVEL);
+    game.loadLevel(CGame::MODE_PLAY);
+
+    size_t allocs = 0;
+    for (int ticks = 1; ticks <= WARMUP_TICKS + TICKS; ++ticks)
+    {
+        g_allocs = 0;
+        g_countAllocs = ticks > WARMUP_TICKS;
+        game.manageMonsters(ticks);
+        game.manageBosses(ticks);
+        g_countAllocs = false;
+        allocs += g_allocs;
+    }
+    game.setMapArch(nullptr);
+
+    if (allocs != 0)
+    {
+        LOGE("%zu heap allocations in %d steady state ticks", allocs, TICKS);
+        return false;
+    }
+    return true;
+}
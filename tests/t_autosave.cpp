@@ -0,0 +1,79 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <filesystem>
+#include <vector>
+#include "../src/autosave.h"
+#include "../src/shared/FileWrap.h"
+#include "../src/logger.h"
+#include "thelper.h"
+#include "t_autosave.h"
+
+bool test_autosave()
+{
+    constexpr const char *OUT_FILE = "tests/out/autosave.dat";
+    enum
+    {
+        SAVES = 8,
+    };
+
+    std::filesystem::remove(OUT_FILE);
+    std::vector<uint8_t> last;
+    {
+        CAutoSave autoSave;
+        for (int i = 1; i <= SAVES; ++i)
+        {
+            std::vector<uint8_t> data(i * 1000, static_cast<uint8_t>(i));
+            last = data;
+            autoSave.submit(OUT_FILE, std::move(data));
+        }
+        autoSave.flush();
+        if (autoSave.writeCount() == 0 || autoSave.writeCount() > SAVES)
+        {
+            LOGE("unexpected write count: %zu", autoSave.writeCount());
+            return false;
+        }
+    }
+
+    // only the latest save is kept, and no temporary file is left behind
+    CFileWrap sfile;
+    std::vector<uint8_t> data(last.size());
+    if (getFileSize(OUT_FILE) != last.size() ||
+        !sfile.open(OUT_FILE, "rb") ||
+        sfile.read(data.data(), data.size()) != IFILE_OK ||
+        data != last)
+    {
+        LOGE("%s doesn't hold the last save", OUT_FILE);
+        return false;
+    }
+    sfile.close();
+    if (std::filesystem::exists(std::string(OUT_FILE) + ".tmp"))
+    {
+        LOGE("temporary file left behind");
+        return false;
+    }
+
+    if (CAutoSave::writeFile("tests/out/missing/autosave.dat", last))
+    {
+        LOGE("write to a missing directory should fail");
+        return false;
+    }
+
+    // clean up
+    std::filesystem::remove(OUT_FILE);
+    return true;
+}
@@ -0,0 +1,236 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <vector>
+#include "t_boss.h"
+#include "../src/boss.h"
+#include "../src/bossdata.h"
+#include "../src/map.h"
+#include "../src/game.h"
+#include "../src/clearance.h"
+#include "../src/tilesdata.h"
+#include "../src/logger.h"
+
+// every map tile overlapping each hitbox rectangle, scanned one tile at a time
+static std::vector<HitResult> scanHitboxes(const CBoss &boss, const CMap &map)
+{
+    const bossData_t *data = boss.data();
+    std::vector<hitbox_t> rects{{boss.x(), boss.y(), data->hitbox.width, data->hitbox.height, BossData::MAIN}};
+    if (const sprite_hitbox_t *frame = getHitboxes(data->sheet, boss.currentFrame()))
+    {
+        for (int i = 0; i < frame->count; ++i)
+        {
+            const hitbox_t &c = frame->hitboxes[i];
+            rects.push_back({boss.x() + c.x - data->hitbox.x, boss.y() + c.y - data->hitbox.y, c.width, c.height, c.type});
+        }
+    }
+
+    // as in the game, half-tile h lies on tile h / 2 rounded toward zero,
+    // so the half-tile just left of (or above) the map still lands on tile 0
+    auto covers = [](const int start, const int size, const int tile)
+    {
+        for (int h = start; h < start + size; ++h)
+            if (h / CBoss::BOSS_GRANULAR_FACTOR == tile)
+                return true;
+        return false;
+    };
+    std::vector<HitResult> tiles;
+    for (const hitbox_t &hb : rects)
+    {
+        for (int y = 0; y < map.hei(); ++y)
+        {
+            for (int x = 0; x < map.len(); ++x)
+            {
+                if (covers(hb.x, hb.width, x) && covers(hb.y, hb.height, y))
+                    tiles.emplace_back(HitResult{Pos{static_cast<int16_t>(x), static_cast<int16_t>(y)},
+                                                 static_cast<BossData::HitBoxType>(hb.type)});
+            }
+        }
+    }
+    return tiles;
+}
+
+bool test_boss_hitboxes()
+{
+    // direct lookup table must agree with the hitbox list
+    for (size_t i = 0; i < HITBOX_COUNT; ++i)
+    {
+        const sprite_hitbox_t &entry = g_hitboxes[i];
+        const int sheet = entry.spriteID / SHEET_SPACER;
+        const int frame = entry.spriteID % SHEET_SPACER;
+        if (getHitboxes(sheet, frame) != &entry)
+        {
+            LOGE("lookup failed for sprite %d", entry.spriteID);
+            return false;
+        }
+    }
+    if (getHitboxes(-1, 0) || getHitboxes(0, -1) ||
+        getHitboxes(HITBOX_SHEETS, 0) || getHitboxes(0, HITBOX_FRAMES))
+    {
+        LOGE("out of range lookup should fail");
+        return false;
+    }
+
+    // visitor and legacy query must report the tiles of a plain scan, in order,
+    // for every animation frame
+    CMap map(16, 16);
+    size_t framesWithHitboxes = 0;
+    for (size_t i = 0; i < BOSS_COUNT; ++i)
+    {
+        const bossData_t *data = &g_bossData[i];
+        for (const Pos pos : {Pos{0, 0}, Pos{7, 9}, Pos{28, 28}})
+        {
+            for (const CBoss::BossState state : {CBoss::Patrol, CBoss::Chase, CBoss::Attack, CBoss::Hurt, CBoss::Death})
+            {
+                for (int aim = 0; aim < data->aims; ++aim)
+                {
+                    CBoss boss(pos.x, pos.y, data);
+                    boss.setAim(static_cast<JoyAim>(aim));
+                    boss.setState(state);
+                    for (int frame = 0; frame < 8 && boss.state() == state; ++frame)
+                    {
+                        const auto expected = scanHitboxes(boss, map);
+                        framesWithHitboxes += getHitboxes(data->sheet, boss.currentFrame()) != nullptr;
+                        std::vector<HitResult> visited;
+                        boss.visitHitbox(map, [&visited](const HitResult &r)
+                                         { visited.emplace_back(r); });
+                        const auto results = boss.testHitbox1(map, nullptr, nullptr);
+                        if (visited.size() != expected.size() || results.size() != expected.size())
+                        {
+                            LOGE("%s frame %d: visited %zu tiles, listed %zu, expected %zu",
+                                 data->name, boss.currentFrame(), visited.size(), results.size(), expected.size());
+                            return false;
+                        }
+                        for (size_t j = 0; j < expected.size(); ++j)
+                        {
+                            if (visited[j].pos != expected[j].pos || visited[j].type != expected[j].type ||
+                                results[j].pos != expected[j].pos || results[j].type != expected[j].type)
+                            {
+                                LOGE("%s frame %d: tile %zu mismatch", data->name, boss.currentFrame(), j);
+                                return false;
+                            }
+                        }
+                        boss.animate();
+                    }
+                }
+            }
+        }
+    }
+    if (framesWithHitboxes == 0)
+    {
+        LOGE("no frame with secondary hitboxes was checked");
+        return false;
+    }
+    return true;
+}
+
+// strip test done one tile at a time, as canMoveFrom used to
+static bool canMoveSlow(const CBoss &boss, const Pos &from, const JoyAim aim)
+{
+    const CMap &map = CGame::getMap();
+    const int gf = CBoss::BOSS_GRANULAR_FACTOR;
+    const hitbox_t &hb = boss.hitbox();
+    const int x = from.x / gf;
+    const int y = from.y / gf;
+    const int w = hb.width / gf;
+    const int h = hb.height / gf;
+    const Pos next{static_cast<int16_t>(from.x + (aim == AIM_RIGHT) - (aim == AIM_LEFT)),
+                   static_cast<int16_t>(from.y + (aim == AIM_DOWN) - (aim == AIM_UP))};
+    if (next.x / gf == x && next.y / gf == y &&
+        next.x >= 0 && next.x + hb.width <= map.len() * gf &&
+        next.y >= 0 && next.y + hb.height <= map.hei() * gf)
+        return true;
+    // only the bound in the direction of travel is enforced
+    if ((aim == AIM_UP && next.y < 0) || (aim == AIM_LEFT && next.x < 0) ||
+        (aim == AIM_DOWN && next.y + hb.height > map.hei() * gf) ||
+        (aim == AIM_RIGHT && next.x + hb.width > map.len() * gf))
+        return false;
+    const bool across = aim == AIM_UP || aim == AIM_DOWN;
+    for (int i = 0; i < (across ? w : h); ++i)
+    {
+        const int tx = aim == AIM_LEFT ? x - 1 : aim == AIM_RIGHT ? x + w : x + i;
+        const int ty = aim == AIM_UP ? y - 1 : aim == AIM_DOWN ? y + h : y + i;
+        if (across ? tx >= map.len() : ty >= map.hei())
+            continue;
+        const Pos pos{static_cast<int16_t>(tx), static_cast<int16_t>(ty)};
+        if (boss.type() == BOSS_GHOST ? boss.isGhostBlocked(pos) : boss.isSolid(pos))
+            return false;
+    }
+    return true;
+}
+
+bool test_boss_clearance()
+{
+    CMap &map = CGame::getMap();
+    map.resize(24, 20, TILES_BLANK, true);
+    map.fill(TILES_BLANK);
+    uint32_t seed = 4321;
+    auto rand = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) & 0x7fff;
+    };
+    const uint8_t tiles[] = {TILES_BLANK, TILES_BLANK, TILES_BLANK, TILES_WALLS93, TILES_WALLS93_3, TILES_SWAMP};
+    auto scatter = [&](const int count)
+    {
+        for (int i = 0; i < count; ++i)
+            map.set(rand() % map.len(), rand() % map.hei(), tiles[rand() % sizeof(tiles)]);
+    };
+    auto compare = [&map](const char *step)
+    {
+        for (size_t i = 0; i < BOSS_COUNT; ++i)
+        {
+            const CBoss boss(0, 0, &g_bossData[i]);
+            for (int y = 0; y < map.hei() * CBoss::BOSS_GRANULAR_FACTOR; ++y)
+            {
+                for (int x = 0; x < map.len() * CBoss::BOSS_GRANULAR_FACTOR; ++x)
+                {
+                    const Pos pos{static_cast<int16_t>(x), static_cast<int16_t>(y)};
+                    for (const JoyAim aim : {AIM_UP, AIM_DOWN, AIM_LEFT, AIM_RIGHT})
+                    {
+                        if (boss.canMoveFrom(pos, aim) != canMoveSlow(boss, pos, aim))
+                        {
+                            LOGE("%s: %s disagrees at (%d, %d) aim %d", step, boss.name(), x, y, aim);
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    };
+
+    scatter(120);
+    if (!compare("build"))
+        return false;
+
+    // tiles changed one at a time patch the tables in place
+    const size_t builds = CClearance::buildCount();
+    for (int round = 0; round < 10; ++round)
+    {
+        scatter(8);
+        if (!compare("update"))
+            return false;
+    }
+    if (CClearance::buildCount() != builds)
+    {
+        LOGE("clearance rebuilt %zu times for single tile changes", CClearance::buildCount() - builds);
+        return false;
+    }
+    map.clear();
+    return true;
+}
@@ -17,17 +17,632 @@
 */
 
 #include <cstring>
+#include <filesystem>
+#include <memory>
+#include <thread>
 #include "../src/shared/FileWrap.h"
+#include "../src/shared/FileMem.h"
 #include "../src/shared/helper.h"
 #include "../src/logger.h"
 #include "../src/gamemixin.h"
 #include "../src/skills.h"
 #include "../src/runtime.h"
 #include "../src/game.h"
+#include "../src/maparch.h"
+#include "../src/prefetch.h"
+#include "../src/boss.h"
+#include "../src/headless.h"
+#include "../src/recorder.h"
+#include "../src/tilesdata.h"
 #include "thelper.h"
 #include "t_runtime.h"
 
 bool test_game()
 {
     return true;
-}
\ No newline at end of file
+}
+static void playLevel(CGame &game, CMapArch &arch, const int level)
+{
+    game.setMapArch(&arch);
+    game.setLevel(level);
+    game.loadLevel(CGame::MODE_PLAY);
+}
+
+static uint32_t fingerprint(CGame &game)
+{
+    const CGame::Scope scope(game);
+    const CMap &map = CGame::getMap();
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const int value)
+    {
+        hash = (hash ^ static_cast<uint32_t>(value)) * 16777619u;
+    };
+    for (int y = 0; y < map.hei(); ++y)
+        for (int x = 0; x < map.len(); ++x)
+            mix(map.at(x, y));
+    for (const auto &actor : game.getMonsters())
+    {
+        mix(actor.x());
+        mix(actor.y());
+    }
+    for (const auto &boss : game.bosses())
+    {
+        mix(boss.x());
+        mix(boss.y());
+    }
+    mix(game.health());
+    return hash;
+}
+
+bool test_game_instances()
+{
+    constexpr const char *IN_FILE = "tests/in/levels1.mapz";
+    constexpr int LEVELS[] = {8, 10};
+    enum
+    {
+        TICKS = 600,
+    };
+
+    CMapArch arch;
+    if (!arch.read(IN_FILE))
+    {
+        LOGE("can't read %s", IN_FILE);
+        return false;
+    }
+
+    // one game after the other
+    auto run = [&arch](const int level)
+    {
+        auto game = std::make_unique<CGame>();
+        playLevel(*game, arch, level);
+        for (int ticks = 1; ticks <= TICKS; ++ticks)
+        {
+            game->manageMonsters(ticks);
+            game->manageBosses(ticks);
+        }
+        return fingerprint(*game);
+    };
+    uint32_t expected[2];
+    for (int i = 0; i < 2; ++i)
+        expected[i] = run(LEVELS[i]);
+
+    // both games on their own thread
+    uint32_t threaded[2];
+    std::thread workers[2];
+    for (int i = 0; i < 2; ++i)
+        workers[i] = std::thread([&run, &threaded, &LEVELS, i]
+                                 { threaded[i] = run(LEVELS[i]); });
+    for (auto &worker : workers)
+        worker.join();
+
+    // both games on this thread, one tick each in turn
+    std::unique_ptr<CGame> games[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        games[i] = std::make_unique<CGame>();
+        playLevel(*games[i], arch, LEVELS[i]);
+    }
+    for (int ticks = 1; ticks <= TICKS; ++ticks)
+    {
+        for (auto &game : games)
+        {
+            game->manageMonsters(ticks);
+            game->manageBosses(ticks);
+        }
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (threaded[i] != expected[i] || fingerprint(*games[i]) != expected[i])
+        {
+            LOGE("level %d: 0x%.8x alone, 0x%.8x on a thread, 0x%.8x interleaved",
+                 LEVELS[i], expected[i], threaded[i], fingerprint(*games[i]));
+            return false;
+        }
+    }
+    if (expected[0] == expected[1])
+    {
+        LOGE("both levels ended the same");
+        return false;
+    }
+    return true;
+}
+
+bool test_game_savegame()
+{
+    constexpr const char *IN_FILE = "tests/in/levels1.mapz";
+    constexpr int LEVEL = 8;
+    enum
+    {
+        TICKS = 300,
+    };
+
+    CMapArch arch;
+    if (!arch.read(IN_FILE))
+    {
+        LOGE("can't read %s", IN_FILE);
+        return false;
+    }
+
+    CGame game;
+    playLevel(game, arch, LEVEL);
+    CFileMem tfile;
+    {
+        const CGame::Scope scope(game);
+        for (int ticks = 1; ticks <= TICKS; ++ticks)
+            game.manageMonsters(ticks);
+        CGame::getMap().set(1, 1, TILES_WALLS93);
+        CGame::getMap().setAttr(2, 1, 0x42);
+        tfile.open("", "wb");
+        if (!game.write(tfile))
+        {
+            LOGE("failed to write savegame");
+            return false;
+        }
+    }
+
+    // the save holds changes to the level, not the level itself
+    CFileMem mfile;
+    mfile.open("", "wb");
+    arch.at(LEVEL)->write(mfile);
+    if (tfile.buffer().size() >= mfile.buffer().size() / 4)
+    {
+        LOGE("savegame is %zu bytes; the level alone is %zu",
+             tfile.buffer().size(), mfile.buffer().size());
+        return false;
+    }
+
+    CGame loaded;
+    loaded.setMapArch(&arch);
+    CFileMem sfile;
+    sfile.replace(tfile.buffer().data(), tfile.buffer().size());
+    if (!loaded.read(sfile))
+    {
+        LOGE("failed to read savegame");
+        return false;
+    }
+    if (fingerprint(loaded) != fingerprint(game))
+    {
+        LOGE("loaded game differs from the saved one");
+        return false;
+    }
+
+    // sizes that do not fit the file are rejected before anything is inflated
+    constexpr size_t SIZE_OFFSET = 12;
+    std::vector<uint8_t> bad(tfile.buffer().begin(), tfile.buffer().end());
+    bad.resize(bad.size() - 1);
+    sfile.replace(bad.data(), bad.size());
+    if (loaded.read(sfile))
+    {
+        LOGE("truncated savegame was read");
+        return false;
+    }
+    bad.assign(tfile.buffer().begin(), tfile.buffer().end());
+    const uint32_t huge = 0xffffffff;
+    memcpy(bad.data() + SIZE_OFFSET, &huge, sizeof(huge));
+    sfile.replace(bad.data(), bad.size());
+    if (loaded.read(sfile))
+    {
+        LOGE("savegame with an oversized body was read");
+        return false;
+    }
+
+    // the delta only applies to the level it was made from
+    CMap *level = arch.at(LEVEL);
+    level->set(0, 0, level->at(0, 0) == TILES_WALLS93 ? TILES_BLANK : TILES_WALLS93);
+    sfile.replace(tfile.buffer().data(), tfile.buffer().size());
+    if (loaded.read(sfile))
+    {
+        LOGE("savegame was applied to a changed level");
+        return false;
+    }
+    return true;
+}
+
+bool test_game_restart()
+{
+    constexpr const char *IN_FILE = "tests/in/levels1.mapz";
+    constexpr int LEVELS[] = {8, 10, 8};
+    enum
+    {
+        TICKS = 300,
+    };
+
+    CMapArch arch;
+    if (!arch.read(IN_FILE))
+    {
+        LOGE("can't read %s", IN_FILE);
+        return false;
+    }
+
+    // the level as a game that never loaded another one sees it
+    auto fresh = [&arch](const int level)
+    {
+        CGame game;
+        playLevel(game, arch, level);
+        return fingerprint(game);
+    };
+
+    // one game going back and forth between levels, played in between
+    CGame game;
+    for (const int level : LEVELS)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            playLevel(game, arch, level);
+            if (fingerprint(game) != fresh(level))
+            {
+                LOGE("level %d differs once reloaded", level);
+                return false;
+            }
+            const CGame::Scope scope(game);
+            for (int ticks = 1; ticks <= TICKS; ++ticks)
+                game.manageMonsters(ticks);
+        }
+    }
+
+    // the report follows the tiles changed since the level was loaded
+    const CGame::Scope scope(game);
+    CMap &map = CGame::getMap();
+    map.set(1, 1, TILES_APPLE);
+    const Pos pos = map.findFirst(TILES_APPLE);
+    map.set(pos.x, pos.y, TILES_BLANK);
+    const MapReport report = game.currentMapReport();
+    const MapReport expected = CGame::generateMapReport(map);
+    if (report.fruits != expected.fruits || report.bonuses != expected.bonuses ||
+        report.secrets != expected.secrets)
+    {
+        LOGE("report: %d fruits, %d bonuses, %d secrets; expecting %d, %d, %d",
+             report.fruits, report.bonuses, report.secrets,
+             expected.fruits, expected.bonuses, expected.secrets);
+        return false;
+    }
+    return true;
+}
+
+bool test_game_prefetch()
+{
+    constexpr const char *IN_FILE = "tests/in/levels1.mapz";
+    constexpr int LEVEL = 8;
+    constexpr int OTHER = 10;
+
+    CMapArch arch;
+    if (!arch.read(IN_FILE))
+    {
+        LOGE("can't read %s", IN_FILE);
+        return false;
+    }
+
+    // handed out once, and only for the level submitted
+    CLevelPrefetch prefetch;
+    CLevelPrefetch::level_t level;
+    const CMap &base = *arch.at(LEVEL);
+    prefetch.submit(LEVEL, base);
+    if (prefetch.take(OTHER, *arch.at(OTHER), level))
+    {
+        LOGE("got level %d instead of %d", LEVEL + 1, OTHER + 1);
+        return false;
+    }
+    if (!prefetch.take(LEVEL, base, level))
+    {
+        LOGE("level %d was not prepared", LEVEL + 1);
+        return false;
+    }
+    if (level.map.hash() != base.hash() || level.cache.base != &base)
+    {
+        LOGE("prepared level %d differs from the archive", LEVEL + 1);
+        return false;
+    }
+    if (prefetch.take(LEVEL, base, level))
+    {
+        LOGE("level %d was handed out twice", LEVEL + 1);
+        return false;
+    }
+
+    // an archive map changed since the submit is not handed out
+    CMap edited(base);
+    prefetch.submit(LEVEL, edited);
+    while (prefetch.prepareCount() < 2)
+        std::this_thread::yield();
+    edited.set(0, 0, TILES_WALLS93);
+    if (prefetch.take(LEVEL, edited, level))
+    {
+        LOGE("got a stale copy of level %d", LEVEL + 1);
+        return false;
+    }
+
+    // a game loading a prepared level is the same as one that did not
+    CGame fresh;
+    playLevel(fresh, arch, OTHER);
+    CGame game;
+    game.setMapArch(&arch);
+    game.prefetchLevel(OTHER);
+    playLevel(game, arch, OTHER);
+    if (fingerprint(game) != fingerprint(fresh))
+    {
+        LOGE("prepared level %d differs once loaded", OTHER + 1);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Headless game fed with a fixed joystick pattern
+ */
+class CTestPlay : public CHeadless
+{
+public:
+    CTestPlay(CMapArch *maparch) : CHeadless(maparch) {}
+
+    void playLevel(const int level)
+    {
+        const CGame::Scope scope(*m_game);
+        m_game->setLevel(level);
+        m_game->loadLevel(CGame::MODE_PLAY);
+        m_game->setMode(CGame::MODE_PLAY);
+        m_countdown = 0;
+        resetTimers();
+    }
+
+    void tick()
+    {
+        const CGame::Scope scope(*m_game);
+        for (int i = 0; i < 4; ++i)
+            m_joyState[i] = 0;
+        m_joyState[m_ticks / 37 * 7 % 4] = 1;
+        mainLoop();
+    }
+
+    bool isPlaying() const
+    {
+        return m_game->mode() == CGame::MODE_PLAY;
+    }
+
+    size_t bossCount() const
+    {
+        return m_game->bosses().size();
+    }
+
+    uint64_t hash() const
+    {
+        const CGame::Scope scope(*m_game);
+        return m_game->stateHash();
+    }
+
+    uint32_t ticks() const
+    {
+        return m_ticks;
+    }
+
+    void rewind(const uint32_t tick)
+    {
+        const CGame::Scope scope(*m_game);
+        m_keyStates[Key_BackSpace] = 1;
+        while (m_ticks > tick)
+            mainLoop();
+        m_keyStates[Key_BackSpace] = 0;
+    }
+
+    bool record(const char *path, const uint32_t ticks, const uint32_t interval)
+    {
+        const CGame::Scope scope(*m_game);
+        CFileWrap tfile;
+        resetTimers();
+        if (!tfile.open(path, "wb") || !write(tfile, "test"))
+            return false;
+        m_recorder->start(&tfile, true);
+        m_recorder->setKeyframeInterval(interval);
+        while (m_ticks < ticks && isPlaying())
+            tick();
+        const size_t keyframes = m_recorder->keyframeCount();
+        m_recorder->stop();
+        return keyframes > 1;
+    }
+
+    bool replay(const char *path, const std::vector<uint32_t> &seeks, uint64_t &hash)
+    {
+        const CGame::Scope scope(*m_game);
+        CFileWrap sfile;
+        std::string name;
+        if (!sfile.open(path, "rb") || !read(sfile, name))
+            return false;
+        resetTimers();
+        m_game->setMode(CGame::MODE_PLAY);
+        if (!m_recorder->start(&sfile, false))
+            return false;
+        for (const uint32_t tick : seeks)
+        {
+            for (int i = 0; i < 50 && !m_recorder->isStopped(); ++i)
+                mainLoop();
+            if (!seekPlayback(tick))
+            {
+                LOGE("seek to %u failed", tick);
+                return false;
+            }
+        }
+        while (!m_recorder->isStopped())
+            mainLoop();
+        hash = m_game->stateHash();
+        return m_recorder->firstMismatch() == -1;
+    }
+
+private:
+    // the timers are not saved with the game; start the recording and its
+    // playback in the same phase
+    void resetTimers()
+    {
+        m_eventCountdown = 0;
+        m_currentEvent = EVENT_NONE;
+        m_timer = TICK_RATE;
+    }
+};
+
+bool test_game_rewind_boss()
+{
+    constexpr const char *IN_FILE = "data/levels.mapz";
+    constexpr int LEVELS[] = {17, 20, 21};
+    enum
+    {
+        TICKS = 600,
+        REWIND_TO = 400,
+    };
+
+    CMapArch arch;
+    if (!arch.read(IN_FILE))
+    {
+        LOGE("can't read %s", IN_FILE);
+        return false;
+    }
+
+    for (const int level : LEVELS)
+    {
+        CTestPlay play(&arch);
+        play.playLevel(level);
+        play.enableRewind(10, 0);
+        if (play.bossCount() == 0)
+        {
+            LOGE("no boss on level %d", level + 1);
+            return false;
+        }
+        uint64_t expected = 0;
+        while (play.ticks() < TICKS && play.isPlaying())
+        {
+            if (play.ticks() == REWIND_TO)
+                expected = play.hash();
+            play.tick();
+        }
+        const uint64_t end = play.hash();
+        play.rewind(REWIND_TO);
+        if (play.hash() != expected || play.bossCount() == 0)
+        {
+            LOGE("level %d: state differs once rewound to tick %d", level + 1, REWIND_TO);
+            return false;
+        }
+        while (play.ticks() < TICKS && play.isPlaying())
+            play.tick();
+        if (play.hash() != end)
+        {
+            LOGE("level %d: state differs once played again from tick %d", level + 1, REWIND_TO);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_game_seek_boss()
+{
+    constexpr const char *IN_FILE = "data/levels.mapz";
+    constexpr const char *OUT_FILE = "tests/out/boss-seek.rec";
+    constexpr int LEVELS[] = {17, 20, 21};
+    enum
+    {
+        TICKS = 600,
+        INTERVAL = 100,
+    };
+
+    CMapArch arch;
+    if (!arch.read(IN_FILE))
+    {
+        LOGE("can't read %s", IN_FILE);
+        return false;
+    }
+
+    for (const int level : LEVELS)
+    {
+        {
+            CTestPlay play(&arch);
+            play.playLevel(level);
+            if (!play.record(OUT_FILE, TICKS, INTERVAL))
+            {
+                LOGE("level %d: failed to record %s", level + 1, OUT_FILE);
+                return false;
+            }
+        }
+        uint64_t straight = 0;
+        uint64_t seeked = 0;
+        CTestPlay first(&arch);
+        CTestPlay second(&arch);
+        if (!first.replay(OUT_FILE, {}, straight) ||
+            !second.replay(OUT_FILE, {450, 100, 350, 0, 500, 250}, seeked))
+        {
+            LOGE("level %d: replay of %s failed or mismatched", level + 1, OUT_FILE);
+            return false;
+        }
+        if (seeked != straight)
+        {
+            LOGE("level %d: 0x%.16lx after seeking; 0x%.16lx played straight",
+                 level + 1, static_cast<unsigned long>(seeked), static_cast<unsigned long>(straight));
+            return false;
+        }
+    }
+    std::filesystem::remove(OUT_FILE);
+    return true;
+}
+
+bool test_game_savegame_boss()
+{
+    constexpr const char *IN_FILE = "data/levels.mapz";
+    constexpr int LEVELS[] = {17, 19};
+    enum
+    {
+        TICKS = 400,
+        SAVE_EVERY = 20,
+        PLAYED = 60,
+    };
+
+    CMapArch arch;
+    if (!arch.read(IN_FILE))
+    {
+        LOGE("can't read %s", IN_FILE);
+        return false;
+    }
+
+    auto tick = [](CGame &game, const int ticks)
+    {
+        const CGame::Scope scope(game);
+        game.manageMonsters(ticks);
+        game.manageBosses(ticks);
+    };
+
+    // a game saved and read back plays on exactly like the one saved
+    for (const int level : LEVELS)
+    {
+        for (int saved = SAVE_EVERY; saved <= TICKS; saved += SAVE_EVERY)
+        {
+            CGame game;
+            playLevel(game, arch, level);
+            for (int ticks = 1; ticks <= saved; ++ticks)
+                tick(game, ticks);
+            CFileMem tfile;
+            tfile.open("", "wb");
+            {
+                const CGame::Scope scope(game);
+                if (!game.write(tfile))
+                {
+                    LOGE("failed to write savegame");
+                    return false;
+                }
+            }
+            CGame loaded;
+            loaded.setMapArch(&arch);
+            CFileMem sfile;
+            sfile.replace(tfile.buffer().data(), tfile.buffer().size());
+            if (!loaded.read(sfile))
+            {
+                LOGE("failed to read savegame");
+                return false;
+            }
+            for (int ticks = saved + 1; ticks <= saved + PLAYED; ++ticks)
+            {
+                tick(game, ticks);
+                tick(loaded, ticks);
+                if (fingerprint(loaded) != fingerprint(game))
+                {
+                    LOGE("level %d saved at tick %d: differs at tick %d", level + 1, saved, ticks);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
@@ -17,4 +17,10 @@
 */
 #pragma once
 
-bool test_game();
\ No newline at end of file
+bool test_game();
+bool test_game_instances();
+bool test_game_savegame();
+bool test_game_restart();
+bool test_game_prefetch();bool test_game_rewind_boss();
+bool test_game_seek_boss();
+bool test_game_savegame_boss();
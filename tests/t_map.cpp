@@ -20,6 +20,8 @@
 #include "../src/maparch.h"
 #include "../src/map.h"
 #include "../src/states.h"
+#include "../src/passability.h"
+#include "../src/tilesdata.h"
 #include "../src/shared/FileWrap.h"
 #include "../src/shared/helper.h"
 #include "../src/logger.h"
@@ -432,3 +434,236 @@ bool test_map_down()
 
     return true;
 }
+
+static bool checkPassability(const CMap &map, const char *step)
+{
+    for (int y = 0; y < map.hei(); ++y)
+    {
+        for (int x = 0; x < map.len(); ++x)
+        {
+            if (map.passMask(x, y) != Passability::tileMask(map.at(x, y)))
+            {
+                LOGE("%s: stale passability at (%d, %d)", step, x, y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_map_passability()
+{
+    using namespace Passability;
+    const uint8_t blank = tileMask(TILES_BLANK);
+    if (blank != (PLAYER | MONSTER | CRUSHER | MOVEABLE | BULLET | SOLID_BOSS | GHOST_BOSS))
+    {
+        LOGE("blank tile should let every class through: 0x%.2x", blank);
+        return false;
+    }
+    if (tileMask(TILES_DOOR01) & PLAYER || !(tileMask(TILES_DOOR01) & DOOR))
+    {
+        LOGE("doors should only open with a key");
+        return false;
+    }
+    if (tileMask(TILES_WALLS93_3) & (SOLID_BOSS | GHOST_BOSS))
+    {
+        LOGE("walls93_3 should stop every boss");
+        return false;
+    }
+
+    CMap map(16, 16, TILES_BLANK);
+    for (int i = 0; i < TILES_TOTAL_COUNT; ++i)
+        map.set(i % map.len(), i / map.len(), i);
+    if (!checkPassability(map, "set"))
+        return false;
+    map.shift(CMap::Direction::LEFT);
+    map.shift(CMap::Direction::DOWN);
+    if (!checkPassability(map, "shift"))
+        return false;
+    map.replaceTile(TILES_BLANK, TILES_WALLS93);
+    if (!checkPassability(map, "replaceTile"))
+        return false;
+
+    map.write(OUT_FILE1);
+    CMap map2;
+    map2.read(OUT_FILE1);
+    std::filesystem::remove(OUT_FILE1);
+    if (!checkPassability(map2, "read"))
+        return false;
+    if (map2.passMask(-1, 0) != NONE || map2.passMask(0, map2.hei()) != NONE)
+    {
+        LOGE("cells outside the map should not be passable");
+        return false;
+    }
+    return true;
+}
+
+bool test_map_visibility()
+{
+    using namespace Passability;
+    CMap map(64, 64, TILES_BLANK);
+    map.set(10, 5, TILES_WALLS93);
+    const Pos left{2, 5};
+    const Pos right{20, 5};
+    const Pos above{2, 2};
+    const Pos aboveRight{20, 2};
+    if (map.isVisible(left, right, BULLET) || !map.isVisible(above, aboveRight, BULLET))
+    {
+        LOGE("the wall should only block the lower ray");
+        return false;
+    }
+    if (!map.isVisible(right, right, BULLET) || map.isVisible(left, Pos{64, 5}, BULLET))
+    {
+        LOGE("unexpected answer for a degenerate ray");
+        return false;
+    }
+
+    // a change in another epoch block keeps the cached rays
+    size_t hits = map.rayHitCount();
+    map.set(50, 50, TILES_WALLS93);
+    if (!map.isVisible(above, aboveRight, BULLET) || map.rayHitCount() != hits + 1)
+    {
+        LOGE("ray should have been reused");
+        return false;
+    }
+    map.set(10, 2, TILES_WALLS93);
+    map.set(10, 5, TILES_BLANK);
+    hits = map.rayHitCount();
+    if (map.isVisible(above, aboveRight, BULLET) || !map.isVisible(left, right, BULLET) ||
+        map.rayHitCount() != hits)
+    {
+        LOGE("rays across a changed tile should be traced again");
+        return false;
+    }
+
+    // cached answers match a map that never saw these rays
+    uint32_t seed = 12345;
+    auto next = [&seed](const int range)
+    {
+        seed = seed * 1103515245 + 12345;
+        return static_cast<int>((seed >> 16) % range);
+    };
+    for (int round = 0; round < 20; ++round)
+    {
+        for (int i = 0; i < 8; ++i)
+            map.set(next(24), next(24), next(2) ? TILES_WALLS93 : TILES_BLANK);
+        const CMap fresh(map);
+        for (int i = 0; i < 64; ++i)
+        {
+            const Pos from{static_cast<int16_t>(next(4)), static_cast<int16_t>(next(4))};
+            const Pos to{static_cast<int16_t>(next(4) + 18), static_cast<int16_t>(next(24))};
+            if (map.isVisible(from, to, BULLET) != fresh.isVisible(from, to, BULLET))
+            {
+                LOGE("stale ray from (%d,%d) to (%d,%d) on round %d", from.x, from.y, to.x, to.y, round);
+                return false;
+            }
+        }
+    }
+    if (map.rayHitCount() == hits)
+    {
+        LOGE("no ray was reused");
+        return false;
+    }
+    return true;
+}
+
+bool test_map_hash()
+{
+    CMap map(32, 32, TILES_BLANK);
+    const uint64_t empty = map.hash();
+    map.set(3, 4, TILES_WALLS93);
+    map.setAttr(3, 4, 0x21);
+    if (map.hash() == empty)
+    {
+        LOGE("hash should change with the map");
+        return false;
+    }
+    map.setAttr(3, 4, 0);
+    map.set(3, 4, TILES_BLANK);
+    if (map.hash() != empty)
+    {
+        LOGE("undoing the writes should restore the hash");
+        return false;
+    }
+
+    // incremental updates match a hash computed from scratch
+    uint32_t seed = 12345;
+    auto next = [&seed](const int range)
+    {
+        seed = seed * 1103515245 + 12345;
+        return static_cast<int>((seed >> 16) % range);
+    };
+    CMap fresh;
+    for (int round = 0; round < 20; ++round)
+    {
+        for (int i = 0; i < 32; ++i)
+        {
+            map.set(next(32), next(32), next(4));
+            map.setAttr(next(32), next(32), next(3));
+        }
+        fresh = map;
+        if (map.hash() != fresh.hash())
+        {
+            LOGE("incremental hash drifted on round %d", round);
+            return false;
+        }
+    }
+
+    // same content, different history
+    map.shift(CMap::UP);
+    map.shift(CMap::DOWN);
+    if (map.hash() != fresh.hash())
+    {
+        LOGE("hash should only depend on the content");
+        return false;
+    }
+    return true;
+}
+
+bool test_map_snapshot()
+{
+    CMap map(64, 64, TILES_BLANK);
+    map.setAttr(1, 1, 0x21);
+    CMap::snapshot_t first;
+    if (map.snapshot(first, nullptr) == 0)
+    {
+        LOGE("first snapshot should copy the map");
+        return false;
+    }
+    const uint64_t hash = map.hash();
+
+    // only the page that was written is copied
+    map.set(40, 50, TILES_WALLS93);
+    CMap::snapshot_t second;
+    if (map.snapshot(second, &first) != sizeof(CMap::page_t))
+    {
+        LOGE("second snapshot should copy a single page");
+        return false;
+    }
+    size_t shared = 0;
+    for (size_t i = 0; i < first.pages.size(); ++i)
+        shared += first.pages[i] == second.pages[i];
+    if (shared != first.pages.size() - 1 || first.attrs != second.attrs)
+    {
+        LOGE("untouched pages should be shared: %zu", shared);
+        return false;
+    }
+
+    map.set(2, 3, TILES_WALLS93);
+    map.setAttr(1, 1, 0);
+    map.setAttr(5, 5, 0x12);
+    if (!map.restore(first) || map.hash() != hash ||
+        map.at(40, 50) != TILES_BLANK || map.getAttr(1, 1) != 0x21 || map.getAttr(5, 5))
+    {
+        LOGE("restore should bring back the first snapshot");
+        return false;
+    }
+
+    CMap other(64, 64, TILES_BLANK);
+    if (other.restore(first))
+    {
+        LOGE("snapshot restored on another map");
+        return false;
+    }
+    return true;
+}
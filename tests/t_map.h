@@ -22,4 +22,8 @@ bool test_map_2();
 bool test_map_up();
 bool test_map_down();
 bool test_map_left();
-bool test_map_right();
\ No newline at end of file
+bool test_map_right();
+bool test_map_passability();
+bool test_map_visibility();
+bool test_map_hash();
+bool test_map_snapshot();
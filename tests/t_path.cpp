@@ -0,0 +1,639 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <vector>
+#include "t_path.h"
+#include "../src/ai_path.h"
+#include "../src/actor.h"
+#include "../src/boss.h"
+#include "../src/bossdata.h"
+#include "../src/game.h"
+#include "../src/map.h"
+#include "../src/passability.h"
+#include "../src/sprtypes.h"
+#include "../src/tilesdata.h"
+#include "../src/logger.h"
+
+// carve a perfect maze with an iterative backtracker; corridors and
+// walls are two tiles wide
+static void makeMaze(CMap &map, const int size, uint32_t seed)
+{
+    map.resize(size, size, TILES_WALLS93, true);
+    map.fill(TILES_WALLS93);
+    auto rand = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) & 0x7fff;
+    };
+    auto carve = [&map](const int x, const int y)
+    {
+        // one maze unit covers a 2x2 block of tiles
+        for (int ty = 0; ty < 2; ++ty)
+            for (int tx = 0; tx < 2; ++tx)
+                map.set(x * 2 + tx, y * 2 + ty, TILES_BLANK);
+    };
+    const int units = (size - 2) / 2;
+    std::vector<bool> open(units * units, false);
+    std::vector<Pos> stack{Pos{1, 1}};
+    open[1 + units] = true;
+    carve(1, 1);
+    while (!stack.empty())
+    {
+        const Pos cur = stack.back();
+        Pos options[4];
+        int count = 0;
+        const Pos deltas[] = {{0, -2}, {0, 2}, {-2, 0}, {2, 0}};
+        for (const auto &d : deltas)
+        {
+            const Pos next{static_cast<int16_t>(cur.x + d.x), static_cast<int16_t>(cur.y + d.y)};
+            if (next.x > 0 && next.x < units - 1 && next.y > 0 && next.y < units - 1 &&
+                !open[next.x + next.y * units])
+                options[count++] = next;
+        }
+        if (count == 0)
+        {
+            stack.pop_back();
+            continue;
+        }
+        const Pos next = options[rand() % count];
+        open[next.x + next.y * units] = true;
+        carve((cur.x + next.x) / 2, (cur.y + next.y) / 2);
+        carve(next.x, next.y);
+        stack.emplace_back(next);
+    }
+}
+
+bool test_path_maze()
+{
+    constexpr int MAZE_SIZE = 63;
+    constexpr int SEARCHES = 20;
+
+    CMap &map = CGame::getMap();
+    makeMaze(map, MAZE_SIZE, 31337);
+
+    std::vector<Pos> cells;
+    for (int y = 0; y < MAZE_SIZE; ++y)
+        for (int x = 0; x < MAZE_SIZE; ++x)
+            if (map.at(x, y) == TILES_BLANK)
+                cells.emplace_back(Pos{static_cast<int16_t>(x), static_cast<int16_t>(y)});
+
+    // BFS finds a shortest path and takes each cell of the grid off its
+    // queue once at most; A* keeps the original search's ties and stale
+    // nodes, so its paths can be longer and a cell can come off its heap
+    // once per cheaper route found to it
+    const size_t gridSize = static_cast<size_t>(MAZE_SIZE) * MAZE_SIZE;
+    const AStar astar;
+    const BFS bfs;
+    const IPath *algos[] = {&astar, &bfs};
+    const char *names[] = {"AStar", "BFS"};
+    const size_t bounds[] = {2 * gridSize, gridSize};
+    std::vector<JoyAim> directions;
+    std::vector<JoyAim> again;
+    size_t found = 0;
+    for (int i = 0; i < SEARCHES; ++i)
+    {
+        const Pos start = cells[(i * 7919) % cells.size()];
+        const Pos goal = cells[(i * 104729 + 17) % cells.size()];
+        CActor actor(start, TYPE_MONSTER);
+        for (size_t a = 0; a < std::size(algos); ++a)
+        {
+            const size_t expansions = IPath::expansionCount();
+            algos[a]->findPath(actor, goal, a == 0 ? directions : again);
+            if (IPath::expansionCount() - expansions > bounds[a])
+            {
+                LOGE("%s: %zu nodes expanded on a grid of %zu cells",
+                     names[a], IPath::expansionCount() - expansions, gridSize);
+                return false;
+            }
+        }
+        if (directions.empty() != again.empty() || directions.size() < again.size())
+        {
+            LOGE("A* path has %zu steps, BFS %zu", directions.size(), again.size());
+            return false;
+        }
+        for (const auto &path : {directions, again})
+        {
+            Pos pos = start;
+            for (const auto &aim : path)
+                pos = CGame::translate(pos, aim);
+            if (!path.empty() && pos != goal)
+            {
+                LOGE("path does not end on the goal");
+                return false;
+            }
+        }
+        found += !again.empty();
+    }
+    if (found == 0)
+    {
+        LOGE("no path found on the maze");
+        return false;
+    }
+
+    // the scratch buffers carry nothing over between searches
+    for (size_t a = 0; a < std::size(algos); ++a)
+    {
+        CActor actor(cells[0], TYPE_MONSTER);
+        algos[a]->findPath(actor, cells.back(), directions);
+        algos[a]->findPath(actor, cells[cells.size() / 2], again);
+        algos[a]->findPath(actor, cells.back(), again);
+        if (directions != again)
+        {
+            LOGE("%s: repeated search gave a different path", names[a]);
+            return false;
+        }
+    }
+
+    // a smaller, open grid after a larger one
+    map.resize(16, 16, TILES_BLANK, true);
+    map.fill(TILES_BLANK);
+    CActor actor(Pos{1, 1}, TYPE_MONSTER);
+    astar.findPath(actor, Pos{12, 9}, directions);
+    bfs.findPath(actor, Pos{12, 9}, again);
+    if (directions.size() != 19 || again.size() != 19)
+    {
+        LOGE("unexpected paths on the small maze: %zu vs %zu", directions.size(), again.size());
+        return false;
+    }
+    map.clear();
+    return true;
+}
+
+bool test_distance_field()
+{
+    constexpr int MAZE_SIZE = 31;
+    constexpr int CHASERS = 8;
+
+    CMap &map = CGame::getMap();
+    makeMaze(map, MAZE_SIZE, 4242);
+
+    std::vector<Pos> cells;
+    for (int y = 0; y < MAZE_SIZE; ++y)
+        for (int x = 0; x < MAZE_SIZE; ++x)
+            if (map.at(x, y) == TILES_BLANK)
+                cells.emplace_back(Pos{static_cast<int16_t>(x), static_cast<int16_t>(y)});
+
+    const BFS bfs;
+    const Pos goal = cells[cells.size() / 2];
+    std::vector<JoyAim> directions;
+    std::vector<CActor> chasers;
+    for (int i = 0; i < CHASERS; ++i)
+        chasers.emplace_back(cells[(i * 7919 + 3) % cells.size()], TYPE_MONSTER);
+
+    // one field for every chaser
+    CDistanceField::invalidate();
+    const size_t builds = CDistanceField::buildCount();
+    for (const auto &chaser : chasers)
+        CDistanceField::get(chaser, goal).descend(chaser);
+    if (CDistanceField::buildCount() != builds + 1)
+    {
+        LOGE("chasers did not share the field: %zu builds", CDistanceField::buildCount() - builds);
+        return false;
+    }
+
+    // walking down the field is as short as the searched path
+    const FlowField flow;
+    std::vector<JoyAim> walk;
+    for (auto &chaser : chasers)
+    {
+        bfs.findPath(chaser, goal, directions);
+        flow.findPath(chaser, goal, walk);
+        if (walk.size() != directions.size())
+        {
+            LOGE("flow field path has %zu steps vs %zu for the search", walk.size(), directions.size());
+            return false;
+        }
+        size_t steps = 0;
+        for (JoyAim aim = CDistanceField::get(chaser, goal).descend(chaser); aim != AIM_NONE;
+             aim = CDistanceField::get(chaser, goal).descend(chaser))
+        {
+            chaser.move(CGame::translate(chaser.pos(), aim));
+            ++steps;
+        }
+        const bool reached = chaser.pos() == goal;
+        if (reached != !directions.empty() || steps != directions.size())
+        {
+            LOGE("chaser took %zu steps (reached:%d) vs %zu for the search", steps, reached, directions.size());
+            return false;
+        }
+    }
+
+    // a different goal rebuilds the field
+    CDistanceField::get(chasers[0], cells[0]);
+    if (CDistanceField::buildCount() != builds + 2)
+    {
+        LOGE("field was not rebuilt for a new goal");
+        return false;
+    }
+    map.clear();
+    return true;
+}
+
+bool test_path_regions()
+{
+    // two rooms split by a wall
+    CMap &map = CGame::getMap();
+    map.resize(32, 16, TILES_BLANK, true);
+    map.fill(TILES_BLANK);
+    for (int y = 0; y < map.hei(); ++y)
+        map.set(16, y, TILES_WALLS93);
+
+    const BFS bfs;
+    const AStar astar;
+    CActor actor(Pos{4, 8}, TYPE_MONSTER);
+    const Pos goal{24, 8};
+    std::vector<JoyAim> directions;
+    const size_t rejects = CRegions::rejectCount();
+    bfs.findPath(actor, goal, directions);
+    astar.findPath(actor, goal, directions);
+    if (!directions.empty() || CRegions::rejectCount() != rejects + 2)
+    {
+        LOGE("sealed goal was not rejected: %zu rejects", CRegions::rejectCount() - rejects);
+        return false;
+    }
+    if (CDistanceField::get(actor, goal).descend(actor) != AIM_NONE)
+    {
+        LOGE("field found a way into the sealed room");
+        return false;
+    }
+
+    // opening a passage joins the rooms without a rebuild
+    const size_t builds = CRegions::buildCount();
+    map.set(16, 8, TILES_BLANK);
+    map.set(16, 9, TILES_BLANK);
+    bfs.findPath(actor, goal, directions);
+    if (directions.empty() || CRegions::buildCount() != builds)
+    {
+        LOGE("passage not picked up: %zu steps, %zu builds",
+             directions.size(), CRegions::buildCount() - builds);
+        return false;
+    }
+
+    // walls placed and removed one at a time never make the labels
+    // stricter than labels built from scratch
+    makeMaze(map, 64, 777);
+    uint32_t seed = 99;
+    auto rand = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) & 0x7fff;
+    };
+    auto randomPos = [&rand, &map]()
+    {
+        return Pos{static_cast<int16_t>(rand() % map.len()), static_cast<int16_t>(rand() % map.hei())};
+    };
+    for (int i = 0; i < 200; ++i)
+    {
+        const Pos pos = randomPos();
+        map.set(pos.x, pos.y, map.at(pos.x, pos.y) == TILES_BLANK ? TILES_WALLS93 : TILES_BLANK);
+        const Pos from = randomPos();
+        const Pos to = randomPos();
+        const bool kept = CRegions::get(actor).canReach(from, to);
+        map.replaceTile(TILES_BLANK, TILES_BLANK);
+        if (CRegions::get(actor).canReach(from, to) && !kept)
+        {
+            LOGE("labels updated in place rejected a reachable goal");
+            return false;
+        }
+    }
+
+    // rewriting the map wholesale relabels it
+    const size_t rebuilds = CRegions::buildCount();
+    map.fill(TILES_WALLS93);
+    bfs.findPath(actor, goal, directions);
+    if (!directions.empty() || CRegions::buildCount() != rebuilds + 1)
+    {
+        LOGE("regions were not rebuilt after a fill");
+        return false;
+    }
+    map.clear();
+    return true;
+}
+
+// length of a shortest walk by the moves the actor makes, or -1
+static int shortestWalk(const CActor &actor, const Pos &goal)
+{
+    const CMap &map = CGame::getMap();
+    std::vector<int> dist(map.len() * map.hei(), -1);
+    std::vector<Pos> queue{actor.pos()};
+    dist[actor.x() + actor.y() * map.len()] = 0;
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        const Pos pos = queue[head];
+        const int steps = dist[pos.x + pos.y * map.len()];
+        if (pos == goal)
+            return steps;
+        for (const JoyAim aim : {AIM_UP, AIM_DOWN, AIM_LEFT, AIM_RIGHT})
+        {
+            const Pos next = CGame::translate(pos, aim);
+            int &seen = dist[next.x + next.y * map.len()];
+            if (seen == -1 && actor.canMoveFrom(pos, aim))
+            {
+                seen = steps + 1;
+                queue.emplace_back(next);
+            }
+        }
+    }
+    return -1;
+}
+
+bool test_path_jps()
+{
+    constexpr int ARENA_SIZE = 255;
+    constexpr int SEARCHES = 50;
+
+    // an open arena with scattered pillars
+    CMap &map = CGame::getMap();
+    map.resize(ARENA_SIZE, ARENA_SIZE, TILES_BLANK, true);
+    map.fill(TILES_BLANK);
+    uint32_t seed = 1234;
+    auto rand = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) & 0x7fff;
+    };
+    for (int i = 0; i < ARENA_SIZE * ARENA_SIZE / 10; ++i)
+        map.set(rand() % ARENA_SIZE, rand() % ARENA_SIZE, TILES_WALLS93);
+
+    std::vector<Pos> cells;
+    for (int y = 0; y < ARENA_SIZE; ++y)
+        for (int x = 0; x < ARENA_SIZE; ++x)
+            if (map.at(x, y) == TILES_BLANK)
+                cells.emplace_back(Pos{static_cast<int16_t>(x), static_cast<int16_t>(y)});
+
+    const JPS jps;
+    std::vector<JoyAim> directions;
+    for (int i = 0; i < SEARCHES; ++i)
+    {
+        const Pos start = cells[(i * 7919) % cells.size()];
+        const Pos goal = cells[(i * 104729 + 17) % cells.size()];
+        CActor actor(start, TYPE_MONSTER);
+        jps.findPath(actor, goal, directions);
+
+        // as short as can be and every step is a legal move
+        const int shortest = shortestWalk(actor, goal);
+        if (static_cast<int>(directions.size()) != shortest && !(directions.empty() && shortest == -1))
+        {
+            LOGE("JPS path has %zu steps, the shortest walk %d", directions.size(), shortest);
+            return false;
+        }
+        for (const auto &aim : directions)
+        {
+            if (!actor.canMove(aim))
+            {
+                LOGE("JPS path walks into a wall");
+                return false;
+            }
+            actor.move(CGame::translate(actor.pos(), aim));
+        }
+        if (!directions.empty() && actor.pos() != goal)
+        {
+            LOGE("JPS path does not end on the goal");
+            return false;
+        }
+    }
+    map.clear();
+    return true;
+}
+
+// chase across a maze with a time-sliced search; returns the positions
+// visited, one per tick
+static std::vector<Pos> chaseSliced(const Pos &start, const Pos &goal, const size_t maxTicks, size_t &searchTicks)
+{
+    const JPS jps;
+    CActor bullet(start, TYPE_FIREBALL);
+    CPath path;
+    std::vector<Pos> trail;
+    searchTicks = 0;
+    while (bullet.pos() != goal && trail.size() < maxTicks)
+    {
+        CPath::beginTick();
+        if (path.followPath(bullet, goal, jps) == CPath::Searching)
+            ++searchTicks;
+        if (CPath::budgetLeft() < 0)
+        {
+            LOGE("node budget overdrawn: %d", CPath::budgetLeft());
+            return {};
+        }
+        trail.emplace_back(bullet.pos());
+    }
+    return trail;
+}
+
+bool test_path_budget()
+{
+    constexpr int MAZE_SIZE = 255;
+    constexpr int BUDGET = 256;
+    CMap &map = CGame::getMap();
+    makeMaze(map, MAZE_SIZE, 2024);
+    std::vector<Pos> cells;
+    for (int y = 0; y < MAZE_SIZE; ++y)
+        for (int x = 0; x < MAZE_SIZE; ++x)
+            if (map.at(x, y) == TILES_BLANK)
+                cells.emplace_back(Pos{static_cast<int16_t>(x), static_cast<int16_t>(y)});
+    const Pos start = cells.front();
+    const Pos goal = cells.back();
+
+    const JPS jps;
+    std::vector<JoyAim> expected;
+    jps.findPath(CActor(start, TYPE_FIREBALL), goal, expected);
+    if (expected.empty())
+    {
+        LOGE("maze has no way across");
+        return false;
+    }
+
+    // the first search takes several ticks and finds the same path
+    CPath::setNodeBudget(BUDGET);
+    size_t searchTicks = 0;
+    const std::vector<Pos> trail = chaseSliced(start, goal, expected.size() * 2, searchTicks);
+    if (trail.empty() || trail.back() != goal || searchTicks < 2)
+    {
+        LOGE("chase took %zu ticks, %zu of them searching", trail.size(), searchTicks);
+        return false;
+    }
+    if (trail[searchTicks] != CGame::translate(start, expected[0]))
+    {
+        LOGE("first step differs from the full search");
+        return false;
+    }
+
+    // same inputs, same chase
+    makeMaze(map, MAZE_SIZE, 2024);
+    size_t replayTicks = 0;
+    if (chaseSliced(start, goal, expected.size() * 2, replayTicks) != trail || replayTicks != searchTicks)
+    {
+        LOGE("time-sliced chase is not deterministic");
+        return false;
+    }
+    LOGI("maze chase: %zu steps, %zu ticks searching", expected.size(), searchTicks);
+
+    // searches running side by side split the budget
+    makeMaze(map, MAZE_SIZE, 2024);
+    CActor first(start, TYPE_FIREBALL);
+    CActor second(cells[1], TYPE_FIREBALL);
+    CPath firstPath;
+    CPath secondPath;
+    CPath::beginTick();
+    firstPath.followPath(first, goal, jps);
+    secondPath.followPath(second, goal, jps);
+    CPath::beginTick();
+    firstPath.followPath(first, goal, jps);
+    if (!firstPath.isSearching() || !secondPath.isSearching() || CPath::budgetLeft() != BUDGET / 2)
+    {
+        LOGE("first search took %d nodes out of %d", BUDGET - CPath::budgetLeft(), BUDGET);
+        return false;
+    }
+
+    // every slot is taken; a new request waits for one to be freed
+    {
+        std::vector<CPath> paths(CPath::MAX_SEARCHES - 2);
+        for (auto &path : paths)
+            path.followPath(first, goal, jps);
+        CPath late;
+        CActor third(cells[2], TYPE_FIREBALL);
+        if (late.followPath(third, goal, jps) != CPath::Searching || late.isSearching())
+        {
+            LOGE("request past the last slot should wait");
+            return false;
+        }
+        paths.pop_back();
+        late.followPath(third, goal, jps);
+        if (!late.isSearching())
+        {
+            LOGE("freed slot was not reused");
+            return false;
+        }
+    }
+    CPath::setNodeBudget(CPath::NODE_BUDGET);
+    map.clear();
+    return true;
+}
+
+bool test_path_cache()
+{
+    // open room split into epoch blocks of 16x16 tiles
+    CMap &map = CGame::getMap();
+    map.resize(48, 48, TILES_BLANK, true);
+    map.fill(TILES_BLANK);
+    CBoss boss(4, 4, &g_bossData[3]);
+    CPath path;
+    const LineOfSight los;
+    Pos goal{80, 4};
+
+    auto follow = [&](const int steps)
+    {
+        for (int i = 0; i < steps; ++i)
+            if (path.followPath(boss, goal, los) != CPath::MoveSuccesful)
+                return false;
+        return true;
+    };
+    auto expect = [&](const char *what, const size_t hits, const size_t misses, const int x)
+    {
+        if (CPath::hitCount() == hits && CPath::missCount() == misses && boss.x() == x)
+            return true;
+        LOGE("%s: %zu hits, %zu misses at x=%d; expected %zu and %zu at x=%d",
+             what, CPath::hitCount(), CPath::missCount(), boss.x(), hits, misses, x);
+        return false;
+    };
+
+    // the walk is searched every 10 steps, which only retraces it
+    CPath::resetCounters();
+    if (!follow(25) || !expect("quiet map", 2, 1, 29))
+        return false;
+
+    // any move of the goal takes a new search
+    goal.x += 2;
+    if (!follow(10) || !expect("goal moved", 2, 2, 39))
+        return false;
+
+    // tiles changed away from the walk, then next to it
+    map.set(10, 40, TILES_WALLS93);
+    if (!follow(10) || !expect("far wall", 3, 2, 49))
+        return false;
+    map.set(35, 1, TILES_WALLS93);
+    if (!follow(10) || !expect("wall along the walk", 3, 3, 59))
+        return false;
+
+    // tiles that keep their pass mask are not a change
+    uint8_t twin = TILES_WALLS93 + 1;
+    while (Passability::tileMask(twin) != Passability::tileMask(TILES_WALLS93))
+        ++twin;
+    map.set(35, 1, twin);
+    if (!follow(10) || !expect("same pass mask", 4, 3, 69))
+        return false;
+
+    // a door closing in front of the boss blocks it; the next call searches again
+    map.set((boss.x() + 2) / 2 + 1, boss.y() / 2, TILES_DOOR01);
+    if (follow(3))
+    {
+        LOGE("door closed: boss went through at x=%d", boss.x());
+        return false;
+    }
+    if (path.followPath(boss, goal, los) == CPath::MoveSuccesful)
+    {
+        LOGE("door closed: walk found past the door");
+        return false;
+    }
+    if (!expect("door closed", 4, 4, boss.x()))
+        return false;
+
+    // blocked walks are remembered until the wall goes away
+    const Pos from{2, 20};
+    const Pos to{10, 20};
+    map.set(from.x, from.y, TILES_FIREBALL);
+    map.set(6, 20, TILES_WALLS93);
+    CActor blocked(from, TYPE_FIREBALL);
+    std::vector<JoyAim> walk;
+    los.findPath(blocked, to, walk);
+    const size_t reused = LineOfSight::reuseCount();
+    los.findPath(blocked, to, walk);
+    if (!walk.empty() || LineOfSight::reuseCount() != reused + 1)
+    {
+        LOGE("blocked walk should have been reused");
+        return false;
+    }
+    map.set(6, 20, TILES_BLANK);
+    los.findPath(blocked, to, walk);
+    if (walk.size() != static_cast<size_t>(to.x - from.x) || LineOfSight::reuseCount() != reused + 1)
+    {
+        LOGE("walk should have been traced again: %zu steps", walk.size());
+        return false;
+    }
+
+    // the last step tests the tile past the goal, in the next epoch block
+    const Pos right{30, 30};
+    const Pos left{16, 30};
+    map.set(right.x, right.y, TILES_FIREBALL);
+    map.set(left.x - 1, left.y, TILES_WALLS93);
+    CActor walker(right, TYPE_FIREBALL);
+    los.findPath(walker, left, walk);
+    if (!walk.empty())
+    {
+        LOGE("walk past the goal should be blocked: %zu steps", walk.size());
+        return false;
+    }
+    map.set(left.x - 1, left.y, TILES_BLANK);
+    los.findPath(walker, left, walk);
+    if (walk.size() != static_cast<size_t>(right.x - left.x))
+    {
+        LOGE("walk should have been traced again once the wall left: %zu steps", walk.size());
+        return false;
+    }
+    map.clear();
+    return true;
+}
@@ -0,0 +1,112 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <vector>
+#include "../src/projectiles.h"
+#include "../src/sprtypes.h"
+#include "../src/logger.h"
+
+static std::vector<int> runPass(CProjectiles &pool, const std::vector<int> &monsters)
+{
+    // interleave the projectiles with a pass over the monsters
+    std::vector<int> visited;
+    pool.begin();
+    for (const int i : monsters)
+    {
+        for (int j = pool.next(i); j != CProjectiles::NONE; j = pool.next(i))
+            visited.emplace_back(100 + j);
+        visited.emplace_back(i);
+    }
+    for (int j = pool.next(CProjectiles::LAST); j != CProjectiles::NONE; j = pool.next(CProjectiles::LAST))
+        visited.emplace_back(100 + j);
+    return visited;
+}
+
+bool test_projectiles()
+{
+    CProjectiles pool;
+    pool.clear();
+
+    // 0 fired before monster 1, 1 and 2 fired after monster 2
+    pool.spawn(CActor(1, 1, TYPE_FIREBALL), 1);
+    pool.spawn(CActor(2, 1, TYPE_FIREBALL), 3);
+    pool.spawn(CActor(3, 1, TYPE_LIGHTNING_BOLT), 3);
+    if (runPass(pool, {0, 1, 2}) != std::vector<int>{0, 100, 1, 2, 101, 102})
+    {
+        LOGE("projectiles visited out of order");
+        return false;
+    }
+
+    // spent projectiles are skipped and reclaimed in order
+    pool.kill(1);
+    if (runPass(pool, {0, 1, 2}) != std::vector<int>{0, 100, 1, 2, 102})
+    {
+        LOGE("spent projectile was visited");
+        return false;
+    }
+    pool.compact();
+    if (pool.size() != 2 || pool[1].x() != 3 || pool[1].type() != TYPE_LIGHTNING_BOLT)
+    {
+        LOGE("unexpected pool content after compact");
+        return false;
+    }
+
+    // removing monster 0 moves every projectile up
+    pool.eraseMonster(0);
+    if (pool.order(0) != 0 || pool.order(1) != 2)
+    {
+        LOGE("projectile order not updated");
+        return false;
+    }
+
+    // filling the reserved slots and then some drops no shot
+    const size_t count = CProjectiles::RESERVED + 64;
+    while (pool.size() < count)
+    {
+        const int x = static_cast<int>(pool.size());
+        CActor *shot = pool.spawn(CActor(x, 2, TYPE_FIREBALL), 2);
+        if (shot == nullptr || shot->x() != x)
+        {
+            LOGE("projectile %d was not spawned", x);
+            return false;
+        }
+    }
+    if (pool[1].x() != 3 || pool[1].type() != TYPE_LIGHTNING_BOLT || pool[count - 1].x() != static_cast<int>(count - 1))
+    {
+        LOGE("projectiles lost while the pool grew");
+        return false;
+    }
+    if (runPass(pool, {0, 1, 2}).size() != 3 + count)
+    {
+        LOGE("projectiles past the reserved slots were not visited");
+        return false;
+    }
+    CProjectiles::impact_t impact{};
+    for (size_t i = 0; i < count; ++i)
+    {
+        impact.pos = pool[i].pos();
+        pool.addImpact(impact);
+    }
+    if (pool.impactCount() != count || pool.impacts()[count - 1].pos.x != static_cast<int>(count - 1))
+    {
+        LOGE("impacts dropped: %zu of %zu", pool.impactCount(), count);
+        return false;
+    }
+
+    pool.clear();
+    return pool.size() == 0;
+}
@@ -15,6 +15,7 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <algorithm>
 #include <filesystem>
 #include <cstring>
 #include "../src/recorder.h"
@@ -121,4 +122,200 @@ bool test_recorder()
     std::filesystem::remove(path0);
     std::filesystem::remove(path1);
     return true;
-}
\ No newline at end of file
+}
+bool test_recorder_checkpoints()
+{
+    constexpr const char *path = "tests/out/test0002.rec";
+    enum
+    {
+        TICKS = 200,
+        DIVERGE = 100,
+    };
+    auto stateAt = [](const uint32_t tick, const bool diverge)
+    {
+        return static_cast<uint64_t>(tick) * 0x9e3779b97f4a7c15ull + (diverge && tick >= DIVERGE);
+    };
+
+    CRecorder rec;
+    CFileWrap tfile;
+    if (!tfile.open(path, "wb"))
+    {
+        LOGE("can't write file %s", path);
+        return false;
+    }
+    rec.start(&tfile, true);
+    uint8_t input[4] = {0, 0, 0, 0};
+    int checkpoints = 0;
+    for (uint32_t tick = 1; tick <= TICKS; ++tick)
+    {
+        input[tick / 10 % 4] = 1;
+        rec.append(input);
+        input[tick / 10 % 4] = 0;
+        if (rec.isCheckpoint())
+        {
+            rec.checkpoint(stateAt(tick, false));
+            ++checkpoints;
+        }
+    }
+    rec.stop();
+    if (checkpoints == 0)
+    {
+        LOGE("no checkpoint was recorded");
+        return false;
+    }
+
+    for (const bool diverge : {false, true})
+    {
+        CFileWrap sfile;
+        if (!sfile.open(path, "rb") || !rec.start(&sfile, false))
+        {
+            LOGE("can't read file %s", path);
+            return false;
+        }
+        uint8_t output[4];
+        int checked = 0;
+        for (uint32_t tick = 1; rec.get(output); ++tick)
+        {
+            if (rec.isCheckpoint())
+            {
+                rec.checkpoint(stateAt(tick, diverge));
+                ++checked;
+            }
+        }
+        const int32_t mismatch = rec.firstMismatch();
+        rec.stop();
+        if (checked != checkpoints)
+        {
+            LOGE("checked %d checkpoints out of %d", checked, checkpoints);
+            return false;
+        }
+        if (!diverge && mismatch != CRecorder::NO_MISMATCH)
+        {
+            LOGE("unexpected mismatch at tick %d", mismatch);
+            return false;
+        }
+        if (diverge && (mismatch < DIVERGE || mismatch >= DIVERGE + 24))
+        {
+            LOGE("mismatch reported at tick %d; diverged at %d", mismatch, DIVERGE);
+            return false;
+        }
+    }
+    std::filesystem::remove(path);
+    return true;
+}
+
+bool test_recorder_keyframes()
+{
+    constexpr const char *path = "tests/out/test0003.rec";
+    enum
+    {
+        TICKS = 2000,
+        RUN = 200,
+        INTERVAL = 100,
+    };
+    auto inputAt = [](const uint32_t tick)
+    {
+        return static_cast<uint8_t>(tick / RUN % 5);
+    };
+    auto snapshotAt = [](const uint32_t tick)
+    {
+        return std::vector<uint8_t>(64 + tick % 7, static_cast<uint8_t>(tick / INTERVAL));
+    };
+
+    CRecorder rec(5);
+    CFileWrap tfile;
+    if (!tfile.open(path, "wb"))
+    {
+        LOGE("can't write file %s", path);
+        return false;
+    }
+    rec.start(&tfile, true);
+    rec.setKeyframeInterval(INTERVAL);
+    uint8_t input[4];
+    for (uint32_t tick = 0; tick < TICKS; ++tick)
+    {
+        if (rec.isKeyframe())
+            rec.keyframe(snapshotAt(tick));
+        memset(input, 0, sizeof(input));
+        if (inputAt(tick))
+            input[inputAt(tick) - 1] = 1;
+        rec.append(input);
+    }
+    if (rec.keyframeCount() != TICKS / INTERVAL)
+    {
+        LOGE("recorded %zu keyframes; expecting %d", rec.keyframeCount(), TICKS / INTERVAL);
+        return false;
+    }
+    rec.stop();
+
+    CFileWrap sfile;
+    if (!sfile.open(path, "rb") || !rec.start(&sfile, false))
+    {
+        LOGE("can't read file %s", path);
+        return false;
+    }
+    uint8_t output[4];
+    for (const uint32_t target : {1234u, 50u, 1999u, 700u})
+    {
+        std::vector<uint8_t> snapshot;
+        const uint32_t keyframe = target / INTERVAL * INTERVAL;
+        if (!rec.seek(target, snapshot) || rec.tick() != keyframe)
+        {
+            LOGE("seek to %u landed on tick %u", target, rec.tick());
+            return false;
+        }
+        if (snapshot != snapshotAt(keyframe))
+        {
+            LOGE("wrong snapshot for tick %u", keyframe);
+            return false;
+        }
+        // play a few ticks past the keyframe
+        for (uint32_t tick = keyframe; tick < std::min(keyframe + 250u, static_cast<uint32_t>(TICKS)); ++tick)
+        {
+            memset(input, 0, sizeof(input));
+            if (inputAt(tick))
+                input[inputAt(tick) - 1] = 1;
+            if (!rec.get(output) || memcmp(input, output, sizeof(input)) != 0)
+            {
+                LOGE("input mismatch at tick %u after seeking to %u", tick, target);
+                return false;
+            }
+        }
+    }
+    rec.stop();
+
+    // format v0: 4-bit run lengths, no trailer
+    constexpr const char *path0 = "tests/out/test0004.rec";
+    const uint8_t v0[] = {
+        'R', 'E', 'C', '!', 0, 0, 0, 0, 3, 0, 0, 0, // header
+        0x31, 0xf4, 0x32,                           // 3x UP, 15x LEFT, 3x DOWN
+    };
+    if (!tfile.open(path0, "wb") || tfile.write(v0, sizeof(v0)) != IFILE_OK)
+    {
+        LOGE("can't write file %s", path0);
+        return false;
+    }
+    tfile.close();
+    if (!sfile.open(path0, "rb") || !rec.start(&sfile, false))
+    {
+        LOGE("can't read v0 file %s", path0);
+        return false;
+    }
+    int ticks = 0;
+    int lefts = 0;
+    while (rec.get(output))
+    {
+        ++ticks;
+        lefts += output[2];
+    }
+    rec.stop();
+    if (ticks != 21 || lefts != 15)
+    {
+        LOGE("v0 playback: %d ticks, %d left; expecting 21 and 15", ticks, lefts);
+        return false;
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path0);
+    return true;
+}
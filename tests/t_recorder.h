@@ -18,3 +18,5 @@
 #pragma once
 
 bool test_recorder();
+bool test_recorder_checkpoints();
+bool test_recorder_keyframes();
@@ -0,0 +1,94 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <vector>
+#include "../src/scheduler.h"
+#include "../src/logger.h"
+
+static std::vector<int> runPass(CScheduler &sched, const int ticks, const Pos &origin)
+{
+    std::vector<int> visited;
+    sched.begin(ticks, origin);
+    for (int i = sched.next(); i != CScheduler::NONE; i = sched.next())
+        visited.emplace_back(i);
+    sched.end();
+    return visited;
+}
+
+bool test_scheduler()
+{
+    CScheduler sched;
+    sched.clear();
+
+    // 0: every tick, 1: every 2 ticks, 2: dormant far away,
+    // 3: every 3 ticks, 4: dormant near origin
+    sched.assign(0, 0, Pos{1, 1});
+    sched.assign(1, 2, Pos{2, 1});
+    sched.assign(2, CScheduler::DORMANT, Pos{100, 100});
+    sched.assign(3, 3, Pos{3, 1});
+    sched.assign(4, CScheduler::DORMANT, Pos{8, 8});
+    if (!sched.isValid(5) || sched.dormantCount() != 2)
+    {
+        LOGE("scheduler out of sync");
+        return false;
+    }
+
+    const Pos origin{5, 5};
+    if (runPass(sched, 6, origin) != std::vector<int>{0, 1, 3, 4})
+    {
+        LOGE("unexpected candidates on tick 6");
+        return false;
+    }
+
+    if (runPass(sched, 7, origin) != std::vector<int>{0, 4})
+    {
+        LOGE("unexpected candidates on tick 7");
+        return false;
+    }
+
+    // an actor further down the list becomes due mid-pass
+    sched.begin(7, origin);
+    std::vector<int> visited;
+    for (int i = sched.next(); i != CScheduler::NONE; i = sched.next())
+    {
+        visited.emplace_back(i);
+        if (i == 0)
+            sched.assign(3, 0, Pos{3, 1});
+    }
+    sched.end();
+    if (visited != std::vector<int>{0, 3, 4})
+    {
+        LOGE("actor woken mid-pass was not visited");
+        return false;
+    }
+
+    // deleting actors renumbers the survivors
+    sched.erase(std::vector<int>{1, 3});
+    if (!sched.isValid(3) || runPass(sched, 7, origin) != std::vector<int>{0, 2})
+    {
+        LOGE("unexpected candidates after erase");
+        return false;
+    }
+
+    sched.invalidate();
+    if (sched.isValid(3))
+    {
+        LOGE("scheduler should be invalid");
+        return false;
+    }
+    return true;
+}
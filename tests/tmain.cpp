@@ -20,12 +20,18 @@
 #include <vector>
 #include <typeinfo>
 #include <filesystem>
+#include "t_arena.h"
+#include "t_autosave.h"
+#include "t_boss.h"
 #include "t_game.h"
 #include "t_gamestats.h"
 #include "t_maparch.h"
 #include "t_map.h"
+#include "t_path.h"
+#include "t_projectiles.h"
 #include "t_recorder.h"
 #include "t_runtime.h"
+#include "t_scheduler.h"
 #include "t_states.h"
 #include "t_stateparser.h"
 #include "t_strhelper.h"
@@ -53,6 +59,8 @@ int main(int argc, char *args[])
 
     std::vector<Test> fct = {
         FCT(test_recorder),
+        FCT(test_recorder_checkpoints),
+        FCT(test_recorder_keyframes),
         FCT(test_states),
         FCT(test_stateparser),
         FCT(test_map),
@@ -61,6 +69,10 @@ int main(int argc, char *args[])
         FCT(test_map_down),
         FCT(test_map_left),
         FCT(test_map_right),
+        FCT(test_map_passability),
+        FCT(test_map_visibility),
+        FCT(test_map_hash),
+        FCT(test_map_snapshot),
         FCT(test_maparch_1),
         FCT(test_maparch_2),
         FCT(test_maparch_3),
@@ -68,11 +80,31 @@ int main(int argc, char *args[])
         FCT(test_gamestats),
         FCT(test_runtime),
         FCT(test_game),
+        FCT(test_game_instances),
+        FCT(test_game_savegame),
+        FCT(test_game_savegame_boss),
+        FCT(test_game_restart),
+        FCT(test_game_prefetch),
+        FCT(test_game_rewind_boss),
+        FCT(test_game_seek_boss),
         FCT(test_ifile),
         FCT(test_ifile_create),
         FCT(test_ifile_read_write),
         FCT(test_png_magic),
         FCT(test_frameset),
+        FCT(test_scheduler),
+        FCT(test_arena),
+        FCT(test_arena_tick),
+        FCT(test_autosave),
+        FCT(test_boss_hitboxes),
+        FCT(test_boss_clearance),
+        FCT(test_projectiles),
+        FCT(test_path_maze),
+        FCT(test_distance_field),
+        FCT(test_path_regions),
+        FCT(test_path_jps),
+        FCT(test_path_budget),
+        FCT(test_path_cache),
     };
 
     int failed = 0;
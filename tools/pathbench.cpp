@@ -0,0 +1,152 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "actor.h"
+#include "ai_path.h"
+#include "game.h"
+#include "map.h"
+#include "sprtypes.h"
+#include "tilesdata.h"
+
+namespace PathBench
+{
+    constexpr int MAZE_SIZE = 255;
+    constexpr int DEFAULT_SEARCHES = 100;
+    constexpr uint32_t MAZE_SEED = 31337;
+    constexpr uint32_t ARENA_SEED = 1234;
+};
+
+using namespace PathBench;
+
+// carve a perfect maze with an iterative backtracker; corridors and
+// walls are two tiles wide
+static void makeMaze(CMap &map, const int size, uint32_t seed)
+{
+    map.resize(size, size, TILES_WALLS93, true);
+    map.fill(TILES_WALLS93);
+    auto rand = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) & 0x7fff;
+    };
+    auto carve = [&map](const int x, const int y)
+    {
+        // one maze unit covers a 2x2 block of tiles
+        for (int ty = 0; ty < 2; ++ty)
+            for (int tx = 0; tx < 2; ++tx)
+                map.set(x * 2 + tx, y * 2 + ty, TILES_BLANK);
+    };
+    const int units = (size - 2) / 2;
+    std::vector<bool> open(units * units, false);
+    std::vector<Pos> stack{Pos{1, 1}};
+    open[1 + units] = true;
+    carve(1, 1);
+    while (!stack.empty())
+    {
+        const Pos cur = stack.back();
+        Pos options[4];
+        int count = 0;
+        const Pos deltas[] = {{0, -2}, {0, 2}, {-2, 0}, {2, 0}};
+        for (const auto &d : deltas)
+        {
+            const Pos next{static_cast<int16_t>(cur.x + d.x), static_cast<int16_t>(cur.y + d.y)};
+            if (next.x > 0 && next.x < units - 1 && next.y > 0 && next.y < units - 1 &&
+                !open[next.x + next.y * units])
+                options[count++] = next;
+        }
+        if (count == 0)
+        {
+            stack.pop_back();
+            continue;
+        }
+        const Pos next = options[rand() % count];
+        open[next.x + next.y * units] = true;
+        carve((cur.x + next.x) / 2, (cur.y + next.y) / 2);
+        carve(next.x, next.y);
+        stack.emplace_back(next);
+    }
+}
+
+static std::vector<Pos> openCells(const CMap &map)
+{
+    std::vector<Pos> cells;
+    for (int y = 0; y < map.hei(); ++y)
+        for (int x = 0; x < map.len(); ++x)
+            if (map.at(x, y) == TILES_BLANK)
+                cells.emplace_back(Pos{static_cast<int16_t>(x), static_cast<int16_t>(y)});
+    return cells;
+}
+
+// time the same searches with each algorithm
+static void bench(const char *title, const std::vector<Pos> &cells, const int searches,
+                  const IPath *const *algos, const char *const *names, const size_t count)
+{
+    std::vector<JoyAim> directions;
+    for (size_t a = 0; a < count; ++a)
+    {
+        size_t found = 0;
+        size_t steps = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < searches; ++i)
+        {
+            CActor actor(cells[(i * 7919) % cells.size()], TYPE_MONSTER);
+            const Pos goal = cells[(i * 104729 + 17) % cells.size()];
+            algos[a]->findPath(actor, goal, directions);
+            found += !directions.empty();
+            steps += directions.size();
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%-5s %-6s %d searches in %.3fs (%.0f searches/s) %zu found, %zu steps\n",
+               title, names[a], searches, elapsed, searches / elapsed, found, steps);
+    }
+}
+
+int main(int argc, char *args[])
+{
+    const int searches = argc > 1 ? std::max(atoi(args[1]), 1) : DEFAULT_SEARCHES;
+    CMap &map = CGame::getMap();
+
+    // corridors: A* and BFS on a perfect maze
+    makeMaze(map, MAZE_SIZE, MAZE_SEED);
+    const AStar astar;
+    const BFS bfs;
+    const IPath *mazeAlgos[] = {&astar, &bfs};
+    const char *mazeNames[] = {"AStar", "BFS"};
+    bench("maze", openCells(map), searches, mazeAlgos, mazeNames, std::size(mazeAlgos));
+
+    // open ground: A* and JPS on an arena with scattered pillars
+    map.resize(MAZE_SIZE, MAZE_SIZE, TILES_BLANK, true);
+    map.fill(TILES_BLANK);
+    uint32_t seed = ARENA_SEED;
+    auto rand = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) & 0x7fff;
+    };
+    for (int i = 0; i < MAZE_SIZE * MAZE_SIZE / 10; ++i)
+        map.set(rand() % MAZE_SIZE, rand() % MAZE_SIZE, TILES_WALLS93);
+    const JPS jps;
+    const IPath *arenaAlgos[] = {&astar, &jps};
+    const char *arenaNames[] = {"AStar", "JPS"};
+    bench("arena", openCells(map), searches, arenaAlgos, arenaNames, std::size(arenaAlgos));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+/*
+    cs3-runtime-sdl
+    Copyright (C) 2025 Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "headless.h"
+#include "maparch.h"
+#include "logger.h"
+#include "recorder.h"
+#include "shared/FileWrap.h"
+
+constexpr const char *DEFAULT_MAPARCH = "data/levels.mapz";
+constexpr const char *RECORDING_EXT = ".rec";
+
+namespace Verify
+{
+    struct params_t
+    {
+        std::string mapArch = DEFAULT_MAPARCH;
+        std::string dir;
+        int workers = 0;
+        bool verbose = false;
+    };
+
+    // levels.mapz, mapped once by the parent and inherited by the workers
+    struct mapping_t
+    {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+    };
+};
+
+using namespace Verify;
+
+static void showHelp()
+{
+    puts("\ncs3-verify (Creepspread III)\n"
+         "\n"
+         "usage: cs3-verify [options] <dir>\n"
+         "\n"
+         "Replays every *.rec recording found in <dir> and prints one JSON\n"
+         "line per recording with the final score, level, tick count, state\n"
+         "hash and the first tick that diverged from the recorded hashes.\n"
+         "\n"
+         "options:\n"
+         "-m <maparch>              set maparch (default: data/levels.mapz)\n"
+         "-j <workers>              number of worker processes (default: cores)\n"
+         "\n"
+         "flags:\n"
+         "-v                        verbose\n"
+         "-h --help                 show this screen\n");
+}
+
+static bool parseArgs(const int argc, char *args[], params_t &params, bool &appExit)
+{
+    bool result = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = args[i];
+        if (strcmp(arg, "-m") == 0 || strcmp(arg, "-j") == 0)
+        {
+            if (i + 1 >= argc || args[i + 1][0] == '-')
+            {
+                LOGE("missing %s value on cmdline", arg[1] == 'm' ? "mapArch" : "workers");
+                result = false;
+            }
+            else if (arg[1] == 'm')
+                params.mapArch = args[++i];
+            else if ((params.workers = atoi(args[++i])) < 1)
+            {
+                LOGE("invalid worker count: %s", args[i]);
+                result = false;
+            }
+        }
+        else if (strcmp(arg, "-v") == 0)
+            params.verbose = true;
+        else if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0)
+        {
+            showHelp();
+            appExit = true;
+            return true;
+        }
+        else if (arg[0] == '-')
+        {
+            LOGE("invalid option: %s", arg);
+            result = false;
+        }
+        else
+            params.dir = arg;
+    }
+    if (result && params.dir.empty())
+    {
+        LOGE("missing recording directory");
+        result = false;
+    }
+    return result;
+}
+
+/**
+ * @brief Map a file read-only in memory
+ *
+ * The pages are shared with the forked workers: no worker needs a copy
+ * of its own.
+ *
+ * @param path
+ * @param mapping
+ * @return true
+ * @return false
+ */
+static bool mapFile(const std::string &path, mapping_t &mapping)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        LOGE("cannot open: %s", path.c_str());
+        return false;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == -1 || sb.st_size == 0)
+    {
+        LOGE("cannot stat: %s", path.c_str());
+        close(fd);
+        return false;
+    }
+    void *ptr = mmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        LOGE("cannot map: %s", path.c_str());
+        return false;
+    }
+    mapping.data = static_cast<const uint8_t *>(ptr);
+    mapping.size = sb.st_size;
+    return true;
+}
+
+static bool listRecordings(const std::string &dir, std::vector<std::string> &files)
+{
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == RECORDING_EXT)
+            files.emplace_back(entry.path().string());
+    }
+    if (ec)
+    {
+        LOGE("cannot list %s: %s", dir.c_str(), ec.message().c_str());
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    return true;
+}
+
+static std::string escapeJson(const std::string &s)
+{
+    std::string out;
+    for (const char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20)
+            continue;
+        out += c;
+    }
+    return out;
+}
+
+/**
+ * @brief Replay one recording and print its JSON line
+ *
+ * Lines are handed to write() whole so that the output of the workers,
+ * who all share stdout, never interleaves.
+ *
+ * @param arch
+ * @param path
+ * @return true
+ * @return false
+ */
+static bool replayFile(CMapArch &arch, const std::string &path)
+{
+    const auto start = std::chrono::steady_clock::now();
+    CHeadless::replay_t replay;
+    bool result = false;
+    CFileWrap file;
+    if (!file.open(path.c_str(), "rb"))
+    {
+        LOGE("cannot read: %s", path.c_str());
+    }
+    else
+    {
+        CHeadless headless(&arch);
+        result = headless.replay(file, replay);
+    }
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    char line[1024];
+    int len;
+    const std::string name = escapeJson(path);
+    if (result)
+    {
+        char mismatch[16] = "null";
+        if (replay.mismatch != CRecorder::NO_MISMATCH)
+            snprintf(mismatch, sizeof(mismatch), "%d", replay.mismatch);
+        len = snprintf(line, sizeof(line),
+                       "{\"file\":\"%s\",\"score\":%d,\"level\":%d,\"ticks\":%u,\"hash\":\"%016" PRIx64 "\",\"mismatch\":%s,\"ms\":%.3f}\n",
+                       name.c_str(), replay.score, replay.level, replay.ticks, replay.hash, mismatch, ms);
+    }
+    else
+        len = snprintf(line, sizeof(line),
+                       "{\"file\":\"%s\",\"error\":\"replay failed\",\"ms\":%.3f}\n",
+                       name.c_str(), ms);
+    if (write(STDOUT_FILENO, line, std::min(static_cast<size_t>(len), sizeof(line) - 1)) == -1)
+        LOGE("failed to write result for %s", path.c_str());
+    return result;
+}
+
+/**
+ * @brief Body of a worker process
+ *
+ * @param arch
+ * @param files
+ * @param first first recording handled by this worker
+ * @param stride number of workers
+ * @return int exit status
+ */
+static int runWorker(CMapArch &arch, const std::vector<std::string> &files, const size_t first, const size_t stride)
+{
+    int failures = 0;
+    for (size_t i = first; i < files.size(); i += stride)
+    {
+        if (!replayFile(arch, files[i]))
+            ++failures;
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char *args[])
+{
+    params_t params;
+    bool appExit = false;
+    if (!parseArgs(argc, args, params, appExit))
+        return EXIT_FAILURE;
+    else if (appExit)
+        return EXIT_SUCCESS;
+    // stdout is reserved for the results
+    Logger::setLevel(params.verbose ? Logger::L_WARN : Logger::L_ERROR);
+
+    std::vector<std::string> files;
+    if (!listRecordings(params.dir, files))
+        return EXIT_FAILURE;
+    if (files.empty())
+    {
+        LOGE("no recordings found in %s", params.dir.c_str());
+        return EXIT_FAILURE;
+    }
+
+    mapping_t mapping;
+    if (!mapFile(params.mapArch, mapping))
+        return EXIT_FAILURE;
+    // the archive reader only copies out of its buffer
+    CMapArch arch;
+    if (!arch.fromMemory(const_cast<uint8_t *>(mapping.data)))
+    {
+        LOGE("mapArch error: %s", arch.lastError());
+        return EXIT_FAILURE;
+    }
+
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = params.workers ? params.workers : std::max(cores, 1L);
+    workers = std::min(workers, files.size());
+
+    std::vector<pid_t> children;
+    for (size_t i = 0; i < workers; ++i)
+    {
+        const pid_t pid = fork();
+        if (pid == 0)
+            _exit(runWorker(arch, files, i, workers));
+        else if (pid == -1)
+        {
+            LOGE("fork failed: %s", strerror(errno));
+            break;
+        }
+        children.emplace_back(pid);
+    }
+
+    int result = children.size() == workers ? EXIT_SUCCESS : EXIT_FAILURE;
+    for (const pid_t pid : children)
+    {
+        int status = 0;
+        if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            result = EXIT_FAILURE;
+    }
+    munmap(const_cast<uint8_t *>(mapping.data), mapping.size);
+    return result;
+}